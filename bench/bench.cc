@@ -0,0 +1,568 @@
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// DUPSORT data items are stored like keys: limited to the max. key size
+constexpr auto const kMaxDupSize = std::size_t{500U};
+
+// log-linear latency histogram (nanoseconds)
+// 64 sub-buckets per power of two -> percentiles within ~1.6% of exact
+struct histogram {
+  static constexpr auto const kSubBits = 6U;
+  static constexpr auto const kSub = 1U << kSubBits;
+
+  void add(std::uint64_t const ns) {
+    ++buckets_[bucket(ns)];
+    ++count_;
+    max_ = std::max(max_, ns);
+  }
+
+  std::uint64_t percentile(double const p) const {
+    if (count_ == 0U) {
+      return 0U;
+    }
+    auto const rank = static_cast<std::uint64_t>(
+        std::ceil(p / 100.0 * static_cast<double>(count_)));
+    auto seen = std::uint64_t{0U};
+    for (auto i = 0U; i != buckets_.size(); ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        return std::min(upper_bound(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  std::uint64_t count_{0U};
+
+private:
+  static unsigned bucket(std::uint64_t const ns) {
+    if (ns < kSub) {
+      return static_cast<unsigned>(ns);
+    }
+    auto log2 = 0U;
+    for (auto x = ns >> 1U; x != 0U; x >>= 1U) {
+      ++log2;
+    }
+    auto const shift = log2 - kSubBits;
+    return (shift + 1U) * kSub +
+           static_cast<unsigned>((ns >> shift) & (kSub - 1U));
+  }
+
+  static std::uint64_t upper_bound(unsigned const b) {
+    if (b < kSub) {
+      return b;
+    }
+    auto const shift = b / kSub - 1U;
+    auto const sub = b % kSub;
+    return ((std::uint64_t{kSub} | sub) + 1U) << shift;
+  }
+
+  std::array<std::uint64_t, (64U - kSubBits + 1U) * kSub> buckets_{};
+  std::uint64_t max_{0U};
+};
+
+struct config {
+  std::string path_{"./BENCH.mdb"};
+  std::size_t key_size_{16U};
+  std::size_t value_size_{100U};
+  std::uint64_t db_size_{256ULL << 20U};
+  std::uint64_t ops_{1'000'000U};
+  std::uint64_t batch_{10'000U};
+  std::uint64_t dups_{64U};
+  std::uint64_t commits_{1'000U};
+  unsigned uring_{0U};
+  unsigned max_dirty_{0U};
+  unsigned prefetch_{0U};
+  std::vector<std::string> only_;
+};
+
+struct key_gen {
+  explicit key_gen(std::size_t const size)
+      : buf_(std::max(size, sizeof(std::uint64_t)), '\0') {}
+
+  // big-endian prefix: lexicographic order == numeric order
+  std::string_view operator()(std::uint64_t const i) {
+    for (auto b = 0U; b != sizeof(i); ++b) {
+      buf_[b] = static_cast<char>((i >> (8U * (sizeof(i) - 1U - b))) & 0xFFU);
+    }
+    return buf_;
+  }
+
+  std::string buf_;
+};
+
+std::uint64_t physical_ram() {
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+  auto const pages = sysconf(_SC_PHYS_PAGES);
+  auto const page_size = sysconf(_SC_PAGE_SIZE);
+  if (pages > 0 && page_size > 0) {
+    return static_cast<std::uint64_t>(pages) *
+           static_cast<std::uint64_t>(page_size);
+  }
+#endif
+  return 0U;
+}
+
+std::uint64_t parse_size(std::string_view s) {
+  auto const ram = physical_ram();
+  auto const suffix_at = s.find_first_not_of("0123456789.");
+  auto const value = std::strtod(std::string{s.substr(0, suffix_at)}.c_str(),
+                                 nullptr);
+  auto const suffix =
+      suffix_at == std::string_view::npos ? "" : s.substr(suffix_at);
+  auto mult = 1.0;
+  if (suffix == "K") {
+    mult = 1024.0;
+  } else if (suffix == "M") {
+    mult = 1024.0 * 1024.0;
+  } else if (suffix == "G") {
+    mult = 1024.0 * 1024.0 * 1024.0;
+  } else if (suffix == "T") {
+    mult = 1024.0 * 1024.0 * 1024.0 * 1024.0;
+  } else if (suffix == "xRAM") {
+    if (ram == 0U) {
+      std::fprintf(stderr, "unable to determine physical RAM size\n");
+      std::exit(1);
+    }
+    mult = static_cast<double>(ram);
+  } else if (!suffix.empty()) {
+    std::fprintf(stderr, "unknown size suffix: %s\n",
+                 std::string{suffix}.c_str());
+    std::exit(1);
+  }
+  return static_cast<std::uint64_t>(value * mult);
+}
+
+void usage(char const* name) {
+  std::printf(
+      "usage: %s [options]\n"
+      "  --path P        database file (default ./BENCH.mdb)\n"
+      "  --key-size N    key size in bytes, 8-511 (default 16)\n"
+      "  --value-size N  value size in bytes (default 100)\n"
+      "  --db-size S     approx. payload size, suffix K/M/G/T or xRAM\n"
+      "                  e.g. 0.5xRAM, 2xRAM (default 256M)\n"
+      "  --ops N         point operations per get benchmark (default 1e6)\n"
+      "  --batch N       puts per write transaction (default 10000)\n"
+      "  --dups N        duplicates per key for DUPSORT/DUPFIXED (default 64)\n"
+      "  --commits N     transactions per commit benchmark (default 1000)\n"
+      "  --uring N       commit through io_uring, queue depth N (default 0)\n"
+      "  --max-dirty N   dirty pages per write txn before spilling\n"
+      "  --prefetch N    leaf pages a scan reads ahead (default 0)\n"
+      "  --only A,B      run only the named benchmarks\n"
+      "benchmarks: put append bulk get scan dupsort dupfixed commit copy\n",
+      name);
+}
+
+config parse_args(int argc, char** argv) {
+  auto c = config{};
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--help" || arg == "-h") {
+      usage(argv[0]);
+      std::exit(0);
+    }
+    if (i + 1 == argc) {
+      usage(argv[0]);
+      std::exit(1);
+    }
+    auto const val = std::string_view{argv[++i]};
+    auto const num = [&]() {
+      return static_cast<std::uint64_t>(
+          std::strtoull(std::string{val}.c_str(), nullptr, 10));
+    };
+    if (arg == "--path") {
+      c.path_ = val;
+    } else if (arg == "--key-size") {
+      c.key_size_ = std::max(num(), std::uint64_t{sizeof(std::uint64_t)});
+    } else if (arg == "--value-size") {
+      c.value_size_ = num();
+    } else if (arg == "--db-size") {
+      c.db_size_ = parse_size(val);
+    } else if (arg == "--ops") {
+      c.ops_ = num();
+    } else if (arg == "--batch") {
+      c.batch_ = std::max(num(), std::uint64_t{1U});
+    } else if (arg == "--dups") {
+      c.dups_ = std::max(num(), std::uint64_t{1U});
+    } else if (arg == "--commits") {
+      c.commits_ = num();
+    } else if (arg == "--max-dirty") {
+      c.max_dirty_ = static_cast<unsigned>(num());
+    } else if (arg == "--prefetch") {
+      c.prefetch_ = static_cast<unsigned>(num());
+    } else if (arg == "--uring") {
+      c.uring_ = static_cast<unsigned>(num());
+    } else if (arg == "--only") {
+      for (auto rest = val; !rest.empty();) {
+        auto const comma = rest.find(',');
+        c.only_.emplace_back(rest.substr(0, comma));
+        rest = comma == std::string_view::npos ? std::string_view{}
+                                               : rest.substr(comma + 1);
+      }
+    } else {
+      usage(argv[0]);
+      std::exit(1);
+    }
+  }
+  return c;
+}
+
+void report(char const* name, histogram const& h,
+            clock_type::duration const total) {
+  auto const secs = std::chrono::duration<double>(total).count();
+  std::printf(
+      "%-26s %12" PRIu64 " ops %14.0f ops/s   p50 %9" PRIu64
+      " ns   p99 %9" PRIu64 " ns   p999 %9" PRIu64 " ns\n",
+      name, h.count_, secs > 0.0 ? static_cast<double>(h.count_) / secs : 0.0,
+      h.percentile(50.0), h.percentile(99.0), h.percentile(99.9));
+  std::fflush(stdout);
+}
+
+// measures fn() per call; fn returns false to stop early
+template <typename Fn>
+void measure(char const* name, std::uint64_t const n, Fn&& fn) {
+  auto h = histogram{};
+  auto const start = clock_type::now();
+  for (auto i = std::uint64_t{0U}; i != n; ++i) {
+    auto const op_start = clock_type::now();
+    auto const go_on = fn(i);
+    auto const op_end = clock_type::now();
+    h.add(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(op_end - op_start)
+            .count()));
+    if (!go_on) {
+      break;
+    }
+  }
+  report(name, h, clock_type::now() - start);
+}
+
+struct bench {
+  explicit bench(config c)
+      : c_{std::move(c)},
+        n_{std::max(c_.db_size_ / (c_.key_size_ + c_.value_size_ + 16U),
+                    std::uint64_t{1U})},
+        value_(c_.value_size_, 'v') {}
+
+  bool enabled(std::string_view const name) const {
+    return c_.only_.empty() || std::find(begin(c_.only_), end(c_.only_),
+                                         name) != end(c_.only_);
+  }
+
+  // bulk benchmarks run without fsync, commit benchmarks pass NONE
+  lmdb::env open_env(
+      std::uint64_t const map_size,
+      lmdb::env_open_flags const flags = lmdb::env_open_flags::NOSYNC) {
+    std::remove(c_.path_.c_str());
+    std::remove((c_.path_ + "-lock").c_str());
+    auto e = lmdb::env{};
+    e.set_mapsize(map_size);
+    if (c_.uring_ != 0U && !e.set_uring(c_.uring_)) {
+      std::fprintf(stderr, "io_uring unavailable, using writev\n");
+    }
+    if (c_.max_dirty_ != 0U) {
+      e.set_max_dirty_pages(c_.max_dirty_);
+    }
+    e.open(c_.path_.c_str(), lmdb::env_open_flags::NOSUBDIR | flags);
+    return e;
+  }
+
+  std::uint64_t map_size() const { return c_.db_size_ * 3U + (64ULL << 20U); }
+
+  std::vector<std::uint64_t> shuffled(std::uint64_t const n) const {
+    auto v = std::vector<std::uint64_t>(n);
+    std::iota(begin(v), end(v), std::uint64_t{0U});
+    std::shuffle(begin(v), end(v), std::mt19937_64{42U});
+    return v;
+  }
+
+  // fills dbi with n_ keys in batches; one measured op per put
+  template <typename Order>
+  void fill(lmdb::env& e, char const* name, Order&& order,
+            lmdb::put_flags const flags) {
+    auto kg = key_gen{c_.key_size_};
+    auto t = std::make_unique<lmdb::txn>(e);
+    auto db = t->dbi_open();
+    measure(name, n_, [&](std::uint64_t const i) {
+      t->put(db, kg(order(i)), value_, flags);
+      if ((i + 1U) % c_.batch_ == 0U) {
+        t->commit();
+        t = std::make_unique<lmdb::txn>(e);
+      }
+      return true;
+    });
+    t->commit();
+  }
+
+  void put() {
+    auto e = open_env(map_size());
+    auto const order = shuffled(n_);
+    fill(
+        e, "txn::put (random)", [&](std::uint64_t const i) { return order[i]; },
+        lmdb::put_flags::NONE);
+  }
+
+  void append() {
+    auto e = open_env(map_size());
+    fill(
+        e, "txn::put (APPEND)", [](std::uint64_t const i) { return i; },
+        lmdb::put_flags::APPEND);
+  }
+
+  // one transaction, no per-key tree descent or dirty list
+  void bulk() {
+    auto e = open_env(map_size());
+    auto kg = key_gen{c_.key_size_};
+    auto t = lmdb::txn{e};
+    auto db = t.dbi_open();
+    auto b = lmdb::bulk_builder{t, db};
+    measure("bulk_builder::put", n_, [&](std::uint64_t const i) {
+      b.put(kg(i), value_);
+      return true;
+    });
+    measure("bulk_builder::finish + commit", 1U, [&](std::uint64_t) {
+      b.finish();
+      t.commit();
+      return true;
+    });
+  }
+
+  // compacting copy of a randomly filled database, serial vs. threads
+  void copy() {
+    auto e = open_env(map_size());
+    auto const order = shuffled(n_);
+    fill(
+        e, "txn::put (random)", [&](std::uint64_t const i) { return order[i]; },
+        lmdb::put_flags::NONE);
+
+    auto const target = c_.path_ + ".copy";
+    auto const hw = std::max(std::thread::hardware_concurrency(), 2U);
+    for (auto const threads : {1U, hw}) {
+      auto const name = "env::copy (compact, " + std::to_string(threads) +
+                        (threads == 1U ? " thread)" : " threads)");
+      std::remove(target.c_str());
+      measure(name.c_str(), 1U, [&](std::uint64_t) {
+        e.copy(target.c_str(), {true, threads});
+        return true;
+      });
+    }
+    std::remove(target.c_str());
+  }
+
+  void get_and_scan() {
+    auto e = open_env(map_size());
+    fill(
+        e, "txn::put (APPEND)", [](std::uint64_t const i) { return i; },
+        lmdb::put_flags::APPEND);
+
+    auto t = lmdb::txn{e, lmdb::txn_flags::RDONLY};
+    auto db = t.dbi_open();
+
+    if (enabled("get")) {
+      auto kg = key_gen{c_.key_size_};
+      auto rng = std::mt19937_64{7U};
+      auto dist = std::uniform_int_distribution<std::uint64_t>{0U, n_ - 1U};
+      measure("txn::get (random)", c_.ops_, [&](std::uint64_t) {
+        return t.get(db, kg(dist(rng))).has_value();
+      });
+
+      constexpr auto const kBatch = std::size_t{1'000U};
+      auto keys = std::vector<std::string>(kBatch);
+      auto out = std::vector<std::optional<std::string_view>>(kBatch);
+      measure("txn::get_many (x1000)", c_.ops_ / kBatch, [&](std::uint64_t) {
+        for (auto& k : keys) {
+          k = kg(dist(rng));
+        }
+        t.get_many(db, keys, out);
+        return true;
+      });
+    }
+
+    if (enabled("scan")) {
+      auto c = lmdb::cursor{t, db};
+      c.set_prefetch(c_.prefetch_);
+      auto sum = std::size_t{0U};
+      c.get(lmdb::cursor_op::FIRST);
+      measure("cursor::get(NEXT)", n_, [&](std::uint64_t) {
+        auto const el = c.get(lmdb::cursor_op::NEXT);
+        sum += el ? el->second.size() : 0U;
+        return el.has_value();
+      });
+
+      auto const r = c.range();
+      auto it = r.begin();
+      measure("cursor::range()", n_, [&](std::uint64_t) {
+        sum += it->second.size();
+        ++it;
+        return it != r.end();
+      });
+      if (sum == 0U && n_ > 1U) {
+        std::fprintf(stderr, "scan read nothing\n");
+      }
+    }
+  }
+
+  void dup_iteration(char const* fill_name, char const* iter_name,
+                     lmdb::dbi_flags const flags) {
+    auto e = open_env(map_size());
+    auto const dup_size = (flags & lmdb::dbi_flags::DUPFIXED) ==
+                                  lmdb::dbi_flags::DUPFIXED
+                              ? sizeof(std::uint64_t)
+                              : std::min(c_.value_size_, kMaxDupSize);
+    auto const keys = std::max(
+        c_.db_size_ / ((dup_size + 16U) * c_.dups_), std::uint64_t{1U});
+
+    auto kg = key_gen{c_.key_size_};
+    auto dup = std::string(std::max(dup_size, sizeof(std::uint64_t)), 'd');
+    {
+      auto t = std::make_unique<lmdb::txn>(e);
+      auto db = t->dbi_open(flags);
+      measure(fill_name, keys * c_.dups_, [&](std::uint64_t const i) {
+        auto const d = i % c_.dups_;
+        for (auto b = 0U; b != sizeof(d); ++b) {
+          dup[b] =
+              static_cast<char>((d >> (8U * (sizeof(d) - 1U - b))) & 0xFFU);
+        }
+        t->put(db, kg(i / c_.dups_), dup, lmdb::put_flags::APPENDDUP);
+        if ((i + 1U) % c_.batch_ == 0U) {
+          t->commit();
+          t = std::make_unique<lmdb::txn>(e);
+        }
+        return true;
+      });
+      t->commit();
+    }
+
+    auto t = lmdb::txn{e, lmdb::txn_flags::RDONLY};
+    auto db = t.dbi_open(flags);
+    auto c = lmdb::cursor{t, db};
+    auto const total = keys * c_.dups_;
+    auto sum = std::size_t{0U};
+    measure(iter_name, total, [&, first = true](std::uint64_t) mutable {
+      auto el = c.get(first ? lmdb::cursor_op::FIRST
+                            : lmdb::cursor_op::NEXT_DUP);
+      if (!el) {
+        el = c.get(lmdb::cursor_op::NEXT_NODUP);
+      }
+      first = false;
+      sum += el ? el->second.size() : 0U;
+      return el.has_value();
+    });
+    if (sum == 0U) {
+      std::fprintf(stderr, "dup iteration read nothing\n");
+    }
+  }
+
+  void commit(char const* name, lmdb::txn_flags const flags) {
+    auto e = open_env(
+        c_.commits_ * (c_.key_size_ + c_.value_size_ + 64U) * 4U +
+            (64ULL << 20U),
+        lmdb::env_open_flags::NONE);
+    auto kg = key_gen{c_.key_size_};
+    {
+      auto t = lmdb::txn{e};
+      t.dbi_open();
+      t.commit();
+    }
+    measure(name, c_.commits_, [&](std::uint64_t const i) {
+      auto t = lmdb::txn{e, flags};
+      auto db = t.dbi_open();
+      t.put(db, kg(i), value_);
+      t.commit();
+      return true;
+    });
+  }
+
+  void run() {
+    std::printf(
+        "key %zu B, value %zu B, db ~%" PRIu64 " MiB (%" PRIu64
+        " keys), RAM %" PRIu64 " MiB\n",
+        c_.key_size_, c_.value_size_, c_.db_size_ >> 20U, n_,
+        physical_ram() >> 20U);
+
+    if (enabled("put")) {
+      put();
+    }
+    if (enabled("append")) {
+      append();
+    }
+    if (enabled("bulk")) {
+      bulk();
+    }
+    if (enabled("get") || enabled("scan")) {
+      get_and_scan();
+    }
+    if (enabled("dupsort")) {
+      dup_iteration("put DUPSORT (APPENDDUP)", "iterate DUPSORT",
+                    lmdb::dbi_flags::DUPSORT);
+    }
+    if (enabled("dupfixed")) {
+      dup_iteration("put DUPFIXED (APPENDDUP)", "iterate DUPFIXED",
+                    lmdb::dbi_flags::DUPSORT | lmdb::dbi_flags::DUPFIXED);
+    }
+    if (enabled("commit")) {
+      commit_modes();
+    }
+    if (enabled("copy")) {
+      copy();
+    }
+
+    std::remove(c_.path_.c_str());
+    std::remove((c_.path_ + "-lock").c_str());
+  }
+
+  // env opened without NOSYNC, sync mode selected per transaction
+  void commit_modes() {
+    struct mode {
+      char const* name_;
+      lmdb::txn_flags flags_;
+    };
+    for (auto const& m :
+         {mode{"commit (default sync)", lmdb::txn_flags::NONE},
+          mode{"commit (NOMETASYNC)", lmdb::txn_flags::NOMETASYNC},
+          mode{"commit (NOSYNC)", lmdb::txn_flags::NOSYNC}}) {
+      commit(m.name_, m.flags_);
+    }
+  }
+
+  config c_;
+  std::uint64_t n_;
+  std::string value_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  try {
+    bench{parse_args(argc, argv)}.run();
+  } catch (std::exception const& e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstddef>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lmdb/lmdb.hpp"
+
+namespace lmdb {
+
+// applies write closures fn(txn&) submitted by many threads in a single
+// writer thread: everything that arrives within the latency budget after
+// the first closure of a batch shares one write transaction and one commit
+//
+// - futures complete after the commit (or with the closure's exception)
+// - results are moved out before the commit: don't return views into txn
+// - a throwing closure is removed and the rest of its batch is rerun in a
+//   fresh transaction, so closures must not have side effects besides txn
+// - MDB_MAP_FULL / MDB_MAP_RESIZED fail the closures, unless grow_map is
+//   set: then the writer thread handles them via env::grow_map, which
+//   remaps the file, so as for env::write no other transaction (readers
+//   of request threads included) may be active in this process
+struct group_commit final {
+  using clock = std::chrono::steady_clock;
+
+  explicit group_commit(env& e,
+                        std::chrono::microseconds const latency_budget =
+                            std::chrono::microseconds{500},
+                        std::size_t const max_batch = 1024U,
+                        txn_flags const flags = txn_flags::NONE,
+                        bool const grow_map = false)
+      : env_{e},
+        budget_{latency_budget},
+        max_batch_{max_batch},
+        flags_{flags},
+        grow_map_{grow_map},
+        writer_{[this]() { run(); }} {}
+
+  group_commit(group_commit const&) = delete;
+  group_commit& operator=(group_commit const&) = delete;
+  group_commit(group_commit&&) = delete;
+  group_commit& operator=(group_commit&&) = delete;
+
+  // applies the remaining closures before returning
+  ~group_commit() {
+    {
+      auto const lock = std::lock_guard{mutex_};
+      stop_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+  }
+
+  template <typename Fn>
+  std::future<std::invoke_result_t<Fn&, txn&>> submit(Fn&& fn) {
+    auto t = std::make_unique<task<std::decay_t<Fn>>>(std::forward<Fn>(fn));
+    auto f = t->promise_.get_future();
+    {
+      auto const lock = std::lock_guard{mutex_};
+      queue_.emplace_back(std::move(t));
+    }
+    cv_.notify_one();
+    return f;
+  }
+
+  // number of committed write transactions
+  std::size_t commits() const { return commits_; }
+
+private:
+  struct item {
+    item() = default;
+    item(item const&) = delete;
+    item& operator=(item const&) = delete;
+    item(item&&) = delete;
+    item& operator=(item&&) = delete;
+    virtual ~item() = default;
+
+    virtual void run(txn&) = 0;
+    virtual void done() = 0;
+    virtual void fail(std::exception_ptr) = 0;
+  };
+
+  template <typename Fn>
+  struct task final : public item {
+    using result_t = std::invoke_result_t<Fn&, txn&>;
+
+    explicit task(Fn fn) : fn_{std::move(fn)} {}
+
+    void run(txn& t) override {
+      if constexpr (std::is_void_v<result_t>) {
+        fn_(t);
+      } else {
+        result_.emplace(fn_(t));
+      }
+    }
+
+    void done() override {
+      if constexpr (std::is_void_v<result_t>) {
+        promise_.set_value();
+      } else {
+        promise_.set_value(std::move(*result_));
+      }
+    }
+
+    void fail(std::exception_ptr e) override {
+      promise_.set_exception(std::move(e));
+    }
+
+    Fn fn_;
+    std::promise<result_t> promise_;
+    std::conditional_t<std::is_void_v<result_t>, bool,
+                       std::optional<result_t>>
+        result_{};
+  };
+
+  using batch_t = std::vector<std::unique_ptr<item>>;
+
+  void run() {
+    auto lock = std::unique_lock{mutex_};
+    auto batch = batch_t{};
+    while (true) {
+      cv_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+
+      cv_.wait_until(lock, clock::now() + budget_, [&]() {
+        return stop_ || queue_.size() >= max_batch_;
+      });
+      auto const last =
+          begin(queue_) + static_cast<std::ptrdiff_t>(
+                              std::min(queue_.size(), max_batch_));
+      batch.clear();
+      std::move(begin(queue_), last, std::back_inserter(batch));
+      queue_.erase(begin(queue_), last);
+
+      lock.unlock();
+      apply(batch);
+      lock.lock();
+    }
+  }
+
+  bool is_resize(std::exception_ptr const& e) {
+    if (!grow_map_) {
+      return false;
+    }
+    try {
+      std::rethrow_exception(e);
+    } catch (std::system_error const& se) {
+      return env_.grow_map(se.code());
+    } catch (...) {
+      return false;
+    }
+  }
+
+  void apply(batch_t& batch) {
+    while (!batch.empty()) {
+      auto failed = batch.size();
+      auto error = std::exception_ptr{};
+      try {
+        auto t = txn{env_, flags_};
+        for (auto i = 0U; i != batch.size(); ++i) {
+          try {
+            batch[i]->run(t);
+          } catch (...) {
+            failed = i;
+            error = std::current_exception();
+            break;
+          }
+        }
+
+        if (failed == batch.size()) {
+          t.committed_ = true;
+          ex(mdb_txn_commit(t.txn_));
+          ++commits_;
+          for (auto& el : batch) {
+            el->done();
+          }
+          return;
+        }
+      } catch (...) {  // begin / commit failed: affects the whole batch
+        if (is_resize(std::current_exception())) {
+          continue;
+        }
+        for (auto& el : batch) {
+          el->fail(std::current_exception());
+        }
+        return;
+      }
+
+      if (!is_resize(error)) {
+        batch[failed]->fail(error);
+        batch.erase(begin(batch) + static_cast<std::ptrdiff_t>(failed));
+      }
+    }
+  }
+
+  env& env_;
+  std::chrono::microseconds budget_;
+  std::size_t max_batch_;
+  txn_flags flags_;
+  bool grow_map_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<item>> queue_;
+  bool stop_{false};
+  std::atomic_size_t commits_{0U};
+
+  std::thread writer_;
+};
+
+}  // namespace lmdb
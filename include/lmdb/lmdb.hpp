@@ -1,11 +1,24 @@
 #pragma once
 
 #include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iterator>
 #include <limits>
+#include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "lmdb.h"
 #include "lmdb/enum_helper.h"
@@ -148,6 +161,14 @@ ENUM_FLAGS(put_flags){
     // after call: param[1].mv_size = number of elements written
     MULTIPLE = 0x80000};
 
+// kernel readahead for the pages of a database (see txn::set_access)
+enum class access_pattern : unsigned {
+  DEFAULT = 0U,  // env policy (env_open_flags::NORDAHEAD or OS default)
+  NORMAL = 1U,  // OS default readahead, also with NORDAHEAD
+  RANDOM = 2U,  // no readahead: point lookups in DB > RAM
+  SEQUENTIAL = 3U  // aggressive readahead: scans
+};
+
 enum class cursor_op {
   FIRST,  // go to first entry
   FIRST_DUP,  // go to first entry of current key (DUPSORT)
@@ -172,6 +193,63 @@ enum class cursor_op {
   // duplicate entries (DUPFIXED)
 };
 
+// reader lock table entry, txnid_ is empty if the slot holds no snapshot
+struct reader_info {
+  int pid_;
+  std::size_t tid_;
+  std::optional<mdb_size_t> txnid_;
+};
+
+// reader over the limits of env::set_reaper
+struct lagging_reader {
+  int pid_;
+  std::size_t tid_;
+  mdb_size_t txnid_;
+  mdb_size_t lag_;  // last committed txnid - txnid_
+  std::chrono::milliseconds age_;  // time the reaper has seen txnid_
+  mdb_size_t pinned_pages_;  // freelist pages freed at or after txnid_
+};
+
+// returns true to evict the reader
+using reaper_fn = std::function<bool(lagging_reader const&)>;
+
+struct reaper_options {
+  std::chrono::milliseconds interval_{1'000};  // 0 stops the reaper
+  mdb_size_t max_lag_{0U};  // max. txns behind the last commit, 0: no limit
+  std::chrono::milliseconds max_age_{0};  // max. time on an old snapshot
+};
+
+struct dbi_metrics {
+  std::string name_;  // empty for the main database
+  MDB_stat stat_;  // ms_depth, ms_overflow_pages, ...
+};
+
+struct env_metrics {
+  // share of the map in use: (last pgno + 1) / number of pages in the map
+  double map_utilization() const {
+    auto const pages = info_.me_mapsize / page_size_;
+    return pages == 0U ? 0.0
+                       : static_cast<double>(info_.me_last_pgno + 1U) /
+                             static_cast<double>(pages);
+  }
+
+  MDB_envinfo info_;
+  unsigned page_size_;
+  // pages recorded in the freelist, with those readers still use
+  mdb_size_t free_pages_;
+  std::vector<dbi_metrics> dbis_;  // main database first
+  std::vector<reader_info> readers_;
+
+  // last committed txnid - snapshot txnid of the oldest active reader
+  // (readers pin the pages freed after their snapshot)
+  std::optional<mdb_size_t> oldest_reader_lag_;
+};
+
+struct copy_options {
+  bool compact_{false};  // omit free pages and renumber all pages
+  unsigned threads_{1U};  // > 1: compacting copy split among threads
+};
+
 struct env final {
   env() : env_{nullptr} { ex(mdb_env_create(&env_)); }
 
@@ -180,10 +258,25 @@ struct env final {
     env_ = nullptr;
   }
 
-  env(env&& e) noexcept : env_{e.env_} { e.env_ = nullptr; }
+  env(env&& e) noexcept
+      : env_{e.env_},
+        is_open_{e.is_open_},
+        growth_factor_{e.growth_factor_},
+        max_mapsize_{e.max_mapsize_},
+        reaper_{std::move(e.reaper_)} {
+    e.env_ = nullptr;
+  }
 
   env& operator=(env&& e) noexcept {
+    if (this == &e) {
+      return *this;
+    }
+    mdb_env_close(env_);  // stops its reaper before reaper_ is replaced
     env_ = e.env_;
+    is_open_ = e.is_open_;
+    growth_factor_ = e.growth_factor_;
+    max_mapsize_ = e.max_mapsize_;
+    reaper_ = std::move(e.reaper_);
     e.env_ = nullptr;
     return *this;
   }
@@ -201,6 +294,43 @@ struct env final {
   void set_mapsize(mdb_size_t size) { ex(mdb_env_set_mapsize(env_, size)); }
   void set_maxdbs(MDB_dbi dbs) { ex(mdb_env_set_maxdbs(env_, dbs)); }
 
+  // dirty pages a write transaction keeps in memory before spilling
+  // pages to the file early (default 131071, 512 MiB with 4 KiB pages)
+  // not while a write transaction is active
+  void set_max_dirty_pages(unsigned pages) {
+    ex(mdb_env_set_maxdirty(env_, pages));
+  }
+
+  unsigned get_max_dirty_pages() {
+    auto pages = 0U;
+    ex(mdb_env_get_maxdirty(env_, &pages));
+    return pages;
+  }
+
+  // pages below this number written and freed after the snapshot of a
+  // long-lived reader are reused, at 4 bytes of memory per page
+  // (default 262144, 0 = off), not while a write transaction is active
+  void set_max_gap_pages(unsigned pages) {
+    ex(mdb_env_set_maxgap(env_, pages));
+  }
+
+  // spill counters of all write transactions since the env was created
+  MDB_spillstat spill_stat() {
+    auto stat = MDB_spillstat{};
+    ex(mdb_env_spill_stat(env_, &stat));
+    return stat;
+  }
+
+  // commit writes through an io_uring with the given queue depth (0: off)
+  // returns false if io_uring is unavailable, commits then use writev
+  bool set_uring(unsigned depth) {
+    auto const rc = mdb_env_set_uring(env_, depth);
+    if (rc == EINVAL) {
+      ex(rc);
+    }
+    return depth != 0U && rc == MDB_SUCCESS;
+  }
+
   env_open_flags get_flags() {
     unsigned int flags;
     ex(mdb_env_get_flags(env_, &flags));
@@ -213,13 +343,136 @@ struct env final {
     return stat;
   }
 
+  MDB_envinfo info() {
+    auto info = MDB_envinfo{};
+    ex(mdb_env_info(env_, &info));
+    return info;
+  }
+
+  std::vector<reader_info> readers() {
+    auto readers = std::vector<reader_info>{};
+    ex(mdb_reader_each(
+        env_,
+        [](MDB_reader_info const* r, void* ctx) {
+          static_cast<std::vector<reader_info>*>(ctx)->push_back(
+              {r->rd_pid, r->rd_tid,
+               r->rd_txnid == static_cast<mdb_size_t>(-1)
+                   ? std::nullopt
+                   : std::optional{r->rd_txnid}});
+          return 0;
+        },
+        &readers));
+    return readers;
+  }
+
+  // clears the reader slots of dead processes, returns their number
+  int reader_check() {
+    auto dead = 0;
+    ex(mdb_reader_check(env_, &dead));
+    return dead;
+  }
+
+  // checks the reader table from a background thread (on an open env)
+  // fn runs on that thread for readers over the limits, true evicts one:
+  // its snapshot is released and its next get throws MDB_BAD_TXN
+  // only evict readers that do not use the database or its data anymore
+  void set_reaper(reaper_options const& opt, reaper_fn fn = {}) {
+    auto f = fn ? std::make_unique<reaper_fn>(std::move(fn)) : nullptr;
+    ex(mdb_env_set_reaper(env_, static_cast<unsigned>(opt.interval_.count()),
+                          opt.max_lag_,
+                          static_cast<unsigned>(opt.max_age_.count()),
+                          f ? &on_lagging_reader : nullptr, f.get()));
+    reaper_ = std::move(f);  // the previous fn is not called anymore
+  }
+
+  // snapshot of map usage, freelist, all databases and the reader table
+  // uses a read-only transaction: without NOTLS, the calling thread must
+  // not have an active read transaction on this env
+  env_metrics metrics();
+
+  // copies the environment to path (a file with NOSUBDIR, else a directory)
+  // without a lock file, the target file must not exist yet
+  void copy(char const* path, copy_options const& opt = {}) {
+    ex(mdb_env_copy3(env_, path, opt.compact_ ? MDB_CP_COMPACT : 0U,
+                     opt.threads_));
+  }
+
+  // moves pages from the end of the file to free pages below and
+  // truncates the file (not on Windows or with WRITEMAP), in write
+  // transactions of at most max_pages pages
+  // returns the number of pages the data shrank by
+  // a reader of an old snapshot keeps the pages it may use
+  mdb_size_t shrink(unsigned max_pages = 1'024U) {
+    auto released = mdb_size_t{0U};
+    ex(mdb_env_shrink(env_, max_pages, &released));
+    return released;
+  }
+
   void sync() { ex(mdb_env_sync(env_, 0)); }
   void force_sync() { ex(mdb_env_sync(env_, 1)); }
+  // waits for the last txn::commit_async() to be durable
+  void commit_wait() { ex(mdb_env_commit_wait(env_)); }
 
   bool is_open() const { return is_open_; }
 
+  // env::write grows the map by factor (> 1) up to max_size bytes and
+  // retries the transaction if it fails with MDB_MAP_FULL
+  // like set_mapsize: no other transactions may be active in this process
+  void set_map_growth(double const factor, mdb_size_t const max_size) {
+    growth_factor_ = factor;
+    max_mapsize_ = max_size;
+  }
+
+  // runs fn(txn&) in a write transaction and commits it
+  // MDB_MAP_FULL: grows the map (see set_map_growth) and reruns fn
+  // MDB_MAP_RESIZED (map grown by another process): adopts the new size
+  template <typename Fn>
+  auto write(Fn&& fn, txn_flags flags = txn_flags::NONE);
+
+  // adapts the map size after a failed transaction, true = retry
+  bool grow_map(std::error_code const& ec) {
+    if (ec.category() != error_category()) {
+      return false;
+    }
+
+    if (ec.value() == MDB_MAP_RESIZED) {
+      set_mapsize(0U);
+      return true;
+    }
+
+    if (ec.value() != MDB_MAP_FULL || growth_factor_ <= 1.0) {
+      return false;
+    }
+
+    auto info = MDB_envinfo{};
+    ex(mdb_env_info(env_, &info));
+    if (info.me_mapsize >= max_mapsize_) {
+      return false;
+    }
+
+    auto const grown = static_cast<mdb_size_t>(
+        static_cast<double>(info.me_mapsize) * growth_factor_);
+    set_mapsize(std::min(std::max(grown, info.me_mapsize + 1U), max_mapsize_));
+    return true;
+  }
+
+  static int on_lagging_reader(MDB_reaper_info const* r, void* ctx) {
+    try {
+      auto const& fn = *static_cast<reaper_fn*>(ctx);
+      return fn({r->ri_pid, r->ri_tid, r->ri_txnid, r->ri_lag,
+                 std::chrono::milliseconds{r->ri_age}, r->ri_pinned})
+                 ? 1
+                 : 0;
+    } catch (...) {
+      return 0;  // keep the reader
+    }
+  }
+
   MDB_env* env_;
   bool is_open_ = false;
+  double growth_factor_{0.0};
+  mdb_size_t max_mapsize_{0U};
+  std::unique_ptr<reaper_fn> reaper_;
 };
 
 template <typename T>
@@ -250,6 +503,69 @@ inline T as_int(std::string_view s) {
   return t;
 }
 
+// minimal std::span replacement (the library targets C++17)
+template <typename T>
+struct span {
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using iterator = T*;
+
+  constexpr span() = default;
+  constexpr span(T* data, std::size_t size) : data_{data}, size_{size} {}
+
+  template <typename Container,
+            typename = std::enable_if_t<std::is_convertible_v<
+                decltype(std::data(std::declval<Container&>())), T*>>>
+  constexpr span(Container& c)  // NOLINT
+      : data_{std::data(c)}, size_{std::size(c)} {}
+
+  template <typename U,
+            typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+  constexpr span(span<U> const& s)  // NOLINT
+      : data_{s.data()}, size_{s.size()} {}
+
+  constexpr T* data() const { return data_; }
+  constexpr std::size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0U; }
+  constexpr T& operator[](std::size_t const i) const { return data_[i]; }
+  constexpr T* begin() const { return data_; }
+  constexpr T* end() const { return data_ + size_; }
+
+  T* data_{nullptr};
+  std::size_t size_{0U};
+};
+
+// stores n items of size bytes each as data items of key (MDB_MULTIPLE)
+// one leaf page of items per call: a single call for the whole set would
+// make mdb_page_spill reserve dirty list room for all items at once
+inline void put_multiple(MDB_cursor* c, MDB_val* k, void const* data,
+                         std::size_t const size, std::size_t const n,
+                         unsigned const flags) {
+  auto stat = MDB_stat{};
+  ex(mdb_env_stat(mdb_txn_env(mdb_cursor_txn(c)), &stat));
+  auto const per_page = std::max(std::size_t{stat.ms_psize} / size,
+                                 std::size_t{1U});
+  for (auto written = std::size_t{0U}; written < n;) {
+    MDB_val v[2] = {  // NOLINT
+        {size, const_cast<char*>(static_cast<char const*>(data)) +  // NOLINT
+                   written * size},
+        {std::min(per_page, n - written), nullptr}};
+    auto const ec = mdb_cursor_put(c, k, v, flags | MDB_MULTIPLE);
+    written += v[1].mv_size;  // partial writes are reported in v[1]
+    ex(ec);
+  }
+}
+
+// MDB_RESERVE is not supported for DUPSORT databases (the data items
+// have to be known for sorting)
+inline void check_reserve(MDB_txn* txn, MDB_dbi const dbi) {
+  auto flags = 0U;
+  ex(mdb_dbi_flags(txn, dbi, &flags));
+  if ((flags & MDB_DUPSORT) != 0U) {
+    throw std::system_error{error::make_error_code(MDB_INCOMPATIBLE)};
+  }
+}
+
 struct txn final {
   struct dbi final {
     dbi(MDB_txn* txn, char const* name, dbi_flags const flags)
@@ -309,6 +625,18 @@ struct txn final {
     mdb_txn_commit(txn_);
   }
 
+  // returns once the pages are written, the future is ready once the
+  // commit is durable and visible to readers (see mdb_txn_commit_async)
+  std::future<void> commit_async() {
+    auto p = std::make_unique<std::promise<void>>();
+    auto f = p->get_future();
+    auto const ec = mdb_txn_commit_async(txn_, &on_durable, p.get());
+    committed_ = ec != EINVAL;  // else the txn is still alive
+    ex(ec);
+    p.release();  // owned by on_durable
+    return f;
+  }
+
   void clear() {
     mdb_txn_reset(txn_);
     ex(mdb_txn_renew(txn_));
@@ -329,6 +657,21 @@ struct txn final {
     is_write_ = true;
   }
 
+  // custom order of keys / DUPSORT data items (see typed_dbi)
+  // has to be set before the first access, by every user of the database
+  void set_compare(dbi const& db, MDB_cmp_func* cmp) {
+    ex(mdb_set_compare(txn_, db.dbi_, cmp));
+  }
+  void set_dupsort(dbi const& db, MDB_cmp_func* cmp) {
+    ex(mdb_set_dupsort(txn_, db.dbi_, cmp));
+  }
+
+  // readahead policy for the pages cursors on the database read
+  // like set_compare, set it before other threads use the database
+  void set_access(dbi const& db, access_pattern const access) {
+    ex(mdb_set_access(txn_, db.dbi_, static_cast<unsigned>(access)));
+  }
+
   template <typename T>
   void put(dbi& dbi, T key, std::string_view value,
            put_flags const flags = put_flags::NONE) {
@@ -354,6 +697,37 @@ struct txn final {
     }
   }
 
+  // reserves size bytes for the value of key and returns the space to be
+  // filled, e.g. by serializing directly into the map (throws for DUPSORT)
+  // valid until the next update operation or the end of the transaction
+  template <typename T>
+  span<std::byte> reserve(dbi& dbi, T key, std::size_t const size,
+                          put_flags const flags = put_flags::NONE) {
+    check_reserve(txn_, dbi.dbi_);
+    auto k = to_mdb_val(key);
+    auto v = MDB_val{size, nullptr};
+    ex(mdb_put(txn_, dbi.dbi_, &k, &v,
+               static_cast<unsigned>(flags | put_flags::RESERVE)));
+    is_write_ = true;
+    return {static_cast<std::byte*>(v.mv_data), v.mv_size};
+  }
+
+  // stores values as data items of key (DUPFIXED, items of sizeof(T))
+  template <typename T, typename Key>
+  void put_multiple(dbi& dbi, Key key, span<T const> values,
+                    put_flags const flags = put_flags::NONE) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    MDB_cursor* c = nullptr;
+    ex(mdb_cursor_open(txn_, dbi.dbi_, &c));
+    auto const close =
+        std::unique_ptr<MDB_cursor, decltype(&mdb_cursor_close)>{
+            c, &mdb_cursor_close};
+    auto k = to_mdb_val(key);
+    is_write_ = true;
+    lmdb::put_multiple(c, &k, values.data(), sizeof(T), values.size(),
+                       static_cast<unsigned>(flags));
+  }
+
   template <typename T>
   std::optional<std::string_view> get(dbi& dbi, T key) {
     auto k = to_mdb_val(key);
@@ -366,6 +740,49 @@ struct txn final {
     }
   }
 
+  // point lookups for a batch of keys, out[i] is the result for keys[i]
+  // keys are looked up in database order with a single cursor: keys on the
+  // current leaf skip the tree descent, keys on a nearby leaf restart the
+  // descent from the lowest common branch page instead of the root
+  template <typename Keys>
+  void get_many(dbi& dbi, Keys const& keys,
+                span<std::optional<std::string_view>> out) {
+    auto const n = std::size(keys);
+    assert(out.size() >= n);
+
+    auto vals = std::vector<MDB_val>(n);
+    auto order = std::vector<std::size_t>(n);
+    for (auto i = std::size_t{0U}; i != n; ++i) {
+      vals[i] = to_mdb_val(std::data(keys)[i]);
+      order[i] = i;
+    }
+    std::sort(begin(order), end(order), [&](std::size_t a, std::size_t b) {
+      return mdb_cmp(txn_, dbi.dbi_, &vals[a], &vals[b]) < 0;
+    });
+
+    MDB_cursor* c = nullptr;
+    ex(mdb_cursor_open(txn_, dbi.dbi_, &c));
+    auto const close =
+        std::unique_ptr<MDB_cursor, decltype(&mdb_cursor_close)>{
+            c, &mdb_cursor_close};
+    for (auto const i : order) {
+      auto v = MDB_val{0, nullptr};
+      switch (auto const ec = mdb_cursor_get(c, &vals[i], &v, MDB_SET); ec) {
+        case MDB_SUCCESS: out[i] = from_mdb_val(v); break;
+        case MDB_NOTFOUND: out[i] = std::nullopt; break;
+        default: throw std::system_error{error::make_error_code(ec)};
+      }
+    }
+  }
+
+  template <typename Keys>
+  std::vector<std::optional<std::string_view>> get_many(dbi& dbi,
+                                                        Keys const& keys) {
+    auto out = std::vector<std::optional<std::string_view>>(std::size(keys));
+    get_many(dbi, keys, out);
+    return out;
+  }
+
   template <typename T>
   bool del(dbi& dbi, T key) {
     auto k = to_mdb_val(key);
@@ -388,11 +805,270 @@ struct txn final {
     }
   }
 
+  static void on_durable(void* ctx, mdb_size_t, int const rc) {
+    auto const p = std::unique_ptr<std::promise<void>>{
+        static_cast<std::promise<void>*>(ctx)};
+    if (rc == MDB_SUCCESS) {
+      p->set_value();
+    } else {
+      p->set_exception(std::make_exception_ptr(
+          std::system_error{error::make_error_code(rc)}));
+    }
+  }
+
   bool committed_{false};
   bool is_write_{false};
   MDB_txn* txn_{nullptr};
 };
 
+template <typename Fn>
+auto env::write(Fn&& fn, txn_flags const flags) {
+  while (true) {
+    try {
+      auto t = txn{*this, flags};
+      if constexpr (std::is_void_v<std::invoke_result_t<Fn&, txn&>>) {
+        fn(t);
+        t.committed_ = true;
+        ex(mdb_txn_commit(t.txn_));
+        return;
+      } else {
+        auto result = fn(t);
+        t.committed_ = true;
+        ex(mdb_txn_commit(t.txn_));
+        return result;
+      }
+    } catch (std::system_error const& e) {
+      if (!grow_map(e.code())) {
+        throw;
+      }
+    }
+  }
+}
+
+// bottom-up bulk load of an empty (non-DUPSORT) database: keys have to be
+// put in ascending order, pages are packed up to fill_percent and written
+// directly to the data file (see mdb_build_begin)
+// finish() installs the tree, committing the transaction makes it durable
+struct bulk_builder final {
+  bulk_builder(txn& t, txn::dbi& dbi, unsigned const fill_percent = 100U)
+      : txn_{&t} {
+    ex(mdb_build_begin(t.txn_, dbi.dbi_, fill_percent, &build_));
+  }
+
+  bulk_builder(bulk_builder&& o) noexcept : txn_{o.txn_}, build_{o.build_} {
+    o.build_ = nullptr;
+  }
+
+  bulk_builder& operator=(bulk_builder&& o) noexcept {
+    mdb_build_abort(build_);
+    txn_ = o.txn_;
+    build_ = o.build_;
+    o.build_ = nullptr;
+    return *this;
+  }
+
+  bulk_builder(bulk_builder const&) = delete;
+  bulk_builder& operator=(bulk_builder const&) = delete;
+
+  ~bulk_builder() { mdb_build_abort(build_); }
+
+  template <typename T>
+  void put(T key, std::string_view value) {
+    auto k = to_mdb_val(key);
+    auto v = to_mdb_val(value);
+    ex(mdb_build_put(build_, &k, &v));
+  }
+
+  void finish() {
+    auto const b = build_;
+    build_ = nullptr;
+    ex(mdb_build_end(b));
+    txn_->is_write_ = true;
+  }
+
+  txn* txn_;
+  MDB_build* build_{nullptr};
+};
+
+// bound policies for cursor_range: contains(key) == false ends the iteration
+struct no_bound {
+  static constexpr bool contains(MDB_val const&) { return true; }
+};
+
+// keys < end_ as ordered by the compare function of the database
+template <typename T>
+struct key_bound {
+  bool contains(MDB_val const& k) const {
+    auto const end = to_mdb_val(end_);
+    return mdb_cmp(txn_, dbi_, &k, &end) < 0;
+  }
+
+  MDB_txn* txn_;
+  MDB_dbi dbi_;
+  T end_;
+};
+
+// keys starting with prefix_ (byte-wise, i.e. default compare function)
+struct prefix_bound {
+  bool contains(MDB_val const& k) const {
+    return prefix_.empty() ||
+           (k.mv_size >= prefix_.size() &&
+            std::memcmp(k.mv_data, prefix_.data(), prefix_.size()) == 0);
+  }
+
+  std::string_view prefix_;
+};
+
+// range over [begin(), end()) of a cursor, usable in range-based for loops
+// each step is exactly one mdb_cursor_get call + one bound check
+// begin() (re-)positions the underlying cursor
+// decrementing the past-the-end iterator is not supported
+template <typename Key, typename Bound>
+struct cursor_range {
+  using value_type = std::pair<std::string_view, std::string_view>;
+
+  struct sentinel {};
+
+  struct iterator {
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = cursor_range::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type const*;
+    using reference = value_type const&;
+
+    reference operator*() const { return entry_; }
+    pointer operator->() const { return &entry_; }
+
+    iterator& operator++() {
+      auto k = MDB_val{};
+      step(r_->next_op_, &k);
+      return *this;
+    }
+
+    iterator& operator--() {
+      auto k = MDB_val{};
+      step(r_->prev_op_, &k);
+      return *this;
+    }
+
+    friend bool operator==(iterator const& it, sentinel) { return it.end_; }
+    friend bool operator!=(iterator const& it, sentinel) { return !it.end_; }
+    friend bool operator==(sentinel, iterator const& it) { return it.end_; }
+    friend bool operator!=(sentinel, iterator const& it) { return !it.end_; }
+
+    void step(MDB_cursor_op const op, MDB_val* k) {
+      auto v = MDB_val{};
+      if (auto const ec = mdb_cursor_get(r_->cursor_, k, &v, op);
+          ec != MDB_SUCCESS) {
+        end_ = true;
+        if (ec != MDB_NOTFOUND) {
+          throw std::system_error{error::make_error_code(ec)};
+        }
+        return;
+      }
+      end_ = !r_->bound_.contains(*k);
+      entry_ = {from_mdb_val(*k), from_mdb_val(v)};
+    }
+
+    cursor_range const* r_;
+    value_type entry_{};
+    bool end_{false};
+  };
+
+  iterator begin() const {
+    auto it = iterator{this};
+    auto k = to_mdb_val(from_);
+    it.step(first_op_, &k);
+    return it;
+  }
+
+  sentinel end() const { return {}; }
+
+  MDB_cursor* cursor_;
+  MDB_cursor_op first_op_, next_op_, prev_op_;
+  Key from_;
+  Bound bound_;
+};
+
+// fixed-size data items of one key (DUPFIXED), one leaf page per step
+// chunks point into the map; duplicates stored inline in the leaf node
+// (small sets) are copied into an aligned buffer if they are misaligned
+template <typename T, typename Key>
+struct dup_page_range {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  struct sentinel {};
+
+  struct iterator {
+    using iterator_category = std::input_iterator_tag;
+    using value_type = span<T const>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type const*;
+    using reference = value_type const&;
+
+    reference operator*() const { return chunk_; }
+    pointer operator->() const { return &chunk_; }
+
+    iterator& operator++() {
+      auto k = MDB_val{};
+      auto v = MDB_val{};
+      step(MDB_NEXT_MULTIPLE, &k, &v);
+      return *this;
+    }
+
+    friend bool operator==(iterator const& it, sentinel) { return it.end_; }
+    friend bool operator!=(iterator const& it, sentinel) { return !it.end_; }
+    friend bool operator==(sentinel, iterator const& it) { return it.end_; }
+    friend bool operator!=(sentinel, iterator const& it) { return !it.end_; }
+
+    void step(MDB_cursor_op const op, MDB_val* k, MDB_val* v) {
+      if (auto const ec = mdb_cursor_get(cursor_, k, v, op);
+          ec != MDB_SUCCESS) {
+        end_ = true;
+        if (ec != MDB_NOTFOUND) {
+          throw std::system_error{error::make_error_code(ec)};
+        }
+        return;
+      }
+
+      auto const n = v->mv_size / sizeof(T);
+      if (reinterpret_cast<std::uintptr_t>(v->mv_data) % alignof(T) == 0U) {
+        chunk_ = {static_cast<T const*>(v->mv_data), n};
+      } else {
+        buf_.resize(n);
+        std::memcpy(buf_.data(), v->mv_data, n * sizeof(T));
+        chunk_ = {buf_.data(), n};
+      }
+    }
+
+    MDB_cursor* cursor_;
+    value_type chunk_{};
+    std::vector<T> buf_{};
+    bool end_{false};
+  };
+
+  iterator begin() const {
+    auto it = iterator{cursor_};
+    auto k = to_mdb_val(key_);
+    auto v = MDB_val{};
+    it.step(MDB_SET, &k, &v);
+    if (it.end_) {
+      return it;
+    }
+    if (v.mv_size != sizeof(T)) {
+      throw std::system_error{error::make_error_code(MDB_BAD_VALSIZE)};
+    }
+    // GET_MULTIPLE leaves v untouched for a key with a single data item
+    it.step(MDB_GET_MULTIPLE, &k, &v);
+    return it;
+  }
+
+  sentinel end() const { return {}; }
+
+  MDB_cursor* cursor_;
+  Key key_;
+};
+
 struct cursor final {
   using opt_entry =
       std::optional<std::pair<std::string_view, std::string_view>>;
@@ -431,6 +1107,16 @@ struct cursor final {
 
   void renew(txn& t) { ex(mdb_cursor_renew(t.txn_, cursor_)); }
 
+  // read ahead this many leaf pages (0 = off) when a scan changes leaves
+  void set_prefetch(unsigned const depth) {
+    ex(mdb_cursor_prefetch(cursor_, depth));
+  }
+
+  // overrides the readahead policy of the database (see txn::set_access)
+  void set_access(access_pattern const access) {
+    ex(mdb_cursor_access(cursor_, static_cast<unsigned>(access)));
+  }
+
   template <int N>
   opt_entry get(cursor_op const op, char const (&s)[N]) {
     auto k = to_mdb_val<N>(s);
@@ -491,6 +1177,30 @@ struct cursor final {
     txn_->is_write_ = true;
   }
 
+  // see txn::reserve
+  template <typename T>
+  span<std::byte> reserve(T key, std::size_t const size,
+                          put_flags const flags = put_flags::NONE) {
+    check_reserve(mdb_cursor_txn(cursor_), mdb_cursor_dbi(cursor_));
+    auto k = to_mdb_val(key);
+    auto v = MDB_val{size, nullptr};
+    ex(mdb_cursor_put(cursor_, &k, &v,
+                      static_cast<unsigned>(flags | put_flags::RESERVE)));
+    txn_->is_write_ = true;
+    return {static_cast<std::byte*>(v.mv_data), v.mv_size};
+  }
+
+  // stores values as data items of key (DUPFIXED, items of sizeof(T))
+  template <typename T, typename Key>
+  void put_multiple(Key key, span<T const> values,
+                    put_flags const flags = put_flags::NONE) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    auto k = to_mdb_val(key);
+    txn_->is_write_ = true;
+    lmdb::put_multiple(cursor_, &k, values.data(), sizeof(T), values.size(),
+                       static_cast<unsigned>(flags));
+  }
+
   void del() {
     ex(mdb_cursor_del(cursor_, 0));
     txn_->is_write_ = true;
@@ -501,6 +1211,63 @@ struct cursor final {
     txn_->is_write_ = true;
   }
 
+  // entries with from <= key < to; empty from: start at the first key
+  cursor_range<std::string_view, key_bound<std::string_view>> range(
+      std::string_view from, std::string_view to) {
+    return {cursor_,
+            from.empty() ? MDB_FIRST : MDB_SET_RANGE,
+            MDB_NEXT,
+            MDB_PREV,
+            from,
+            {mdb_cursor_txn(cursor_), mdb_cursor_dbi(cursor_), to}};
+  }
+
+  template <typename T>
+  std::enable_if_t<std::is_integral_v<T>, cursor_range<T, key_bound<T>>> range(
+      T from, T to) {
+    return {cursor_,
+            MDB_SET_RANGE,
+            MDB_NEXT,
+            MDB_PREV,
+            from,
+            {mdb_cursor_txn(cursor_), mdb_cursor_dbi(cursor_), to}};
+  }
+
+  // entries with from <= key
+  cursor_range<std::string_view, no_bound> range(std::string_view from = {}) {
+    return {cursor_, from.empty() ? MDB_FIRST : MDB_SET_RANGE,
+            MDB_NEXT, MDB_PREV, from, {}};
+  }
+
+  // entries with keys starting with p
+  cursor_range<std::string_view, prefix_bound> prefix(std::string_view p) {
+    return {cursor_, p.empty() ? MDB_FIRST : MDB_SET_RANGE,
+            MDB_NEXT, MDB_PREV, p, {p}};
+  }
+
+  // all data items of key (DUPSORT)
+  cursor_range<std::string_view, no_bound> dups(std::string_view key) {
+    return {cursor_, MDB_SET_KEY, MDB_NEXT_DUP, MDB_PREV_DUP, key, {}};
+  }
+
+  template <typename T>
+  std::enable_if_t<std::is_integral_v<T>, cursor_range<T, no_bound>> dups(
+      T key) {
+    return {cursor_, MDB_SET_KEY, MDB_NEXT_DUP, MDB_PREV_DUP, key, {}};
+  }
+
+  // data items of key as spans of T, one leaf page per chunk (DUPFIXED)
+  template <typename T>
+  dup_page_range<T, std::string_view> dup_pages(std::string_view key) {
+    return {cursor_, key};
+  }
+
+  template <typename T, typename Key>
+  std::enable_if_t<std::is_integral_v<Key>, dup_page_range<T, Key>> dup_pages(
+      Key key) {
+    return {cursor_, key};
+  }
+
   mdb_size_t count() {
     mdb_size_t n;
     ex(mdb_cursor_count(cursor_, &n));
@@ -515,4 +1282,55 @@ struct cursor final {
   MDB_cursor* cursor_;
 };
 
+inline env_metrics env::metrics() {
+  auto m = env_metrics{};
+  {
+    auto t = txn{*this, txn_flags::RDONLY};
+    auto main = t.dbi_open();
+    m.dbis_.push_back({"", main.stat()});
+
+    // named databases are records of the main database, read without
+    // opening a handle for each of them
+    auto c = cursor{t, main};
+    for (auto el = c.get(cursor_op::FIRST); el; el = c.get(cursor_op::NEXT)) {
+      auto stat = MDB_stat{};
+      auto const ec = mdb_cursor_dbstat(c.cursor_, &stat);
+      if (ec == MDB_INCOMPATIBLE) {  // plain record
+        continue;
+      }
+      ex(ec);
+      m.dbis_.push_back({std::string{el->first}, stat});
+    }
+
+    // freelist records: txnid -> IDL of freed pages (count first)
+    MDB_cursor* fc = nullptr;
+    ex(mdb_cursor_open(t.txn_, 0U /* FREE_DBI */, &fc));
+    auto const close =
+        std::unique_ptr<MDB_cursor, decltype(&mdb_cursor_close)>{
+            fc, &mdb_cursor_close};
+    auto k = MDB_val{}, v = MDB_val{};
+    auto ec = mdb_cursor_get(fc, &k, &v, MDB_FIRST);
+    for (m.free_pages_ = 0U; ec == MDB_SUCCESS;
+         ec = mdb_cursor_get(fc, &k, &v, MDB_NEXT)) {
+      auto n = mdb_size_t{0U};
+      std::memcpy(&n, v.mv_data, std::min(v.mv_size, sizeof(n)));
+      m.free_pages_ += n;
+    }
+    if (ec != MDB_NOTFOUND) {
+      ex(ec);
+    }
+  }  // our reader slot must not show up below
+
+  m.info_ = info();
+  m.page_size_ = stat().ms_psize;
+  m.readers_ = readers();
+  for (auto const& r : m.readers_) {
+    if (r.txnid_.has_value() && *r.txnid_ <= m.info_.me_last_txnid) {
+      auto const lag = m.info_.me_last_txnid - *r.txnid_;
+      m.oldest_reader_lag_ = std::max(m.oldest_reader_lag_.value_or(0U), lag);
+    }
+  }
+  return m;
+}
+
 }  // namespace lmdb
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lmdb/lmdb.hpp"
+
+namespace lmdb {
+
+// keeps reset read-only transactions (and their cursors) per thread
+// acquire() renews one (mdb_txn_renew), the lease resets it on release
+// (mdb_txn_reset): no malloc and no reader table mutex after the first use
+// cursors from lease::get_cursor are cached per DBI and renewed lazily
+//
+// the pool has to outlive its leases
+// without NOTLS, a thread can hold only one lease per env at a time
+struct read_txn_pool final {
+  struct cached_cursor {
+    MDB_dbi dbi_;
+    cursor cursor_;
+    std::uint64_t generation_;
+  };
+
+  struct handle {
+    std::optional<txn> txn_;
+    std::deque<cached_cursor> cursors_;  // stable references
+    std::uint64_t generation_{0U};
+    bool active_{false};
+  };
+
+  struct lease final {
+    explicit lease(handle* h) : h_{h} {}
+
+    lease(lease&& o) noexcept : h_{o.h_} { o.h_ = nullptr; }
+    lease& operator=(lease&& o) noexcept {
+      release();
+      h_ = o.h_;
+      o.h_ = nullptr;
+      return *this;
+    }
+
+    lease(lease const&) = delete;
+    lease& operator=(lease const&) = delete;
+
+    ~lease() { release(); }
+
+    txn& get() const { return *h_->txn_; }
+    txn& operator*() const { return *h_->txn_; }
+    txn* operator->() const { return &*h_->txn_; }
+
+    // cursor on dbi, valid until the lease is released
+    cursor& get_cursor(txn::dbi& dbi) {
+      auto const it = std::find_if(
+          begin(h_->cursors_), end(h_->cursors_),
+          [&](cached_cursor const& c) { return c.dbi_ == dbi.dbi_; });
+      if (it == end(h_->cursors_)) {
+        return h_->cursors_
+            .emplace_back(cached_cursor{dbi.dbi_, cursor{get(), dbi},
+                                        h_->generation_})
+            .cursor_;
+      }
+      if (it->generation_ != h_->generation_) {
+        it->cursor_.renew(get());
+        it->generation_ = h_->generation_;
+      }
+      return it->cursor_;
+    }
+
+    void release() {
+      if (h_ != nullptr) {
+        mdb_txn_reset(h_->txn_->txn_);
+        h_->active_ = false;
+        h_ = nullptr;
+      }
+    }
+
+    handle* h_;
+  };
+
+  explicit read_txn_pool(env& e) : env_{e} {}
+
+  read_txn_pool(read_txn_pool const&) = delete;
+  read_txn_pool& operator=(read_txn_pool const&) = delete;
+  read_txn_pool(read_txn_pool&&) = delete;
+  read_txn_pool& operator=(read_txn_pool&&) = delete;
+
+  ~read_txn_pool() = default;
+
+  lease acquire() {
+    auto& handles = thread_handles();
+    auto const it = std::find_if(
+        begin(handles), end(handles),
+        [](std::unique_ptr<handle> const& h) { return !h->active_; });
+
+    auto h = static_cast<handle*>(nullptr);
+    if (it == end(handles)) {
+      auto created = std::make_unique<handle>();
+      created->txn_.emplace(env_, txn_flags::RDONLY);
+      h = handles.emplace_back(std::move(created)).get();
+    } else {
+      h = it->get();
+      ex(mdb_txn_renew(h->txn_->txn_));
+    }
+
+    h->active_ = true;
+    ++h->generation_;
+    return lease{h};
+  }
+
+private:
+  // handles of the calling thread, the last used pool is cached per thread
+  std::vector<std::unique_ptr<handle>>& thread_handles() {
+    struct last_pool {
+      std::uint64_t id_;
+      std::vector<std::unique_ptr<handle>>* handles_;
+    };
+    thread_local auto last = last_pool{0U, nullptr};
+    if (last.id_ != id_) {
+      auto const lock = std::lock_guard{mutex_};
+      last = {id_, &handles_[std::this_thread::get_id()]};
+    }
+    return *last.handles_;
+  }
+
+  static std::uint64_t next_id() {
+    static auto id = std::atomic_uint64_t{0U};
+    return ++id;
+  }
+
+  env& env_;
+  std::uint64_t const id_{next_id()};
+  std::mutex mutex_;
+  std::unordered_map<std::thread::id, std::vector<std::unique_ptr<handle>>>
+      handles_;
+};
+
+}  // namespace lmdb
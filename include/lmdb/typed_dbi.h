@@ -0,0 +1,336 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "lmdb/lmdb.hpp"
+
+namespace lmdb {
+
+namespace detail {
+
+template <typename T>
+void write_big_endian(T const x, unsigned char* out) {
+  for (auto i = 0U; i != sizeof(T); ++i) {
+    out[i] = static_cast<unsigned char>(x >> (8U * (sizeof(T) - 1U - i)));
+  }
+}
+
+template <typename T>
+void read_big_endian(T& x, unsigned char const* in) {
+  x = T{0U};
+  for (auto i = 0U; i != sizeof(T); ++i) {
+    x = static_cast<T>((x << 8U) | in[i]);
+  }
+}
+
+template <typename T, typename = void>
+struct integer_key {
+  using type = T;
+};
+
+template <typename T>
+struct integer_key<T, std::enable_if_t<std::is_enum_v<T>>> {
+  using type = std::underlying_type_t<T>;
+};
+
+}  // namespace detail
+
+// unsigned integers LMDB sorts natively with INTEGERKEY (integer_order),
+// and enums with such an underlying type
+template <typename T, typename U = typename detail::integer_key<T>::type>
+constexpr auto const is_native_integer_key_v =
+    std::is_unsigned_v<U> &&
+    (sizeof(U) == sizeof(unsigned) || sizeof(U) == sizeof(mdb_size_t));
+
+// IEEE 754 floats with an order preserving codec
+template <typename T>
+constexpr auto const is_ordered_float_v =
+    std::is_floating_point_v<T> && std::numeric_limits<T>::is_iec559 &&
+    (sizeof(T) == sizeof(std::uint32_t) || sizeof(T) == sizeof(std::uint64_t));
+
+// byte representation of keys and values in a typed_dbi
+// default: object representation of trivially copyable types
+template <typename T, typename = void>
+struct codec {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  template <typename Fn>
+  static decltype(auto) with_val(T const& x, Fn&& fn) {
+    auto v = MDB_val{sizeof(T), const_cast<T*>(&x)};  // NOLINT
+    return fn(v);
+  }
+
+  static bool fits(MDB_val const& v) { return v.mv_size == sizeof(T); }
+
+  static T decode(MDB_val const& v) {
+    T x;
+    std::memcpy(&x, v.mv_data, sizeof(T));
+    return x;
+  }
+};
+
+template <>
+struct codec<std::string_view> {
+  template <typename Fn>
+  static decltype(auto) with_val(std::string_view const x, Fn&& fn) {
+    auto v = to_mdb_val(x);
+    return fn(v);
+  }
+
+  static constexpr bool fits(MDB_val const&) { return true; }
+
+  static std::string_view decode(MDB_val const& v) { return from_mdb_val(v); }
+};
+
+// other integers: big-endian with the sign bit flipped,
+// so memcmp_order sorts them numerically
+template <typename T>
+struct codec<T, std::enable_if_t<std::is_integral_v<T> &&
+                                 !std::is_same_v<T, bool> &&
+                                 !is_native_integer_key_v<T>>> {
+  using unsigned_t = std::make_unsigned_t<T>;
+
+  static constexpr auto const sign_bit =
+      std::is_signed_v<T> ? static_cast<unsigned_t>(unsigned_t{1U}
+                                                    << (8U * sizeof(T) - 1U))
+                          : unsigned_t{0U};
+
+  template <typename Fn>
+  static decltype(auto) with_val(T const x, Fn&& fn) {
+    auto buf = std::array<unsigned char, sizeof(T)>{};
+    detail::write_big_endian(
+        static_cast<unsigned_t>(static_cast<unsigned_t>(x) ^ sign_bit),
+        buf.data());
+    auto v = MDB_val{sizeof(T), buf.data()};
+    return fn(v);
+  }
+
+  static bool fits(MDB_val const& v) { return v.mv_size == sizeof(T); }
+
+  static T decode(MDB_val const& v) {
+    auto x = unsigned_t{0U};
+    detail::read_big_endian(x, static_cast<unsigned char const*>(v.mv_data));
+    return static_cast<T>(static_cast<unsigned_t>(x ^ sign_bit));
+  }
+};
+
+// floats: big-endian with the sign bit flipped, all bits for negative
+// values, so memcmp_order sorts them numerically (-0.0 before 0.0)
+template <typename T>
+struct codec<T, std::enable_if_t<is_ordered_float_v<T>>> {
+  using bits_t = std::conditional_t<sizeof(T) == sizeof(std::uint32_t),
+                                    std::uint32_t, std::uint64_t>;
+
+  static constexpr auto const sign_bit =
+      static_cast<bits_t>(bits_t{1U} << (8U * sizeof(T) - 1U));
+
+  template <typename Fn>
+  static decltype(auto) with_val(T const x, Fn&& fn) {
+    auto bits = bits_t{0U};
+    std::memcpy(&bits, &x, sizeof(T));
+    bits = (bits & sign_bit) != 0U ? static_cast<bits_t>(~bits)
+                                   : static_cast<bits_t>(bits ^ sign_bit);
+    auto buf = std::array<unsigned char, sizeof(T)>{};
+    detail::write_big_endian(bits, buf.data());
+    auto v = MDB_val{sizeof(T), buf.data()};
+    return fn(v);
+  }
+
+  static bool fits(MDB_val const& v) { return v.mv_size == sizeof(T); }
+
+  static T decode(MDB_val const& v) {
+    auto bits = bits_t{0U};
+    detail::read_big_endian(bits, static_cast<unsigned char const*>(v.mv_data));
+    bits = (bits & sign_bit) != 0U ? static_cast<bits_t>(bits ^ sign_bit)
+                                   : static_cast<bits_t>(~bits);
+    T x;
+    std::memcpy(&x, &bits, sizeof(T));
+    return x;
+  }
+};
+
+// enums: encoded as their underlying type
+template <typename T>
+struct codec<T, std::enable_if_t<std::is_enum_v<T>>> {
+  using underlying_t = std::underlying_type_t<T>;
+
+  template <typename Fn>
+  static decltype(auto) with_val(T const x, Fn&& fn) {
+    return codec<underlying_t>::with_val(static_cast<underlying_t>(x),
+                                         std::forward<Fn>(fn));
+  }
+
+  static bool fits(MDB_val const& v) { return codec<underlying_t>::fits(v); }
+
+  static T decode(MDB_val const& v) {
+    return static_cast<T>(codec<underlying_t>::decode(v));
+  }
+};
+
+// tuples of unsigned integers: big-endian, so memcmp_order sorts them
+// lexicographically by their elements
+template <typename... Ts>
+struct codec<std::tuple<Ts...>> {
+  static_assert((std::is_unsigned_v<Ts> && ...));
+
+  static constexpr auto const size = (sizeof(Ts) + ...);
+
+  template <typename Fn>
+  static decltype(auto) with_val(std::tuple<Ts...> const& x, Fn&& fn) {
+    auto buf = std::array<unsigned char, size>{};
+    auto pos = std::size_t{0U};
+    std::apply(
+        [&](auto const... el) {
+          ((detail::write_big_endian(el, &buf[pos]), pos += sizeof(el)),
+           ...);
+        },
+        x);
+    auto v = MDB_val{size, buf.data()};
+    return fn(v);
+  }
+
+  static bool fits(MDB_val const& v) { return v.mv_size == size; }
+
+  static std::tuple<Ts...> decode(MDB_val const& v) {
+    auto const* p = static_cast<unsigned char const*>(v.mv_data);
+    auto x = std::tuple<Ts...>{};
+    std::apply(
+        [&](auto&... el) {
+          ((detail::read_big_endian(el, p), p += sizeof(el)), ...);
+        },
+        x);
+    return x;
+  }
+};
+
+// key orders that need no comparator callback:
+// memcmp_order = lexicographic order of the encoded bytes (LMDB default)
+// integer_order = native unsigned int / mdb_size_t keys (INTEGERKEY),
+//                 searched without calling a comparator (mdb_node_isearch)
+struct memcmp_order {};
+struct integer_order {};
+
+template <typename Key>
+using default_order = std::conditional_t<is_native_integer_key_v<Key>,
+                                         integer_order, memcmp_order>;
+
+// comparator callback for a strict weak ordering Compare{}(a, b) of keys,
+// instantiated per key type and order so the compare is inlined into it
+template <typename Key, typename Compare>
+int compare_keys(MDB_val const* a, MDB_val const* b) {
+  auto const x = codec<Key>::decode(*a);
+  auto const y = codec<Key>::decode(*b);
+  auto const less = Compare{};
+  return less(x, y) ? -1 : (less(y, x) ? 1 : 0);
+}
+
+// database handle with typed keys and values
+// Compare: memcmp_order, integer_order or a default constructible
+// strict weak ordering of Key, registered with mdb_set_compare
+// all users of a database have to open it with the same Compare
+template <typename Key, typename Value, typename Compare = default_order<Key>>
+struct typed_dbi {
+  static_assert(!std::is_floating_point_v<Key> || is_ordered_float_v<Key> ||
+                    !std::is_same_v<Compare, memcmp_order>,
+                "the bytes of this Key do not sort by value, pass a Compare");
+
+  using entry = std::pair<Key, Value>;
+
+  explicit typed_dbi(txn& t, char const* name = nullptr,
+                     dbi_flags flags = dbi_flags::NONE) {
+    if constexpr (std::is_same_v<Compare, integer_order>) {
+      flags = flags | dbi_flags::INTEGERKEY;
+    }
+    auto const dbi = txn::dbi{t.txn_, name, flags};
+    if constexpr (!std::is_same_v<Compare, integer_order> &&
+                  !std::is_same_v<Compare, memcmp_order>) {
+      t.set_compare(dbi, &compare_keys<Key, Compare>);
+    }
+    dbi_ = dbi.dbi_;
+  }
+
+  txn::dbi handle(txn& t) const { return {t.txn_, dbi_}; }
+
+  std::optional<Value> get(txn& t, Key const& key) const {
+    return codec<Key>::with_val(key, [&](MDB_val& k) {
+      auto v = MDB_val{0U, nullptr};
+      auto const ec = mdb_get(t.txn_, dbi_, &k, &v);
+      if (ec == MDB_NOTFOUND) {
+        return std::optional<Value>{};
+      }
+      ex(ec);
+      return std::optional<Value>{decode_value(v)};
+    });
+  }
+
+  void put(txn& t, Key const& key, Value const& value,
+           put_flags const flags = put_flags::NONE) const {
+    codec<Key>::with_val(key, [&](MDB_val& k) {
+      codec<Value>::with_val(value, [&](MDB_val& v) {
+        ex(mdb_put(t.txn_, dbi_, &k, &v, static_cast<unsigned>(flags)));
+      });
+    });
+    t.is_write_ = true;
+  }
+
+  bool del(txn& t, Key const& key) const {
+    auto const ec = codec<Key>::with_val(
+        key, [&](MDB_val& k) { return mdb_del(t.txn_, dbi_, &k, nullptr); });
+    if (ec == MDB_NOTFOUND) {
+      return false;
+    }
+    ex(ec);
+    t.is_write_ = true;
+    return true;
+  }
+
+  // positions c at the first entry with a key >= key (in Compare order)
+  std::optional<entry> lower_bound(cursor& c, Key const& key) const {
+    return codec<Key>::with_val(key, [&](MDB_val& k) {
+      auto v = MDB_val{0U, nullptr};
+      return read(mdb_cursor_get(c.cursor_, &k, &v, MDB_SET_RANGE), k, v);
+    });
+  }
+
+  std::optional<entry> get(cursor& c, cursor_op const op) const {
+    auto k = MDB_val{0U, nullptr};
+    auto v = MDB_val{0U, nullptr};
+    return read(mdb_cursor_get(c.cursor_, &k, &v,
+                               static_cast<MDB_cursor_op>(op)),
+                k, v);
+  }
+
+  MDB_dbi dbi_;
+
+private:
+  static Value decode_value(MDB_val const& v) {
+    if (!codec<Value>::fits(v)) {
+      throw std::system_error{error::make_error_code(MDB_BAD_VALSIZE)};
+    }
+    return codec<Value>::decode(v);
+  }
+
+  static std::optional<entry> read(int const ec, MDB_val const& k,
+                                   MDB_val const& v) {
+    if (ec == MDB_NOTFOUND) {
+      return std::nullopt;
+    }
+    ex(ec);
+    if (!codec<Key>::fits(k)) {
+      throw std::system_error{error::make_error_code(MDB_BAD_VALSIZE)};
+    }
+    return entry{codec<Key>::decode(k), decode_value(v)};
+  }
+};
+
+}  // namespace lmdb
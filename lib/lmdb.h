@@ -108,7 +108,11 @@
  *
  *	- Avoid long-lived transactions.  Read transactions prevent
  *	  reuse of pages freed by newer write transactions, thus the
- *	  database can grow quickly.  Write transactions prevent
+ *	  database can grow quickly.  A writer process does reuse pages
+ *	  it wrote after the snapshot of such a reader, once no newer
+ *	  snapshot can see them, but not pages written by other processes,
+ *	  before it opened the environment, or above #mdb_env_set_maxgap().
+ *	  Write transactions prevent
  *	  other write transactions, since writes are serialized.
  *
  *	- Avoid suspending a process with active transactions.  These
@@ -397,6 +401,22 @@ typedef void(MDB_rel_func)(MDB_val *item, void *oldptr, void *newptr,
 #define MDB_CP_COMPACT 0x01
 /*	@} */
 
+/**	@defgroup mdb_access	Access Pattern Hints
+ *
+ *	Kernel readahead policy for the pages a database's cursors read,
+ *	see #mdb_set_access() and #mdb_cursor_access().
+ *	@{
+ */
+/** Keep the environment's policy (#MDB_NORDAHEAD or the OS default) */
+#define MDB_ACCESS_DEFAULT 0
+/** OS default readahead, also where #MDB_NORDAHEAD is set */
+#define MDB_ACCESS_NORMAL 1
+/** No readahead, for point lookups in databases larger than RAM */
+#define MDB_ACCESS_RANDOM 2
+/** Aggressive readahead, for databases that are mostly scanned */
+#define MDB_ACCESS_SEQUENTIAL 3
+/*	@} */
+
 /** @brief Cursor Get operations.
  *
  *	This is the set of all operations for retrieving data
@@ -523,6 +543,14 @@ typedef struct MDB_envinfo {
   unsigned int me_numreaders; /**< max reader slots used in the environment */
 } MDB_envinfo;
 
+/** @brief Statistics about dirty pages of write transactions */
+typedef struct MDB_spillstat {
+  mdb_size_t ms_spills;          /**< times a write txn had to spill */
+  mdb_size_t ms_spilled_pages;   /**< dirty pages written before commit */
+  mdb_size_t ms_unspilled_pages; /**< spilled pages dirtied again */
+  mdb_size_t ms_dirty_peak;      /**< most dirty pages of a write txn */
+} MDB_spillstat;
+
 /** @brief Return the LMDB library version information.
  *
  * @param[out] major if non-NULL, the library major version number is copied
@@ -813,6 +841,75 @@ int mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags);
  */
 int mdb_env_copyfd2(MDB_env *env, mdb_filehandle_t fd, unsigned int flags);
 
+/** @brief Copy an LMDB environment to the specified path, with options,
+ *	on several threads.
+ *
+ * Like #mdb_env_copy2(). With #MDB_CP_COMPACT and threads > 1, the trees
+ * are split into subtrees (named databases are split on their own) which
+ * are counted, renumbered and written in parallel, each to its own range
+ * of pages. This helps when reading the environment is the bottleneck,
+ * e.g. on SSDs or with the environment in the page cache.
+ * @param[in] env An environment handle returned by #mdb_env_create(). It
+ * must have already been opened successfully.
+ * @param[in] path The directory in which the copy will reside. This
+ * directory must already exist and be writable but must otherwise be
+ * empty.
+ * @param[in] flags Special options for this operation.
+ * See #mdb_env_copy2() for options.
+ * @param[in] threads The number of threads for a compacting copy,
+ * including the calling thread. 0 or 1 is the same as #mdb_env_copy2().
+ * @return A non-zero error value on failure and 0 on success.
+ */
+int mdb_env_copy3(MDB_env *env, const char *path, unsigned int flags,
+	unsigned int threads);
+
+/** @brief Copy an LMDB environment to the specified file descriptor,
+ *	with options, on several threads.
+ *
+ * See #mdb_env_copy3(). The parallel copy uses positional writes from
+ * the current file offset on. If fd is not seekable (e.g. a pipe) the
+ * copy is done by a single thread.
+ * @param[in] env An environment handle returned by #mdb_env_create(). It
+ * must have already been opened successfully.
+ * @param[in] fd The filedescriptor to write the copy to. It must
+ * have already been opened for Write access.
+ * @param[in] flags Special options for this operation.
+ * See #mdb_env_copy2() for options.
+ * @param[in] threads The number of threads for a compacting copy.
+ * @return A non-zero error value on failure and 0 on success.
+ */
+int mdb_env_copyfd3(MDB_env *env, mdb_filehandle_t fd, unsigned int flags,
+	unsigned int threads);
+
+/** @brief Shrink the data file in place.
+ *
+ * Moves the pages in use from the end of the file to free pages below,
+ * then truncates the file behind the last page in use. Unlike a
+ * compacting #mdb_env_copy2(), readers and other writers go on meanwhile:
+ * the work is done in a series of write transactions, each of which
+ * copies at most \b max_pages pages. A page moved by one transaction is
+ * released by a later one, once no reader uses a snapshot that still
+ * refers to it. So a long-lived read transaction stops the shrink early;
+ * it can be called again later.
+ *
+ * With #MDB_WRITEMAP, and on Windows, which does not cut a file below
+ * a mapped view of it, the pages are moved but the file keeps its size.
+ * The environment must not be open with #MDB_WRITEMAP in
+ * another process meanwhile.
+ * @param[in] env An environment handle returned by #mdb_env_create(). It
+ * must have already been opened successfully.
+ * @param[in] max_pages The maximum number of pages a transaction copies
+ * @param[out] released The number of pages the data shrank by, or NULL
+ * @return A non-zero error value on failure and 0 on success. Some
+ * possible errors are:
+ * <ul>
+ *	<li>EACCES - the environment is read-only.
+ *	<li>EINVAL - an invalid parameter was specified.
+ * </ul>
+ */
+int mdb_env_shrink(MDB_env *env, unsigned int max_pages,
+                   mdb_size_t *released);
+
 /** @brief Return statistics about the LMDB environment.
  *
  * @param[in] env An environment handle returned by #mdb_env_create()
@@ -1011,6 +1108,92 @@ int mdb_env_get_maxreaders(MDB_env *env, unsigned int *readers);
  */
 int mdb_env_set_maxdbs(MDB_env *env, MDB_dbi dbs);
 
+/** @brief Set the maximum number of dirty pages of a write transaction.
+ *
+ * Pages changed by a write transaction are kept in memory until it
+ * commits. When this limit is reached, some of them are written out
+ * early ("spilled") and read back if they change again. A transaction
+ * which still needs more pages fails with #MDB_TXN_FULL. The default
+ * is 131071 pages (512 MiB with 4 KiB pages), or 32767 pages with
+ * MDB_VL32. Memory for the pages is allocated as needed.
+ * This function may be called before or after #mdb_env_open(), but not
+ * while a write transaction is active.
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @param[in] pages The maximum number of dirty pages, at least 1024
+ * and at most 2^30.
+ * @return A non-zero error value on failure and 0 on success. Some
+ * possible errors are:
+ * <ul>
+ *	<li>EINVAL - an invalid parameter was specified, or a write
+ *	transaction is active.
+ * </ul>
+ */
+int mdb_env_set_maxdirty(MDB_env *env, unsigned int pages);
+
+/** @brief Get the maximum number of dirty pages of a write transaction.
+ *
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @param[out] pages Address of an integer to store the number of pages
+ * @return A non-zero error value on failure and 0 on success.
+ */
+int mdb_env_get_maxdirty(MDB_env *env, unsigned int *pages);
+
+/** @brief Set how many pages a writer tracks for reuse between readers.
+ *
+ * A write transaction may reuse a page freed after the snapshot of a
+ * long-lived reader if the page was written after that snapshot too.
+ * For this, the process remembers which transaction wrote each page,
+ * in 4 bytes per page of memory. Only pages below this page number are
+ * tracked, the others are reused only once no reader is older. The
+ * default is 262144 pages (1 GiB with 4 KiB pages, 1 MiB of memory),
+ * 0 turns the tracking off.
+ * This function may be called before or after #mdb_env_open(), but not
+ * while a write transaction is active.
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @param[in] pages The number of pages
+ * @return A non-zero error value on failure and 0 on success. Some
+ * possible errors are:
+ * <ul>
+ *	<li>EINVAL - an invalid parameter was specified, or a write
+ *	transaction is active.
+ * </ul>
+ */
+int mdb_env_set_maxgap(MDB_env *env, unsigned int pages);
+
+/** @brief Return statistics about dirty page spilling.
+ *
+ * The counters cover all write transactions of this environment handle
+ * since #mdb_env_create().
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @param[out] stat The address of an #MDB_spillstat structure
+ * 	where the statistics will be copied
+ * @return A non-zero error value on failure and 0 on success.
+ */
+int mdb_env_spill_stat(MDB_env *env, MDB_spillstat *stat);
+
+/** @brief Write the pages of commits through an io_uring.
+ *
+ * Instead of writing the dirty pages of a commit batch by batch with
+ * writev(), up to \b depth batches are in flight at once. The fsync of
+ * the data pages, the write of the meta page and its fsync are submitted
+ * as a linked chain. This helps commits of many pages on devices with
+ * deep queues, small commits may get slower. Only Linux 5.4 or newer
+ * supports this, other systems keep using writev(). It has no effect
+ * with #MDB_WRITEMAP.
+ * This function may be called before or after #mdb_env_open(), but not
+ * while a write transaction is active.
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @param[in] depth The queue depth, 0 to switch back to writev().
+ * @return A non-zero error value on failure and 0 on success. On failure
+ * the environment keeps using writev(). Some possible errors are:
+ * <ul>
+ *	<li>EINVAL - a write transaction is active.
+ *	<li>ENOSYS - io_uring is not supported by this build or kernel.
+ *	<li>EPERM - io_uring is disabled by the system.
+ * </ul>
+ */
+int mdb_env_set_uring(MDB_env *env, unsigned int depth);
+
 /** @brief Get the maximum size of keys and #MDB_DUPSORT data we can write.
  *
  * Depends on the compile-time constant #MDB_MAXKEYSIZE. Default 511.
@@ -1131,6 +1314,61 @@ mdb_size_t mdb_txn_id(MDB_txn *txn);
  */
 int mdb_txn_commit(MDB_txn *txn);
 
+/** @brief A callback for #mdb_txn_commit_async().
+ *
+ * It is called from a background thread of the environment, which
+ * calls no other callback until it returns. It must not commit a write
+ * transaction of the same environment, nor call #mdb_env_commit_wait().
+ * @param[in] ctx The context passed to #mdb_txn_commit_async().
+ * @param[in] txnid The ID of the committed transaction.
+ * @param[in] rc 0 once the transaction is durable, otherwise the error
+ * that kept it from becoming durable.
+ */
+typedef void (MDB_commit_func)(void *ctx, mdb_size_t txnid, int rc);
+
+/** @brief Commit a write transaction, and sync it in the background.
+ *
+ * Like #mdb_txn_commit(), but returns once the dirty pages are written
+ * to the OS, before they are synced and before the meta page is written.
+ * A background thread of the environment does both and then calls
+ * \b func. Until then the commit is not durable, and read-only
+ * transactions don't see it. Write transactions of this process build
+ * on it without waiting, those of other processes wait for it. At most
+ * one commit is pending: the next one waits for it before returning.
+ * A crash loses the pending commit, never the data under a written
+ * meta page. If the background sync or write fails, the environment
+ * is marked fatal, later commits fail with the same error, and
+ * #mdb_env_close() is the only way out.
+ *
+ * Read-only or empty transactions, a txn or environment with
+ * #MDB_NOSYNC, and #MDB_WRITEMAP commit synchronously and call
+ * \b func before returning. So do builds without thread support. A
+ * nested transaction is committed into its parent as by
+ * #mdb_txn_commit(), then \b func is called.
+ * @param[in] txn A transaction handle returned by #mdb_txn_begin()
+ * @param[in] func A #MDB_commit_func function. It is called only if
+ * this returns 0.
+ * @param[in] ctx An arbitrary pointer for \b func.
+ * @return A non-zero error value on failure and 0 on success. Some possible
+ * errors are:
+ * <ul>
+ *	<li>EINVAL - an invalid parameter was specified.
+ *	<li>ENOSPC - no more disk space.
+ *	<li>EIO - a low-level I/O error occurred while writing.
+ *	<li>ENOMEM - out of memory.
+ * </ul>
+ */
+int mdb_txn_commit_async(MDB_txn *txn, MDB_commit_func *func, void *ctx);
+
+/** @brief Wait for the pending #mdb_txn_commit_async() of an environment.
+ *
+ * Its #MDB_commit_func has returned when this returns.
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @return 0 when no commit is pending any more, or the error of a failed
+ * background commit.
+ */
+int mdb_env_commit_wait(MDB_env *env);
+
 /** @brief Abandon all the operations of the transaction instead of saving them.
  *
  * The transaction handle is freed. It and its cursors must not be used
@@ -1413,6 +1651,28 @@ int mdb_set_relfunc(MDB_txn *txn, MDB_dbi dbi, MDB_rel_func *rel);
  */
 int mdb_set_relctx(MDB_txn *txn, MDB_dbi dbi, void *ctx);
 
+/** @brief Set the access pattern hint of a database.
+ *
+ * Cursors on the database pass the hint to the kernel (madvise) for the
+ * pages of the map they read, so databases used for point lookups and
+ * databases that are scanned can have different readahead policies in
+ * one environment. The map is advised in 1MB chunks, a chunk takes the
+ * hint of the first cursor that reads a page in it. A chunk read with
+ * different hints falls back to #MDB_ACCESS_NORMAL. Like
+ * #mdb_set_compare(), this is a property of the database handle in this
+ * process, set it before other threads use the handle.
+ * It has no effect with #MDB_VL32 or on Windows.
+ * @param[in] txn A transaction handle returned by #mdb_txn_begin()
+ * @param[in] dbi A database handle returned by #mdb_dbi_open()
+ * @param[in] access One of the @ref mdb_access hints.
+ * @return A non-zero error value on failure and 0 on success. Some possible
+ * errors are:
+ * <ul>
+ *	<li>EINVAL - an invalid parameter was specified.
+ * </ul>
+ */
+int mdb_set_access(MDB_txn *txn, MDB_dbi dbi, unsigned int access);
+
 /** @brief Get items from a database.
  *
  * This function retrieves key/data pairs from the database. The address
@@ -1567,6 +1827,44 @@ void mdb_cursor_close(MDB_cursor *cursor);
  */
 int mdb_cursor_renew(MDB_txn *txn, MDB_cursor *cursor);
 
+/** @brief Set the read-ahead depth of a scanning cursor.
+ *
+ * When the cursor moves to another leaf page (#MDB_NEXT, #MDB_PREV and
+ * their variants, #MDB_FIRST, #MDB_LAST and #MDB_SET_RANGE), the OS is
+ * asked to read in the next \b depth leaf pages in scan direction, as
+ * listed by the parent branch page, and the overflow pages of the new
+ * leaf's big values. This hides disk latency in range scans over a cold
+ * map; on a cached map it only costs a few system calls per leaf.
+ * The depth is kept by #mdb_cursor_renew(). It has no effect with
+ * #MDB_VL32 or on Windows.
+ * @param[in] cursor A cursor handle returned by #mdb_cursor_open()
+ * @param[in] depth The number of leaf pages to read ahead, at most 256.
+ * 0 turns read-ahead off, which is the default.
+ * @return A non-zero error value on failure and 0 on success. Some possible
+ * errors are:
+ * <ul>
+ *	<li>EINVAL - an invalid parameter was specified.
+ * </ul>
+ */
+int mdb_cursor_prefetch(MDB_cursor *cursor, unsigned int depth);
+
+/** @brief Set the access pattern hint of a cursor.
+ *
+ * Overrides the hint of the cursor's database, see #mdb_set_access().
+ * The hint is kept by #mdb_cursor_renew(). Like other cursor functions
+ * it may be called by the thread using the cursor while other threads
+ * read with cursors of their own; the chunk hints they share are
+ * updated atomically.
+ * @param[in] cursor A cursor handle returned by #mdb_cursor_open()
+ * @param[in] access One of the @ref mdb_access hints.
+ * @return A non-zero error value on failure and 0 on success. Some possible
+ * errors are:
+ * <ul>
+ *	<li>EINVAL - an invalid parameter was specified.
+ * </ul>
+ */
+int mdb_cursor_access(MDB_cursor *cursor, unsigned int access);
+
 /** @brief Return the cursor's transaction handle.
  *
  * @param[in] cursor A cursor handle returned by #mdb_cursor_open()
@@ -1708,6 +2006,31 @@ int mdb_cursor_del(MDB_cursor *cursor, unsigned int flags);
  */
 int mdb_cursor_count(MDB_cursor *cursor, mdb_size_t *countp);
 
+/** @brief Return statistics about the named database at a cursor.
+ *
+ * The cursor is on the main database, at the record of a named
+ * database. Unlike #mdb_dbi_open() and #mdb_stat(), this does not take a
+ * database handle, so it can list all named databases without running
+ * out of handles (#mdb_env_set_maxdbs()) or racing with other threads
+ * opening handles. The statistics are those of the record in the
+ * transaction's main database: changes of a write transaction to a
+ * named database show up after its handle's record is written back, at
+ * commit.
+ * @param[in] cursor A cursor handle returned by #mdb_cursor_open() on the
+ * main database, opened with a NULL name
+ * @param[out] stat The address of an #MDB_stat structure
+ * 	where the statistics will be copied
+ * @return A non-zero error value on failure and 0 on success. Some possible
+ * errors are:
+ * <ul>
+ *	<li>EINVAL - cursor is not initialized or not on the main database,
+ *	or an invalid parameter was specified.
+ *	<li>MDB_NOTFOUND - the cursor is not at a record.
+ *	<li>MDB_INCOMPATIBLE - the record is not a named database.
+ * </ul>
+ */
+int mdb_cursor_dbstat(MDB_cursor *cursor, MDB_stat *stat);
+
 /** @brief Compare two data items according to a particular database.
  *
  * This returns a comparison as if the two data items were keys in the
@@ -1732,6 +2055,74 @@ int mdb_cmp(MDB_txn *txn, MDB_dbi dbi, const MDB_val *a, const MDB_val *b);
  */
 int mdb_dcmp(MDB_txn *txn, MDB_dbi dbi, const MDB_val *a, const MDB_val *b);
 
+/** @brief Opaque handle for a bulk build, see #mdb_build_begin(). */
+typedef struct MDB_build MDB_build;
+
+/** @brief Start a bottom-up bulk build of an empty database.
+ *
+ * The key/data pairs passed to #mdb_build_put() in ascending key order
+ * are packed into leaf pages, then branch pages, which are written
+ * sequentially behind the last used page of the environment. This needs
+ * no tree descent per key and bypasses the dirty page list, so the build
+ * is not limited by the number of dirty pages of a transaction.
+ *
+ * The tree becomes part of the database with #mdb_build_end() and
+ * durable with the commit of \b txn. Until then, \b dbi must not be
+ * written to. The build has to be ended or aborted before \b txn ends.
+ * @param[in] txn A write transaction handle returned by #mdb_txn_begin()
+ * @param[in] dbi An empty database handle, not opened with #MDB_DUPSORT
+ * @param[in] fill The page fill factor in percent (1-100), 0 for 100
+ * @param[out] build Address where the new #MDB_build handle will be stored
+ * @return A non-zero error value on failure and 0 on success. Some
+ * possible errors are:
+ * <ul>
+ *	<li>MDB_INCOMPATIBLE - the database is not empty or #MDB_DUPSORT.
+ *	<li>EACCES - an attempt was made to write in a read-only transaction.
+ *	<li>EINVAL - an invalid parameter was specified.
+ *	<li>ENOMEM - out of memory.
+ * </ul>
+ */
+int mdb_build_begin(MDB_txn *txn, MDB_dbi dbi, unsigned int fill,
+                    MDB_build **build);
+
+/** @brief Append a key/data pair to a bulk build.
+ *
+ * Keys have to be greater than the previous key according to the
+ * comparison function of the database.
+ * @param[in] build A handle returned by #mdb_build_begin()
+ * @param[in] key The key to store
+ * @param[in] data The data to store
+ * @return A non-zero error value on failure and 0 on success. Some
+ * possible errors are:
+ * <ul>
+ *	<li>MDB_KEYEXIST - the key is not greater than the previous key.
+ *	<li>MDB_BAD_VALSIZE - the key or data is too large.
+ *	<li>MDB_MAP_FULL - the database is full, see #mdb_env_set_mapsize().
+ * </ul>
+ * Other errors (e.g. from writing the data file) are returned for all
+ * further calls and by #mdb_build_end().
+ */
+int mdb_build_put(MDB_build *build, MDB_val *key, MDB_val *data);
+
+/** @brief Complete a bulk build and install the tree into the database.
+ *
+ * The handle is freed, even on failure.
+ * @param[in] build A handle returned by #mdb_build_begin()
+ * @return A non-zero error value on failure and 0 on success.
+ */
+int mdb_build_end(MDB_build *build);
+
+/** @brief Abandon a bulk build, leaving the database empty.
+ *
+ * The handle is freed. All pages written so far are given back to the
+ * transaction: the last run of them by lowering the end of the used
+ * pages if no other pages were allocated after it, the others as pages
+ * the transaction freed. If that fails for lack of memory, the
+ * transaction is marked failed and must be aborted.
+ * @param[in] build A handle returned by #mdb_build_begin()
+ */
+void mdb_build_abort(MDB_build *build);
+
 /** @brief A callback function used to print a message from the library.
  *
  * @param[in] msg The string to be printed.
@@ -1749,6 +2140,33 @@ typedef int(MDB_msg_func)(const char *msg, void *ctx);
  */
 int mdb_reader_list(MDB_env *env, MDB_msg_func *func, void *ctx);
 
+/** @brief An entry of the reader lock table, see #mdb_reader_each(). */
+typedef struct MDB_reader_info {
+  mdb_size_t rd_txnid; /**< snapshot txnid, (mdb_size_t)-1 if not in use */
+  int rd_pid;          /**< process ID of the reader */
+  size_t rd_tid;       /**< thread ID of the reader */
+} MDB_reader_info;
+
+/** @brief A callback function invoked for a reader lock table entry.
+ *
+ * @param[in] info The reader slot, only valid during the call.
+ * @param[in] ctx An arbitrary context pointer for the callback.
+ * @return 0 to continue, non-zero to stop the enumeration.
+ */
+typedef int(MDB_reader_func)(const MDB_reader_info *info, void *ctx);
+
+/** @brief Enumerate the entries in the reader lock table.
+ *
+ * Like #mdb_reader_list(), but passes each entry in structured form.
+ * The table is read without locking, the result is a snapshot.
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @param[in] func A #MDB_reader_func function
+ * @param[in] ctx Anything the callback function needs
+ * @return 0 on success, EINVAL for invalid arguments or the first
+ * non-zero value returned by func.
+ */
+int mdb_reader_each(MDB_env *env, MDB_reader_func *func, void *ctx);
+
 /** @brief Check for stale entries in the reader lock table.
  *
  * @param[in] env An environment handle returned by #mdb_env_create()
@@ -1756,6 +2174,66 @@ int mdb_reader_list(MDB_env *env, MDB_msg_func *func, void *ctx);
  * @return 0 on success, non-zero on failure.
  */
 int mdb_reader_check(MDB_env *env, int *dead);
+
+/** @brief A reader reported by the reaper, see #mdb_env_set_reaper(). */
+typedef struct MDB_reaper_info {
+  mdb_size_t ri_txnid;  /**< snapshot txnid of the reader */
+  mdb_size_t ri_lag;    /**< last committed txnid minus ri_txnid */
+  /** pages in the freelist records of ri_txnid and later, which are
+   * not reused while the reader holds its snapshot */
+  mdb_size_t ri_pinned;
+  unsigned int ri_age; /**< milliseconds the reaper has seen ri_txnid */
+  int ri_pid;          /**< process ID of the reader */
+  size_t ri_tid;       /**< thread ID of the reader */
+} MDB_reaper_info;
+
+/** @brief A callback function invoked for a reader over the limits.
+ *
+ * It runs on the reaper thread and must not call #mdb_env_set_reaper().
+ * @param[in] info The reader, only valid during the call.
+ * @param[in] ctx An arbitrary context pointer for the callback.
+ * @return 0 to keep the reader, non-zero to evict it.
+ */
+typedef int(MDB_reaper_func)(const MDB_reaper_info *info, void *ctx);
+
+/** @brief Check the reader lock table from a background thread.
+ *
+ * Every \b interval milliseconds, a thread of the environment clears
+ * stale reader slots like #mdb_reader_check(). If \b func is given, it
+ * is then called for each reader whose snapshot is more than \b max_lag
+ * transactions behind the last committed one, or which has been seen on
+ * the same old snapshot for at least \b max_age milliseconds. Readers of
+ * the last committed snapshot are never reported.
+ *
+ * When \b func returns non-zero, the reader is evicted: its snapshot is
+ * released, and writers reuse the pages it was keeping. The next get of
+ * the evicted transaction fails with #MDB_BAD_TXN, it may only be reset
+ * or aborted. Eviction is not safe for a reader that is using the
+ * database at that moment, or that still uses data it got from it,
+ * since these pages may be overwritten. It is meant for forgotten or
+ * hung transactions.
+ *
+ * Calling this function again changes the settings. When it returns,
+ * the previous \b func is not running and will not be called again.
+ * The environment must be open. The thread uses a reader slot of its
+ * own for a read-only transaction when it computes #MDB_reaper_info.
+ * @param[in] env An environment handle returned by #mdb_env_create()
+ * @param[in] interval Milliseconds between checks, 0 stops the thread
+ * @param[in] max_lag The maximum lag in transactions, 0 for no limit
+ * @param[in] max_age The maximum age in milliseconds, 0 for no limit
+ * @param[in] func A #MDB_reaper_func function, or NULL
+ * @param[in] ctx Anything the callback function needs
+ * @return A non-zero error value on failure and 0 on success. Some
+ * possible errors are:
+ * <ul>
+ *	<li>EINVAL - the environment is not open or has no lock file.
+ *	<li>ENOSYS - background checks are not supported on this platform.
+ *	<li>ENOMEM - out of memory.
+ * </ul>
+ */
+int mdb_env_set_reaper(MDB_env *env, unsigned int interval,
+                       mdb_size_t max_lag, unsigned int max_age,
+                       MDB_reaper_func *func, void *ctx);
 /**	@} */
 
 #ifdef __cplusplus
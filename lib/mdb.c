@@ -191,6 +191,31 @@ union semun {
 # error "Ambiguous shared-lock implementation"
 #endif
 
+/** Background syncs for #mdb_txn_commit_async(). Elsewhere it
+ *	commits synchronously.
+ */
+#if !defined(_WIN32) && !defined(MDB_VL32)
+# define MDB_USE_ASYNC	1
+#endif
+
+/** Background reader checks for #mdb_env_set_reaper(). */
+#if !defined(_WIN32) && !defined(MDB_VL32)
+# define MDB_USE_REAPER	1
+#endif
+
+/** io_uring support for #mdb_env_set_uring(). The kernel interface
+ *	is used directly, liburing is not needed. Define MDB_NO_URING
+ *	to build without it.
+ */
+#if defined(__linux) && defined(__GNUC__) && !defined(MDB_NO_URING) && \
+	defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  define MDB_USE_URING	1
+#  include <linux/io_uring.h>
+#  include <sys/syscall.h>
+# endif
+#endif
+
 #ifdef USE_VALGRIND
 #include <valgrind/memcheck.h>
 #define VGMEMP_CREATE(h,r,z)    VALGRIND_CREATE_MEMPOOL(h,r,z)
@@ -232,6 +257,16 @@ union semun {
 #define MISALIGNED_OK	1
 #endif
 
+/** Use SSE4.2/AVX2 for searches in pages of integer keys if the CPU
+ *	supports them, see #mdb_node_isearch(). Define MDB_NO_SIMD to always
+ *	use the scalar version.
+ */
+#if !defined(MDB_NO_SIMD) && defined(__GNUC__) && \
+	(defined(__i386__) || defined(__x86_64__))
+#define MDB_SIMD_X86	1
+#include <immintrin.h>
+#endif
+
 #include "lmdb.h"
 #include "midl.h"
 
@@ -627,8 +662,10 @@ static txnid_t mdb_debug_start;
 
 	/**	The version number for a database's datafile format. */
 #define MDB_DATA_VERSION	 ((MDB_DEVEL) ? 999 : 1)
-	/**	The version number for a database's lockfile format. */
-#define MDB_LOCK_VERSION	 ((MDB_DEVEL) ? 999 : 2)
+	/**	The version number for a database's lockfile format.
+	 *	3 added #mti_async_pid, which older writers would ignore.
+	 */
+#define MDB_LOCK_VERSION	 ((MDB_DEVEL) ? 999 : 3)
 	/** Number of bits representing #MDB_LOCK_VERSION in #MDB_LOCK_FORMAT.
 	 *	The remaining bits must leave room for #MDB_lock_desc.
 	 */
@@ -846,6 +883,11 @@ typedef struct MDB_txbody {
 		 *	when readers release their slots.
 		 */
 	volatile unsigned	mtb_numreaders;
+		/** A process whose commit, queued by #mdb_txn_commit_async(),
+		 *	has not written its meta page yet. Writers of other processes
+		 *	wait until it is cleared.
+		 */
+	volatile MDB_PID_T	mtb_async_pid;
 #if defined(_WIN32) || defined(MDB_USE_POSIX_SEM)
 		/** Binary form of names of the reader/writer locks */
 	mdb_hash_t			mtb_mutexid;
@@ -869,6 +911,7 @@ typedef struct MDB_txninfo {
 #define mti_rmutex	mt1.mtb.mtb_rmutex
 #define mti_txnid	mt1.mtb.mtb_txnid
 #define mti_numreaders	mt1.mtb.mtb_numreaders
+#define mti_async_pid	mt1.mtb.mtb_async_pid
 #define mti_mutexid	mt1.mtb.mtb_mutexid
 #ifdef MDB_USE_SYSV_SEM
 #define	mti_semid	mt1.mtb.mtb_semid
@@ -1243,6 +1286,7 @@ typedef struct MDB_dbx {
 	MDB_cmp_func	*md_dcmp;	/**< function for comparing data items */
 	MDB_rel_func	*md_rel;	/**< user relocate function */
 	void		*md_relctx;		/**< user-provided context for md_rel */
+	unsigned int	md_access;	/**< @ref mdb_access hint for cursors */
 } MDB_dbx;
 
 	/** A database transaction.
@@ -1405,6 +1449,12 @@ struct MDB_cursor {
 	unsigned int	mc_flags;	/**< @ref mdb_cursor */
 	MDB_page	*mc_pg[CURSOR_STACK];	/**< stack of pushed pages */
 	indx_t		mc_ki[CURSOR_STACK];	/**< stack of page indices */
+	/** Read-ahead depth in leaf pages, see #mdb_cursor_prefetch() */
+	unsigned short	mc_prefetch;
+	unsigned short	mc_access;	/**< @ref mdb_access hint for its pages */
+	indx_t		mc_pf_lo;	/**< first child of #mc_pf_pgno read ahead */
+	indx_t		mc_pf_hi;	/**< last child of #mc_pf_pgno read ahead */
+	pgno_t		mc_pf_pgno;	/**< branch page of the read-ahead window */
 #ifdef MDB_VL32
 	MDB_page	*mc_ovpg;		/**< a referenced overflow page */
 #	define MC_OVPG(mc)			((mc)->mc_ovpg)
@@ -1448,7 +1498,7 @@ typedef struct MDB_xcursor {
 
 	/** State of FreeDB old pages, stored in the MDB_env */
 typedef struct MDB_pgstate {
-	pgno_t		*mf_pghead;	/**< Reclaimed freeDB pages, or NULL before use */
+	MDB_EXTL	mf_pghead;	/**< Reclaimed freeDB pages, or NULL before use */
 	txnid_t		mf_pglast;	/**< ID of last used record, or 0 if !mf_pghead */
 } MDB_pgstate;
 
@@ -1495,11 +1545,50 @@ struct MDB_env {
 	MDB_pgstate	me_pgstate;		/**< state of old pages from freeDB */
 #	define		me_pglast	me_pgstate.mf_pglast
 #	define		me_pghead	me_pgstate.mf_pghead
+	/** Keys of freeDB records newer than the oldest reader that this
+	 *	write txn reclaimed, see #mdb_freelist_gap()
+	 */
+	MDB_IDL		me_pggaps;
+	txnid_t		me_pgscan;		/**< last freeDB record #mdb_freelist_gap() checked */
+	MDB_IDL		me_pgsnaps;		/**< reader snapshots as of #me_pgscan */
+	/** Per page, the txn that last wrote it, as an offset from
+	 *	#me_birth_base, 0 if unknown. Allocated by the first commit.
+	 */
+	uint32_t	*me_births;
+	pgno_t		me_births_len;	/**< number of pages in #me_births */
+	/** Pages from this one on are not tracked, see #mdb_env_set_maxgap() */
+	pgno_t		me_births_max;
+	txnid_t		me_birth_base;
 	MDB_page	*me_dpages;		/**< list of malloc'd blocks for re-use */
 	/** IDL of pages that became unused in a write txn */
 	MDB_IDL		me_free_pgs;
-	/** ID2L of pages written during a write txn. Length MDB_IDL_UM_SIZE. */
+	/** IDL of pages written by a #MDB_WRITEMAP txn, see #mdb_env_sync_txn() */
+	MDB_IDL		me_sync_pgs;
+	/** Pages of earlier #MDB_WRITEMAP txns may not be on disk yet */
+	int			me_sync_full;
+	/** ID2L of pages written during a write txn. Grows on demand. */
 	MDB_ID2L	me_dirty_list;
+	/** Max number of dirty pages in a write txn, see #mdb_env_set_maxdirty() */
+	unsigned int	me_dirty_max;
+	MDB_spillstat	me_spillstat;	/**< for #mdb_env_spill_stat() */
+	/** @ref mdb_access hint applied to each #MDB_ACCESS_SHIFT sized
+	 *	chunk of the map, or #MDB_ACCESS_MIXED. Allocated with the map,
+	 *	the entries are read and set atomically by all reader threads.
+	 */
+	unsigned char	*me_access_map;
+	size_t		me_access_chunks;	/**< number of chunks in #me_access_map */
+#ifdef MDB_USE_URING
+	/** io_uring for commit writes, see #mdb_env_set_uring() */
+	struct MDB_uring	*me_uring;
+#endif
+#ifdef MDB_USE_ASYNC
+	/** Background sync of #mdb_txn_commit_async(), see @ref async */
+	struct MDB_async	*me_async;
+#endif
+#ifdef MDB_USE_REAPER
+	/** Background reader checks, see #mdb_env_set_reaper() */
+	struct MDB_reaper	*me_reaper;
+#endif
 	/** Max number of freelist items that can fit in a single overflow page */
 	int			me_maxfree_1pg;
 	/** Max size of a node on a page */
@@ -1546,6 +1635,15 @@ typedef struct MDB_ntxn {
 #define MDB_COMMIT_PAGES	IOV_MAX
 #endif
 
+	/** Bounds for #mdb_env_set_maxdirty(). The default is #MDB_IDL_UM_MAX. */
+#define MDB_DIRTY_MIN	1024U
+#define MDB_DIRTY_MAX	(1U << 30)
+	/** Initial dirty list size of a nested txn, it grows as needed */
+#define MDB_DIRTY_NESTED	4096U
+
+	/** Default for #mdb_env_set_maxgap(), a 1 MiB #me_births table */
+#define MDB_BIRTHS_DEFAULT	(1U << 18)
+
 	/** max bytes to write in one call */
 #define MAX_WRITE		(0x40000000U >> (sizeof(ssize_t) == 4))
 
@@ -1596,6 +1694,34 @@ static int  mdb_env_write_meta(MDB_txn *txn);
 # define mdb_env_close0(env, excl) mdb_env_close1(env)
 #endif
 static void mdb_env_close0(MDB_env *env, int excl);
+static int  mdb_env_access_init(MDB_env *env);
+static int  mdb_stat0(MDB_env *env, MDB_db *db, MDB_stat *arg);
+#ifdef MDB_USE_ASYNC
+static int  mdb_env_async_wait(MDB_env *env);
+static int  mdb_env_async_meta(MDB_env *env, MDB_meta *meta);
+static void mdb_env_async_other(MDB_env *env);
+static int  mdb_env_async_queue(MDB_txn *txn, MDB_commit_func *func,
+	void *ctx);
+#else
+#define mdb_env_async_wait(env)	MDB_SUCCESS
+#define mdb_env_async_meta(env, meta)	((void)(meta), 0)
+#define mdb_env_async_other(env)	((void) 0)
+#define mdb_env_async_stop(env)	((void) 0)
+#endif
+#ifdef MDB_USE_REAPER
+static void mdb_env_reaper_stop(MDB_env *env);
+static void mdb_env_reaper_hold(MDB_env *env);
+static void mdb_env_reaper_release(MDB_env *env);
+	/** Check for a read-only txn whose snapshot the reaper released */
+#define TXN_EVICTED(txn) \
+	(((txn)->mt_flags & MDB_TXN_RDONLY) && (txn)->mt_u.reader && \
+	 (txn)->mt_u.reader->mr_txnid != (txn)->mt_txnid)
+#else
+#define mdb_env_reaper_stop(env)	((void) 0)
+#define mdb_env_reaper_hold(env)	((void) 0)
+#define mdb_env_reaper_release(env)	((void) 0)
+#define TXN_EVICTED(txn)	0
+#endif
 
 static MDB_node *mdb_node_search(MDB_cursor *mc, MDB_val *key, int *exactp);
 static int  mdb_node_add(MDB_cursor *mc, indx_t indx,
@@ -2056,6 +2182,7 @@ mdb_dlist_free(MDB_txn *txn)
 		mdb_dpage_free(env, dl[i].mptr);
 	}
 	dl[0].mid = 0;
+	mdb_mid2l_reindex(dl);
 }
 
 #ifdef MDB_VL32
@@ -2128,17 +2255,15 @@ mdb_page_loose(MDB_cursor *mc, MDB_page *mp)
 			/* If txn has a parent, make sure the page is in our
 			 * dirty list.
 			 */
-			if (dl[0].mid) {
-				unsigned x = mdb_mid2l_search(dl, pgno);
-				if (x <= dl[0].mid && dl[x].mid == pgno) {
-					if (mp != dl[x].mptr) { /* bad cursor? */
-						mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
-						txn->mt_flags |= MDB_TXN_ERROR;
-						return MDB_PROBLEM;
-					}
-					/* ok, it's ours */
-					loose = 1;
+			unsigned x = mdb_mid2l_find(dl, pgno);
+			if (x) {
+				if (mp != dl[x].mptr) { /* bad cursor? */
+					mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
+					txn->mt_flags |= MDB_TXN_ERROR;
+					return MDB_PROBLEM;
 				}
+				/* ok, it's ours */
+				loose = 1;
 			}
 		} else {
 			/* no parent txn, so it's just ours */
@@ -2265,7 +2390,7 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	MDB_txn *txn = m0->mc_txn;
 	MDB_page *dp;
 	MDB_ID2L dl = txn->mt_u.dirty_list;
-	unsigned int i, j, need;
+	unsigned int i, j, need, spill;
 	int rc;
 
 	if (m0->mc_flags & C_SUB)
@@ -2312,11 +2437,13 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	 * of the dirty pages. Testing revealed this to be a good tradeoff,
 	 * better than 1/2, 1/4, or 1/10.
 	 */
-	if (need < MDB_IDL_UM_MAX / 8)
-		need = MDB_IDL_UM_MAX / 8;
+	if (need < txn->mt_env->me_dirty_max / 8)
+		need = txn->mt_env->me_dirty_max / 8;
+	spill = need;
 
 	/* Save the page IDs of all the pages we're flushing */
 	/* flush from the tail forward, this saves a lot of shifting later on. */
+	mdb_mid2l_sort(dl);
 	for (i=dl[0].mid; i && need; i--) {
 		MDB_ID pn = dl[i].mid << 1;
 		dp = dl[i].mptr;
@@ -2345,6 +2472,9 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	}
 	mdb_midl_sort(txn->mt_spill_pgs);
 
+	txn->mt_env->me_spillstat.ms_spills++;
+	txn->mt_env->me_spillstat.ms_spilled_pages += spill - need;
+
 	/* Flush the spilled part of dirty list */
 	if ((rc = mdb_page_flush(txn, i)) != MDB_SUCCESS)
 		goto done;
@@ -2376,23 +2506,242 @@ mdb_find_oldest(MDB_txn *txn)
 	return oldest;
 }
 
-/** Add a page to the txn's dirty list */
+/** Record that a write txn wrote some pages, for #mdb_freelist_gap().
+ *	A txn that aborts only wrote pages which no snapshot can see, so
+ *	their entries need no undo. Without memory they stay unknown.
+ * @param[in] txn the write transaction
+ * @param[in] pgno the first page
+ * @param[in] num the number of pages
+ */
+static void
+mdb_page_birth(MDB_txn *txn, pgno_t pgno, unsigned num)
+{
+	MDB_env *env = txn->mt_env;
+	uint32_t *births = env->me_births, v;
+	pgno_t len = env->me_births_len, end = pgno + num;
+
+	if (!env->me_txns)
+		return;		/* no reader table, no #mdb_freelist_gap() */
+	if (end > env->me_births_max)
+		end = env->me_births_max;
+	if (pgno >= end)
+		return;
+	if (!births || txn->mt_txnid - env->me_birth_base >= 0xffffffffU) {
+		/* First use, or the offsets ran out: forget the rest */
+		if (births)
+			memset(births, 0, len * sizeof(uint32_t));
+		env->me_birth_base = txn->mt_txnid;
+	}
+	if (end > len) {
+		len = len * 2 < env->me_births_max ? len * 2 : env->me_births_max;
+		if (len < end)
+			len = end;
+		if (!(births = realloc(births, len * sizeof(uint32_t))))
+			return;
+		memset(births + env->me_births_len, 0,
+			(len - env->me_births_len) * sizeof(uint32_t));
+		env->me_births = births;
+		env->me_births_len = len;
+	}
+	v = txn->mt_txnid - env->me_birth_base + 1;
+	for (; pgno < end; pgno++)
+		births[pgno] = v;
+}
+
+/** Reclaim freeDB records that are newer than the oldest reader.
+ *	The pages freed by txn F are visible to a snapshot S when they
+ *	were written by txn C <= S and S < F. #mdb_page_alloc() only
+ *	takes records older than every reader, so one long-lived reader
+ *	keeps all pages freed since its snapshot. This takes the records
+ *	whose pages were all written after the latest snapshot below F.
+ *	The last two commits and the last two durable ones count as
+ *	snapshots too, so the previous meta page stays usable.
+ *
+ *	Only this process' writes are known (#me_births), others count
+ *	as written before any snapshot. A scan resumes after the last
+ *	record checked, unless a reader below it went away.
+ *	The records are deleted by #mdb_freelist_save(), their pages are
+ *	merged into me_pghead. Records below \b oldest have been taken, so
+ *	me_pglast moves up to \b oldest - 1 to make room for the leftovers.
+ * @param[in] mc cursor of the allocating txn
+ * @param[in] oldest the current #mdb_find_oldest()
+ * @param[in] num the number of contiguous pages needed, 0 to take
+ *	all such records
+ * @param[out] ip index of an extent of \b num pages in me_pghead, or 0.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_freelist_gap(MDB_cursor *mc, txnid_t oldest, int num, unsigned *ip)
+{
+	MDB_txn *txn = mc->mc_txn;
+	MDB_env *env = txn->mt_env;
+	MDB_txninfo *ti = env->me_txns;
+	MDB_reader *r;
+	MDB_IDL snaps, old;
+	MDB_EXTL mop;
+	MDB_cursor m2;
+	MDB_val key, data;
+	MDB_cursor_op op = MDB_SET_RANGE;
+	txnid_t id, below, born, recent[4], start;
+	pgno_t *idl, pg;
+	unsigned i, j, n;
+	int rc;
+
+	*ip = 0;
+	if (!ti || !env->me_births || txn->mt_parent ||
+		mc->mc_dbi == FREE_DBI || oldest < 2)
+		return MDB_SUCCESS;
+
+	/* Snapshots of readers, sorted descending */
+	n = ti->mti_numreaders;
+	if (!(snaps = mdb_midl_alloc(n + 4)))
+		return ENOMEM;
+	r = ti->mti_readers;
+	for (i = 0; i < n; i++) {
+		id = r[i].mr_txnid;
+		if (r[i].mr_pid && id != (txnid_t)-1)
+			mdb_midl_xappend(snaps, id);
+	}
+	mdb_midl_sort(snaps);
+
+	/* Resume unless a reader we passed is gone */
+	start = env->me_pgscan;
+	if ((old = env->me_pgsnaps) != NULL) {
+		for (i = j = 1; i <= old[0] && start; i++) {
+			if (old[i] >= start)
+				continue;
+			while (j <= snaps[0] && snaps[j] > old[i])
+				j++;
+			if (j > snaps[0] || snaps[j] != old[i])
+				start = 0;
+		}
+		mdb_midl_free(old);
+	}
+	env->me_pgsnaps = snaps;
+	if (!(snaps = mdb_midl_alloc(env->me_pgsnaps[0] + 4)))
+		return ENOMEM;
+	memcpy(snaps, env->me_pgsnaps, MDB_IDL_SIZEOF(env->me_pgsnaps));
+	recent[0] = txn->mt_txnid - 1;
+	recent[1] = txn->mt_txnid - 2;
+	recent[2] = ti->mti_txnid;
+	recent[3] = ti->mti_txnid - 1;
+	for (i = 0; i < 4; i++) {
+		if (!recent[i] || recent[i] >= txn->mt_txnid)
+			continue;
+		mdb_midl_xappend(snaps, recent[i]);
+		/* Records they might block are checked each time */
+		if (start >= recent[i])
+			start = recent[i] - 1;
+	}
+	mdb_midl_sort(snaps);
+	if (start < oldest - 1)
+		start = oldest - 1;
+	start++;
+
+	mdb_cursor_init(&m2, txn, FREE_DBI, NULL);
+	key.mv_size = sizeof(start);
+	key.mv_data = &start;
+	for (;; op = MDB_NEXT) {
+		rc = mdb_cursor_get(&m2, &key, &data, op);
+		if (rc) {
+			if (rc == MDB_NOTFOUND)
+				rc = MDB_SUCCESS;
+			break;
+		}
+		id = *(txnid_t *)key.mv_data;
+		env->me_pgscan = id;
+		if (env->me_pggaps) {	/* taken by an earlier call */
+			i = mdb_midl_search(env->me_pggaps, id);
+			if (i <= env->me_pggaps[0] && env->me_pggaps[i] == id)
+				continue;
+		}
+
+		/* The latest snapshot below the record */
+		i = mdb_midl_search(snaps, id);
+		while (i <= snaps[0] && snaps[i] >= id)
+			i++;
+		below = i <= snaps[0] ? snaps[i] : 0;
+		idl = (pgno_t *)data.mv_data;
+		for (i = idl[0]; i; i--) {
+			pg = idl[i];
+			born = pg < env->me_births_len && env->me_births[pg]
+				? env->me_birth_base + env->me_births[pg] - 1 : 0;
+			if (born <= below)
+				break;
+		}
+		if (i)
+			continue;
+
+		if (!env->me_pggaps && !(env->me_pggaps = mdb_midl_alloc(16))) {
+			rc = ENOMEM;
+			break;
+		}
+		if ((rc = mdb_midl_append(&env->me_pggaps, id)) != 0)
+			break;
+		mdb_midl_sort(env->me_pggaps);
+		if (!env->me_pghead && !(env->me_pghead = mdb_mext_alloc(0))) {
+			rc = ENOMEM;
+			break;
+		}
+		if ((rc = mdb_mext_merge(&env->me_pghead, idl)) != 0)
+			break;
+		if (env->me_pglast < oldest - 1)
+			env->me_pglast = oldest - 1;
+		DPRINTF(("gap record %"Yu" below %"Yu" pages %"Yu,
+			id, below, idl[0]));
+
+		if (!num)
+			continue;
+		mop = env->me_pghead;
+		for (i = mop[0].mx_id; i; i--) {
+			if (mop[i].mx_len >= (MDB_ID)num) {
+				*ip = i;
+				goto done;
+			}
+		}
+	}
+done:
+	mdb_midl_free(snaps);
+	return rc;
+}
+
+/** Make room for \b num more pages in the txn's dirty list.
+ *	#mt_dirty_room limits the number of pages, this only grows
+ *	the storage.
+ */
+static int
+mdb_dirty_need(MDB_txn *txn, unsigned num)
+{
+	MDB_ID2L dl = txn->mt_u.dirty_list;
+	int rc;
+
+	if (dl[0].mid + num <= dl[-1].mid)
+		return MDB_SUCCESS;
+	rc = mdb_mid2l_need(&txn->mt_u.dirty_list, num);
+	if (!txn->mt_parent)
+		txn->mt_env->me_dirty_list = txn->mt_u.dirty_list;
+	return rc;
+}
+
+/** Add a page to the txn's dirty list.
+ *	The caller made room with #mdb_dirty_need().
+ */
 static void
 mdb_page_dirty(MDB_txn *txn, MDB_page *mp)
 {
+	MDB_env *env = txn->mt_env;
 	MDB_ID2 mid;
-	int rc, (*insert)(MDB_ID2L, MDB_ID2 *);
+	unsigned used;
+	int rc;
 
-	if (txn->mt_flags & MDB_TXN_WRITEMAP) {
-		insert = mdb_mid2l_append;
-	} else {
-		insert = mdb_mid2l_insert;
-	}
 	mid.mid = mp->mp_pgno;
 	mid.mptr = mp;
-	rc = insert(txn->mt_u.dirty_list, &mid);
+	rc = mdb_mid2l_add(txn->mt_u.dirty_list, &mid);
 	mdb_tassert(txn, rc == 0);
 	txn->mt_dirty_room--;
+	used = env->me_dirty_max - txn->mt_dirty_room;
+	if (env->me_spillstat.ms_dirty_peak < used)
+		env->me_spillstat.ms_dirty_peak = used;
 }
 
 /** Allocate page numbers and memory for writing.  Maintain me_pglast,
@@ -2407,7 +2756,8 @@ mdb_page_dirty(MDB_txn *txn, MDB_page *mp)
  * then uses the transaction's original snapshot of the freeDB.
  * @param[in] mc cursor A cursor handle identifying the transaction and
  *	database for which we are allocating.
- * @param[in] num the number of pages to allocate.
+ * @param[in] num the number of pages to allocate, or 0 to only merge
+ *	all reusable freeDB records into me_pghead.
  * @param[out] mp Address of the allocated page(s). Requests for multiple pages
  *  will always be satisfied by a single contiguous chunk of memory.
  * @return 0 on success, non-zero on failure.
@@ -2429,13 +2779,14 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 	int rc, retry = num * 60;
 	MDB_txn *txn = mc->mc_txn;
 	MDB_env *env = txn->mt_env;
-	pgno_t pgno, *mop = env->me_pghead;
-	unsigned i, j, mop_len = mop ? mop[0] : 0, n2 = num-1;
+	MDB_EXTL mop = env->me_pghead;
+	pgno_t pgno;
+	unsigned i, mop_len = mop ? mop[0].mx_id : 0;
 	MDB_page *np;
 	txnid_t oldest = 0, last;
 	MDB_cursor_op op;
 	MDB_cursor m2;
-	int found_old = 0;
+	int found_old = 0, reached = 0;
 
 	/* If there are any loose pages, just use them */
 	if (num == 1 && txn->mt_loose_pgs) {
@@ -2454,22 +2805,24 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		rc = MDB_TXN_FULL;
 		goto fail;
 	}
+	if ((rc = mdb_dirty_need(txn, 1)))
+		goto fail;
 
 	for (op = MDB_FIRST;; op = MDB_NEXT) {
 		MDB_val key, data;
 		MDB_node *leaf;
 		pgno_t *idl;
 
-		/* Seek a big enough contiguous page range. Prefer
-		 * pages at the tail, just truncating the list.
+		/* Seek a big enough extent. Prefer pages at the
+		 * tail, just truncating the list.
 		 */
-		if (mop_len > n2) {
+		if (mop_len && num) {
 			i = mop_len;
 			do {
-				pgno = mop[i];
-				if (mop[i-n2] == pgno+n2)
+				pgno = mop[i].mx_id;
+				if (mop[i].mx_len >= (MDB_ID)num)
 					goto search_done;
-			} while (--i > n2);
+			} while (--i);
 			if (--retry < 0)
 				break;
 		}
@@ -2506,8 +2859,10 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 				env->me_pgoldest = oldest;
 				found_old = 1;
 			}
-			if (oldest <= last)
+			if (oldest <= last) {
+				reached = 1;
 				break;
+			}
 		}
 		rc = mdb_cursor_get(&m2, &key, NULL, op);
 		if (rc) {
@@ -2522,8 +2877,20 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 				env->me_pgoldest = oldest;
 				found_old = 1;
 			}
-			if (oldest <= last)
+			if (oldest <= last) {
+				reached = 1;
 				break;
+			}
+		}
+		if (env->me_pggaps) {
+			/* Taken by #mdb_freelist_gap() while a reader that ended
+			 * since then was older. #mdb_freelist_save() deletes it.
+			 */
+			i = mdb_midl_search(env->me_pggaps, last);
+			if (i <= env->me_pggaps[0] && env->me_pggaps[i] == last) {
+				env->me_pglast = last;
+				continue;
+			}
 		}
 		np = m2.mc_pg[m2.mc_top];
 		leaf = NODEPTR(np, m2.mc_ki[m2.mc_top]);
@@ -2533,26 +2900,37 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		idl = (MDB_ID *) data.mv_data;
 		i = idl[0];
 		if (!mop) {
-			if (!(env->me_pghead = mop = mdb_midl_alloc(i))) {
+			if (!(env->me_pghead = mop = mdb_mext_alloc(0))) {
 				rc = ENOMEM;
 				goto fail;
 			}
-		} else {
-			if ((rc = mdb_midl_need(&env->me_pghead, i)) != 0)
-				goto fail;
-			mop = env->me_pghead;
 		}
+		/* Merge in descending sorted order, as extents */
+		if ((rc = mdb_mext_merge(&env->me_pghead, idl)) != 0)
+			goto fail;
+		mop = env->me_pghead;
 		env->me_pglast = last;
 #if (MDB_DEBUG) > 1
 		DPRINTF(("IDL read txn %"Yu" root %"Yu" num %u",
 			last, txn->mt_dbs[FREE_DBI].md_root, i));
-		for (j = i; j; j--)
-			DPRINTF(("IDL %"Yu, idl[j]));
+		for (; i; i--)
+			DPRINTF(("IDL %"Yu, idl[i]));
 #endif
-		/* Merge in descending sorted order */
-		mdb_midl_xmerge(mop, idl);
-		mop_len = mop[0];
+		mop_len = mop[0].mx_id;
+	}
+
+	/* Then records a long-lived reader does not need */
+	if (reached) {
+		if ((rc = mdb_freelist_gap(mc, oldest, num, &i)) != 0)
+			goto fail;
+		if (i) {
+			mop = env->me_pghead;
+			pgno = mop[i].mx_id;
+			goto search_done;
+		}
 	}
+	if (!num)
+		return MDB_SUCCESS;
 
 	/* Use new pages from the map when nothing suitable in the freeDB */
 	i = 0;
@@ -2587,10 +2965,7 @@ search_done:
 		}
 	}
 	if (i) {
-		mop[0] = mop_len -= num;
-		/* Move any stragglers down */
-		for (j = i-num; j < mop_len; )
-			mop[++j] = mop[++i];
+		mdb_mext_take(mop, i, num);
 	} else {
 		txn->mt_next_pgno = pgno + num;
 	}
@@ -2644,6 +3019,7 @@ mdb_page_unspill(MDB_txn *txn, MDB_page *mp, MDB_page **ret)
 	const MDB_txn *tx2;
 	unsigned x;
 	pgno_t pgno = mp->mp_pgno, pn = pgno << 1;
+	int rc;
 
 	for (tx2 = txn; tx2; tx2=tx2->mt_parent) {
 		if (!tx2->mt_spill_pgs)
@@ -2654,10 +3030,13 @@ mdb_page_unspill(MDB_txn *txn, MDB_page *mp, MDB_page **ret)
 			int num;
 			if (txn->mt_dirty_room == 0)
 				return MDB_TXN_FULL;
+			if ((rc = mdb_dirty_need(txn, 1)))
+				return rc;
 			if (IS_OVERFLOW(mp))
 				num = mp->mp_pages;
 			else
 				num = 1;
+			env->me_spillstat.ms_unspilled_pages += num;
 			if (env->me_flags & MDB_WRITEMAP) {
 				np = mp;
 			} else {
@@ -2732,29 +3111,28 @@ mdb_page_touch(MDB_cursor *mc)
 		}
 	} else if (txn->mt_parent && !IS_SUBP(mp)) {
 		MDB_ID2 mid, *dl = txn->mt_u.dirty_list;
+		unsigned x;
 		pgno = mp->mp_pgno;
 		/* If txn has a parent, make sure the page is in our
 		 * dirty list.
 		 */
-		if (dl[0].mid) {
-			unsigned x = mdb_mid2l_search(dl, pgno);
-			if (x <= dl[0].mid && dl[x].mid == pgno) {
-				if (mp != dl[x].mptr) { /* bad cursor? */
-					mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
-					txn->mt_flags |= MDB_TXN_ERROR;
-					return MDB_PROBLEM;
-				}
-				return 0;
+		if ((x = mdb_mid2l_find(dl, pgno)) != 0) {
+			if (mp != dl[x].mptr) { /* bad cursor? */
+				mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
+				txn->mt_flags |= MDB_TXN_ERROR;
+				return MDB_PROBLEM;
 			}
+			return 0;
 		}
-		mdb_cassert(mc, dl[0].mid < MDB_IDL_UM_MAX);
 		/* No - copy it */
+		if ((rc = mdb_dirty_need(txn, 1)))
+			return rc;
 		np = mdb_page_malloc(txn, 1);
 		if (!np)
 			return ENOMEM;
 		mid.mid = pgno;
 		mid.mptr = np;
-		rc = mdb_mid2l_insert(dl, &mid);
+		rc = mdb_mid2l_add(txn->mt_u.dirty_list, &mid);
 		mdb_cassert(mc, rc == 0);
 	} else {
 		return 0;
@@ -2827,10 +3205,94 @@ mdb_env_sync0(MDB_env *env, int force, pgno_t numpgs)
 int
 mdb_env_sync(MDB_env *env, int force)
 {
-	MDB_meta *m = mdb_env_pick_meta(env);
+	MDB_meta *m;
+	int rc;
+
+	if ((rc = mdb_env_async_wait(env)))
+		return rc;
+	m = mdb_env_pick_meta(env);
 	return mdb_env_sync0(env, force, m->mm_last_pg+1);
 }
 
+	/** Pages between two written runs that are synced along with them
+	 *	rather than costing another system call.
+	 */
+#define MDB_SYNC_GAP	16
+
+#ifdef SYNC_FILE_RANGE_WRITE
+	/* fdatasync() also writes the pages of earlier unsynced txns */
+# define MDB_SYNC_FULL(env)	0
+#else
+# define MDB_SYNC_FULL(env)	((env)->me_sync_full)
+#endif
+
+/** Sync the data pages of a write txn before its meta page is written.
+ *	With #MDB_WRITEMAP only the page runs written by the txn are
+ *	synced instead of the whole map, so the cost follows the size of
+ *	the txn rather than of the DB. On Linux their writeback is started
+ *	with sync_file_range(), then fdatasync() waits for it. Elsewhere
+ *	each run is msync()ed. Any txn that was not synced, or only
+ *	asynchronously, makes the next synced commit sync the whole map.
+ * @param[in] txn the transaction to sync.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_env_sync_txn(MDB_txn *txn)
+{
+	MDB_env *env = txn->mt_env;
+	MDB_IDL pl = env->me_sync_pgs;
+	MDB_ID start, end;
+	unsigned i;
+	size_t off, len, mask = env->me_os_psize - 1;
+	int rc = MDB_SUCCESS, flags;
+
+	if (F_ISSET(txn->mt_flags, MDB_TXN_NOSYNC) ||
+		F_ISSET(env->me_flags, MDB_NOSYNC)) {
+		env->me_sync_full = 1;
+		return MDB_SUCCESS;
+	}
+	flags = (env->me_flags & MDB_MAPASYNC) ? MS_ASYNC : MS_SYNC;
+	if (!(env->me_flags & MDB_WRITEMAP) || !pl ||
+		(MDB_SYNC_FULL(env) && flags == MS_SYNC) ||
+		mdb_midl_append_range(&env->me_sync_pgs, 0, NUM_METAS)) {
+		rc = mdb_env_sync0(env, 0, txn->mt_next_pgno);
+		if (!rc && flags == MS_SYNC)
+			env->me_sync_full = 0;
+		return rc;
+	}
+
+	/* The previous txn's meta page is synced with the runs, as the
+	 * whole map sync did, for #MDB_NOMETASYNC.
+	 */
+	pl = env->me_sync_pgs;
+	mdb_midl_sort(pl);
+	for (i = pl[0]; i && !rc; ) {
+		start = pl[i];
+		end = start + 1;
+		while (--i && pl[i] <= end + MDB_SYNC_GAP) {
+			if (pl[i] >= end)
+				end = pl[i] + 1;
+		}
+		off = start * env->me_psize;
+		len = (end - start) * env->me_psize + (off & mask);
+		off &= ~mask;
+#ifdef SYNC_FILE_RANGE_WRITE
+		if (sync_file_range(env->me_fd, off, len, SYNC_FILE_RANGE_WRITE))
+			rc = ErrCode();
+#else
+		if (MDB_MSYNC(env->me_map + off, len, flags))
+			rc = ErrCode();
+#endif
+	}
+#if defined(SYNC_FILE_RANGE_WRITE) || defined(_WIN32)
+	if (!rc && flags == MS_SYNC && MDB_FDATASYNC(env->me_fd))
+		rc = ErrCode();
+#endif
+	if (flags == MS_ASYNC)
+		env->me_sync_full = 1;
+	return rc;
+}
+
 /** Back up parent txn's cursors, then grab the originals for tracking */
 static int
 mdb_cursor_shadow(MDB_txn *src, MDB_txn *dst)
@@ -2973,7 +3435,7 @@ mdb_txn_renew0(MDB_txn *txn)
 {
 	MDB_env *env = txn->mt_env;
 	MDB_txninfo *ti = env->me_txns;
-	MDB_meta *meta;
+	MDB_meta *meta, pending;
 	unsigned int i, nr, flags = txn->mt_flags;
 	uint16_t x;
 	int rc, new_notls = 0;
@@ -3046,6 +3508,15 @@ mdb_txn_renew0(MDB_txn *txn)
 		if (ti) {
 			if (LOCK_MUTEX(rc, env, env->me_wmutex))
 				return rc;
+			mdb_env_async_other(env);
+		}
+		/* Build on our queued commit, which is not durable yet. Once
+		 * it is not queued any more, its meta page is written.
+		 */
+		if (mdb_env_async_meta(env, &pending)) {
+			meta = &pending;
+			txn->mt_txnid = pending.mm_txnid;
+		} else if (ti) {
 			txn->mt_txnid = ti->mti_txnid;
 			meta = env->me_metas[txn->mt_txnid & 1];
 		} else {
@@ -3060,12 +3531,20 @@ mdb_txn_renew0(MDB_txn *txn)
 		txn->mt_child = NULL;
 		txn->mt_loose_pgs = NULL;
 		txn->mt_loose_count = 0;
-		txn->mt_dirty_room = MDB_IDL_UM_MAX;
+		txn->mt_dirty_room = env->me_dirty_max;
 		txn->mt_u.dirty_list = env->me_dirty_list;
 		txn->mt_u.dirty_list[0].mid = 0;
+		mdb_mid2l_reindex(txn->mt_u.dirty_list);
 		txn->mt_free_pgs = env->me_free_pgs;
 		txn->mt_free_pgs[0] = 0;
 		txn->mt_spill_pgs = NULL;
+		if (env->me_flags & MDB_WRITEMAP) {
+			/* Without the list, commit syncs the whole map */
+			if (env->me_sync_pgs)
+				env->me_sync_pgs[0] = 0;
+			else
+				env->me_sync_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX);
+		}
 		env->me_txn = txn;
 		memcpy(txn->mt_dbiseqs, env->me_dbiseqs, env->me_maxdbs * sizeof(unsigned int));
 	}
@@ -3177,17 +3656,16 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 		unsigned int i;
 		txn->mt_cursors = (MDB_cursor **)(txn->mt_dbs + env->me_maxdbs);
 		txn->mt_dbiseqs = parent->mt_dbiseqs;
-		txn->mt_u.dirty_list = malloc(sizeof(MDB_ID2)*MDB_IDL_UM_SIZE);
+		txn->mt_u.dirty_list = mdb_mid2l_alloc(MDB_DIRTY_NESTED);
 		if (!txn->mt_u.dirty_list ||
 			!(txn->mt_free_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX)))
 		{
-			free(txn->mt_u.dirty_list);
+			mdb_mid2l_free(txn->mt_u.dirty_list);
 			free(txn);
 			return ENOMEM;
 		}
 		txn->mt_txnid = parent->mt_txnid;
 		txn->mt_dirty_room = parent->mt_dirty_room;
-		txn->mt_u.dirty_list[0].mid = 0;
 		txn->mt_spill_pgs = NULL;
 		txn->mt_next_pgno = parent->mt_next_pgno;
 		parent->mt_flags |= MDB_TXN_HAS_CHILD;
@@ -3205,8 +3683,8 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 		ntxn = (MDB_ntxn *)txn;
 		ntxn->mnt_pgstate = env->me_pgstate; /* save parent me_pghead & co */
 		if (env->me_pghead) {
-			size = MDB_IDL_SIZEOF(env->me_pghead);
-			env->me_pghead = mdb_midl_alloc(env->me_pghead[0]);
+			size = MDB_EXTL_SIZEOF(env->me_pghead);
+			env->me_pghead = mdb_mext_alloc(env->me_pghead[0].mx_id);
 			if (env->me_pghead)
 				memcpy(env->me_pghead, ntxn->mnt_pgstate.mf_pghead, size);
 			else
@@ -3317,7 +3795,7 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 		txn->mt_flags |= MDB_TXN_FINISHED;
 
 	} else if (!F_ISSET(txn->mt_flags, MDB_TXN_FINISHED)) {
-		pgno_t *pghead = env->me_pghead;
+		MDB_EXTL pghead = env->me_pghead;
 
 		if (!(mode & MDB_END_UPDATE)) /* !(already closed cursors) */
 			mdb_cursors_close(txn, 0);
@@ -3334,6 +3812,11 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 			/* me_pgstate: */
 			env->me_pghead = NULL;
 			env->me_pglast = 0;
+			if (env->me_pggaps)
+				env->me_pggaps[0] = 0;
+			/* Records it took are back, unless it committed */
+			if (!(mode & MDB_END_UPDATE))
+				env->me_pgscan = 0;
 
 			env->me_txn = NULL;
 			mode = 0;	/* txn == env->me_txn0, do not free() it */
@@ -3346,11 +3829,11 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 			txn->mt_parent->mt_flags &= ~MDB_TXN_HAS_CHILD;
 			env->me_pgstate = ((MDB_ntxn *)txn)->mnt_pgstate;
 			mdb_midl_free(txn->mt_free_pgs);
-			mdb_midl_free(txn->mt_spill_pgs);
-			free(txn->mt_u.dirty_list);
+			mdb_mid2l_free(txn->mt_u.dirty_list);
 		}
+		mdb_midl_free(txn->mt_spill_pgs);
 
-		mdb_midl_free(pghead);
+		mdb_mext_free(pghead);
 	}
 #ifdef MDB_VL32
 	if (!txn->mt_parent) {
@@ -3423,7 +3906,8 @@ mdb_freelist_save(MDB_txn *txn)
 	MDB_env	*env = txn->mt_env;
 	int rc, maxfree_1pg = env->me_maxfree_1pg, more = 1;
 	txnid_t	pglast = 0, head_id = 0;
-	pgno_t	freecnt = 0, *free_pgs, *mop;
+	pgno_t	freecnt = 0, *free_pgs;
+	MDB_EXTL mop;
 	ssize_t	head_room = 0, total_room = 0, mop_len, clean_limit;
 
 	mdb_cursor_init(&mc, txn, FREE_DBI, NULL);
@@ -3435,6 +3919,24 @@ mdb_freelist_save(MDB_txn *txn)
 			return rc;
 	}
 
+	/* Delete the records #mdb_freelist_gap() took. Allocations for
+	 * the freeDB do not take more.
+	 */
+	if (env->me_pggaps) {
+		MDB_val key;
+		unsigned i;
+		for (i = env->me_pggaps[0]; i; i--) {
+			key.mv_size = sizeof(txnid_t);
+			key.mv_data = &env->me_pggaps[i];
+			rc = mdb_cursor_get(&mc, &key, NULL, MDB_SET);
+			if (!rc)
+				rc = mdb_cursor_del(&mc, 0);
+			if (rc)
+				return rc;
+		}
+		env->me_pggaps[0] = 0;
+	}
+
 	if (!env->me_pghead && txn->mt_loose_pgs) {
 		/* Put loose page numbers in mt_free_pgs, since
 		 * we may be unable to return them to me_pghead.
@@ -3463,6 +3965,13 @@ mdb_freelist_save(MDB_txn *txn)
 		 */
 		while (pglast < env->me_pglast) {
 			rc = mdb_cursor_first(&mc, &key, NULL);
+			if (rc == MDB_NOTFOUND ||
+				(!rc && *(txnid_t *)key.mv_data > env->me_pglast)) {
+				/* #mdb_freelist_gap() moved me_pglast past missing keys */
+				pglast = head_id = env->me_pglast;
+				total_room = head_room = 0;
+				break;
+			}
 			if (rc)
 				return rc;
 			pglast = head_id = *(txnid_t *)key.mv_data;
@@ -3509,7 +4018,7 @@ mdb_freelist_save(MDB_txn *txn)
 		}
 
 		mop = env->me_pghead;
-		mop_len = (mop ? mop[0] : 0) + txn->mt_loose_count;
+		mop_len = (mop ? mop[0].mx_len : 0) + txn->mt_loose_count;
 
 		/* Reserve records for me_pghead[]. Split it if multi-page,
 		 * to avoid searching freeDB for a page range. Use keys in
@@ -3554,34 +4063,37 @@ mdb_freelist_save(MDB_txn *txn)
 	 */
 	if (txn->mt_loose_pgs) {
 		MDB_page *mp = txn->mt_loose_pgs;
-		unsigned count = txn->mt_loose_count;
-		MDB_IDL loose;
-		/* Room for loose pages + temp IDL with same */
-		if ((rc = mdb_midl_need(&env->me_pghead, 2*count+1)) != 0)
-			return rc;
-		mop = env->me_pghead;
-		loose = mop + MDB_IDL_ALLOCLEN(mop) - count;
-		for (count = 0; mp; mp = NEXT_LOOSE_PAGE(mp))
-			loose[ ++count ] = mp->mp_pgno;
-		loose[0] = count;
+		MDB_IDL loose = mdb_midl_alloc(txn->mt_loose_count);
+		if (!loose)
+			return ENOMEM;
+		for (; mp; mp = NEXT_LOOSE_PAGE(mp))
+			mdb_midl_xappend(loose, mp->mp_pgno);
 		mdb_midl_sort(loose);
-		mdb_midl_xmerge(mop, loose);
+		rc = mdb_mext_merge(&env->me_pghead, loose);
+		mdb_midl_free(loose);
+		if (rc)
+			return rc;
 		txn->mt_loose_pgs = NULL;
 		txn->mt_loose_count = 0;
-		mop_len = mop[0];
+		mop_len = env->me_pghead[0].mx_len;
 	}
 
-	/* Fill in the reserved me_pghead records */
+	/* Fill in the reserved me_pghead records, expanding the extents
+	 * from the lowest pages on
+	 */
 	rc = MDB_SUCCESS;
 	if (mop_len) {
 		MDB_val key, data;
+		MDB_ID x, off = 0;
 
-		mop += mop_len;
+		mop = env->me_pghead;
+		x = mop[0].mx_id;
 		rc = mdb_cursor_first(&mc, &key, &data);
 		for (; !rc; rc = mdb_cursor_next(&mc, &key, &data, MDB_NEXT)) {
 			txnid_t id = *(txnid_t *)key.mv_data;
 			ssize_t	len = (ssize_t)(data.mv_size / sizeof(MDB_ID)) - 1;
-			MDB_ID save;
+			ssize_t j;
+			pgno_t *pgs;
 
 			mdb_tassert(txn, len >= 0 && id <= env->me_pglast);
 			key.mv_data = &id;
@@ -3589,66 +4101,412 @@ mdb_freelist_save(MDB_txn *txn)
 				len = mop_len;
 				data.mv_size = (len + 1) * sizeof(MDB_ID);
 			}
-			data.mv_data = mop -= len;
-			save = mop[0];
-			mop[0] = len;
-			rc = mdb_cursor_put(&mc, &key, &data, MDB_CURRENT);
-			mop[0] = save;
-			if (rc || !(mop_len -= len))
+			rc = mdb_cursor_put(&mc, &key, &data, MDB_CURRENT|MDB_RESERVE);
+			if (rc)
+				break;
+			pgs = (pgno_t *)data.mv_data;
+			pgs[0] = len;
+			for (j = len; j; j--) {
+				pgs[j] = mop[x].mx_id + off;
+				if (++off == mop[x].mx_len) {
+					x--;
+					off = 0;
+				}
+			}
+			if (!(mop_len -= len))
 				break;
 		}
 	}
 	return rc;
 }
 
-/** Flush (some) dirty pages to the map, after clearing their dirty flag.
- * @param[in] txn the transaction that's being committed
- * @param[in] keep number of initial pages in dirty_list to keep dirty.
- * @return 0 on success, non-zero on failure.
+#ifdef MDB_USE_URING
+/** @defgroup uring	io_uring commit writes
+ *	With #mdb_env_set_uring(), #mdb_page_flush() queues its writev
+ *	batches on an io_uring instead of writing them one after the other,
+ *	and waits for all of them at the end. #mdb_env_write_meta() then
+ *	submits the data fsync, the meta page write and the meta fsync as
+ *	one linked chain.
+ *	@{
  */
-static int
-mdb_page_flush(MDB_txn *txn, int keep)
+	/** A queued write or fsync */
+typedef struct MDB_uring_op {
+	lmdb_off_t	uo_pos;		/**< file offset of a write */
+	size_t		uo_size;	/**< bytes to write, 0 for an fsync */
+	int			uo_cnt;		/**< number of iovecs of a write */
+	int			uo_res;		/**< result of the completion */
+} MDB_uring_op;
+
+	/** An io_uring instance and its mapped rings */
+typedef struct MDB_uring {
+	int			mu_fd;		/**< from io_uring_setup() */
+	unsigned	mu_entries;	/**< size of the submission queue */
+	unsigned	mu_start;	/**< first SQE not yet reaped */
+	unsigned	mu_submitted;	/**< SQEs handed to the kernel */
+	unsigned	mu_tail;	/**< next SQE to fill */
+	void		*mu_ring;	/**< the SQ and CQ rings */
+	size_t		mu_ringsz;
+	struct io_uring_sqe	*mu_sqes;
+	unsigned	*mu_sqtail, *mu_sqmask, *mu_sqarray;
+	unsigned	*mu_cqhead, *mu_cqtail, *mu_cqmask;
+	struct io_uring_cqe	*mu_cqes;
+	struct iovec	*mu_iov;	/**< #MDB_COMMIT_PAGES iovecs per SQE */
+	MDB_uring_op	*mu_ops;	/**< one per SQE */
+} MDB_uring;
+
+	/** Use the io_uring for this env's commits */
+#define MDB_URING(env)	((env)->me_uring && !((env)->me_flags & MDB_WRITEMAP))
+
+static int mdb_fd_pwrite(HANDLE fd, const char *ptr, size_t size,
+	lmdb_off_t pos);
+
+static void ESECT
+mdb_uring_close(MDB_env *env)
 {
-	MDB_env		*env = txn->mt_env;
-	MDB_ID2L	dl = txn->mt_u.dirty_list;
-	unsigned	psize = env->me_psize, j;
-	int			i, pagecount = dl[0].mid, rc;
-	size_t		size = 0;
-	lmdb_off_t	pos = 0;
-	pgno_t		pgno = 0;
-	MDB_page	*dp = NULL;
-#ifdef _WIN32
-	OVERLAPPED	ov;
-#else
-	struct iovec iov[MDB_COMMIT_PAGES];
-	ssize_t		wsize = 0, wres;
-	lmdb_off_t	wpos = 0, next_pos = 1; /* impossible pos, so pos != next_pos */
-	int			n = 0;
-#endif
+	MDB_uring *ur = env->me_uring;
 
-	j = i = keep;
+	if (!ur)
+		return;
+	if (ur->mu_sqes)
+		munmap(ur->mu_sqes, ur->mu_entries * sizeof(struct io_uring_sqe));
+	if (ur->mu_ring)
+		munmap(ur->mu_ring, ur->mu_ringsz);
+	close(ur->mu_fd);
+	free(ur->mu_iov);
+	free(ur->mu_ops);
+	free(ur);
+	env->me_uring = NULL;
+}
 
-	if (env->me_flags & MDB_WRITEMAP) {
-		/* Clear dirty flags */
-		while (++i <= pagecount) {
-			dp = dl[i].mptr;
-			/* Don't flush this page yet */
-			if (dp->mp_flags & (P_LOOSE|P_KEEP)) {
-				dp->mp_flags &= ~P_KEEP;
-				dl[++j] = dl[i];
-				continue;
-			}
-			dp->mp_flags &= ~P_DIRTY;
-		}
-		goto done;
+static int ESECT
+mdb_uring_open(MDB_env *env, unsigned int depth)
+{
+	struct io_uring_params p;
+	MDB_uring *ur;
+	char *ring;
+	size_t cqsz;
+	void *sqes;
+	int rc;
+
+	if ((ur = calloc(1, sizeof(MDB_uring))) == NULL)
+		return ENOMEM;
+	memset(&p, 0, sizeof(p));
+	ur->mu_fd = syscall(__NR_io_uring_setup, depth, &p);
+	if (ur->mu_fd < 0) {
+		rc = ErrCode();
+		free(ur);
+		return rc;
+	}
+	env->me_uring = ur;
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {	/* Linux < 5.4 */
+		rc = ENOSYS;
+		goto fail;
 	}
+	ur->mu_entries = p.sq_entries;
+	ur->mu_ringsz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cqsz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (ur->mu_ringsz < cqsz)
+		ur->mu_ringsz = cqsz;
+	ring = mmap(NULL, ur->mu_ringsz, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, ur->mu_fd, IORING_OFF_SQ_RING);
+	if (ring == MAP_FAILED) {
+		rc = ErrCode();
+		goto fail;
+	}
+	ur->mu_ring = ring;
+	sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+		PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ur->mu_fd,
+		IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		rc = ErrCode();
+		goto fail;
+	}
+	ur->mu_sqes = sqes;
+	ur->mu_sqtail = (unsigned *)(ring + p.sq_off.tail);
+	ur->mu_sqmask = (unsigned *)(ring + p.sq_off.ring_mask);
+	ur->mu_sqarray = (unsigned *)(ring + p.sq_off.array);
+	ur->mu_cqhead = (unsigned *)(ring + p.cq_off.head);
+	ur->mu_cqtail = (unsigned *)(ring + p.cq_off.tail);
+	ur->mu_cqmask = (unsigned *)(ring + p.cq_off.ring_mask);
+	ur->mu_cqes = (struct io_uring_cqe *)(ring + p.cq_off.cqes);
+	ur->mu_start = ur->mu_submitted = ur->mu_tail = *ur->mu_sqtail;
+
+	ur->mu_iov = malloc(ur->mu_entries * MDB_COMMIT_PAGES *
+		sizeof(struct iovec));
+	ur->mu_ops = malloc(ur->mu_entries * sizeof(MDB_uring_op));
+	if (!ur->mu_iov || !ur->mu_ops) {
+		rc = ENOMEM;
+		goto fail;
+	}
+	return MDB_SUCCESS;
 
-	/* Write the pages */
-	for (;;) {
-		if (++i <= pagecount) {
-			dp = dl[i].mptr;
-			/* Don't flush this page yet */
-			if (dp->mp_flags & (P_LOOSE|P_KEEP)) {
+fail:
+	mdb_uring_close(env);
+	return rc;
+}
+
+	/** Hand the filled SQEs to the kernel, and wait for a completion
+	 *	if \b wait is set.
+	 */
+static int
+mdb_uring_submit(MDB_uring *ur, int wait)
+{
+	int rc;
+
+	__atomic_store_n(ur->mu_sqtail, ur->mu_tail, __ATOMIC_RELEASE);
+	for (;;) {
+		rc = syscall(__NR_io_uring_enter, ur->mu_fd,
+			ur->mu_tail - ur->mu_submitted, wait ? 1 : 0,
+			wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (rc >= 0)
+			break;
+		rc = ErrCode();
+		if (rc != EINTR && rc != EAGAIN && rc != EBUSY)
+			return rc;
+	}
+	ur->mu_submitted += rc;
+	return MDB_SUCCESS;
+}
+
+	/** Get the next SQE, for the caller to fill in.
+	 * @param[in] ur the io_uring
+	 * @param[in] size bytes to write, or 0 for an fsync
+	 * @param[out] slot index of the SQE, its iovecs and its #MDB_uring_op
+	 */
+static struct io_uring_sqe *
+mdb_uring_sqe(MDB_uring *ur, size_t size, unsigned *slot)
+{
+	unsigned idx = ur->mu_tail++ & *ur->mu_sqmask;
+	struct io_uring_sqe *sqe = &ur->mu_sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = idx;
+	ur->mu_sqarray[idx] = idx;
+	ur->mu_ops[idx].uo_size = size;
+	*slot = idx;
+	return sqe;
+}
+
+static int
+mdb_uring_fsync(MDB_env *env)
+{
+	int rc = (env->me_flags & MDB_FSYNCONLY) ? fsync(env->me_fd)
+		: MDB_FDATASYNC(env->me_fd);
+	return rc ? ErrCode() : MDB_SUCCESS;
+}
+
+	/** Submit all queued SQEs and wait for their completions.
+	 *	Short writes are finished with pwrite(), so are SQEs linked
+	 *	after them. Operations are checked in submission order, and
+	 *	nothing after the first failure is redone.
+	 * @return 0 on success, the first error otherwise.
+	 */
+static int
+mdb_uring_reap(MDB_env *env)
+{
+	MDB_uring *ur = env->me_uring;
+	MDB_uring_op *op;
+	struct iovec *iov;
+	unsigned head, tail, done = 0, pending = ur->mu_tail - ur->mu_start;
+	size_t skip;
+	int rc = 0, res, j;
+
+	while (done < pending) {
+		head = *ur->mu_cqhead;
+		tail = __atomic_load_n(ur->mu_cqtail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++, done++) {
+			struct io_uring_cqe *cqe = &ur->mu_cqes[head & *ur->mu_cqmask];
+			ur->mu_ops[cqe->user_data].uo_res = cqe->res;
+		}
+		__atomic_store_n(ur->mu_cqhead, head, __ATOMIC_RELEASE);
+		if (done < pending && (rc = mdb_uring_submit(ur, 1))) {
+			/* In-flight writes may still read our pages */
+			env->me_flags |= MDB_FATAL_ERROR;
+			return rc;
+		}
+	}
+
+	for (; ur->mu_start != ur->mu_tail; ur->mu_start++) {
+		j = ur->mu_start & *ur->mu_sqmask;
+		op = &ur->mu_ops[j];
+		res = op->uo_res;
+		if (rc)
+			continue;
+		if (res >= 0 && (size_t)res >= op->uo_size)
+			continue;
+		if (res < 0 && res != -ECANCELED) {
+			rc = -res;
+			continue;
+		}
+		if (!op->uo_size) {
+			rc = mdb_uring_fsync(env);
+			continue;
+		}
+		DPUTS("short write, finishing it with pwrite");
+		iov = &ur->mu_iov[j * MDB_COMMIT_PAGES];
+		skip = res < 0 ? 0 : res;
+		for (j = 0; j < op->uo_cnt && !rc; j++) {
+			if (skip < iov[j].iov_len) {
+				rc = mdb_fd_pwrite(env->me_fd, (char *)iov[j].iov_base + skip,
+					iov[j].iov_len - skip, op->uo_pos + skip);
+				skip = 0;
+			} else {
+				skip -= iov[j].iov_len;
+			}
+			op->uo_pos += iov[j].iov_len;
+		}
+	}
+	return rc;
+}
+
+	/** Queue a writev of \b n iovecs, \b size bytes in all, at \b pos.
+	 *	The iovecs are copied. The pages must stay around until the
+	 *	next #mdb_uring_reap().
+	 */
+static int
+mdb_uring_writev(MDB_env *env, struct iovec *iov, int n, lmdb_off_t pos,
+	size_t size)
+{
+	MDB_uring *ur = env->me_uring;
+	struct io_uring_sqe *sqe;
+	unsigned slot;
+	int rc;
+
+	if (ur->mu_tail - ur->mu_start == ur->mu_entries &&
+		(rc = mdb_uring_reap(env)))
+		return rc;
+	sqe = mdb_uring_sqe(ur, size, &slot);
+	memcpy(&ur->mu_iov[slot * MDB_COMMIT_PAGES], iov, n * sizeof(*iov));
+	ur->mu_ops[slot].uo_pos = pos;
+	ur->mu_ops[slot].uo_cnt = n;
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = env->me_fd;
+	sqe->addr = (uintptr_t)&ur->mu_iov[slot * MDB_COMMIT_PAGES];
+	sqe->len = n;
+	sqe->off = pos;
+	/* Keep the device busy while we collect more pages */
+	if (ur->mu_tail - ur->mu_submitted >= (ur->mu_entries + 3) / 4 &&
+		(rc = mdb_uring_submit(ur, 0))) {
+		mdb_uring_reap(env);
+		return rc;
+	}
+	return MDB_SUCCESS;
+}
+
+	/** Write the meta page like pwrite(), after an fsync of the data
+	 *	pages, and fsync it too unless #MDB_NOMETASYNC. The three are
+	 *	linked, each starts only after the previous one succeeded.
+	 * @return len on success, -1 with errno set on failure.
+	 */
+static int
+mdb_uring_meta(MDB_env *env, unsigned flags, char *ptr, int len,
+	lmdb_off_t off)
+{
+	MDB_uring *ur = env->me_uring;
+	struct io_uring_sqe *sqe;
+	unsigned slot;
+	int rc;
+
+	if ((rc = mdb_uring_reap(env)))
+		goto fail;
+	if (!(flags & MDB_NOSYNC)) {
+		sqe = mdb_uring_sqe(ur, 0, &slot);
+		sqe->opcode = IORING_OP_FSYNC;
+		sqe->fd = env->me_fd;
+		if (!(env->me_flags & MDB_FSYNCONLY))
+			sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		sqe->flags = IOSQE_IO_LINK;
+	}
+	sqe = mdb_uring_sqe(ur, len, &slot);
+	ur->mu_iov[slot * MDB_COMMIT_PAGES].iov_base = ptr;
+	ur->mu_iov[slot * MDB_COMMIT_PAGES].iov_len = len;
+	ur->mu_ops[slot].uo_pos = off;
+	ur->mu_ops[slot].uo_cnt = 1;
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = env->me_fd;
+	sqe->addr = (uintptr_t)&ur->mu_iov[slot * MDB_COMMIT_PAGES];
+	sqe->len = 1;
+	sqe->off = off;
+	if (!(flags & (MDB_NOSYNC|MDB_NOMETASYNC))) {
+		sqe->flags = IOSQE_IO_LINK;
+		sqe = mdb_uring_sqe(ur, 0, &slot);
+		sqe->opcode = IORING_OP_FSYNC;
+		sqe->fd = env->me_fd;
+		if (!(env->me_flags & MDB_FSYNCONLY))
+			sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+	}
+	if ((rc = mdb_uring_submit(ur, 0)) == MDB_SUCCESS)
+		rc = mdb_uring_reap(env);
+	else
+		mdb_uring_reap(env);
+	if (rc == MDB_SUCCESS)
+		return len;
+fail:
+	errno = rc;
+	return -1;
+}
+/** @} */
+#else
+#define MDB_URING(env)	0
+#endif
+
+/** Flush (some) dirty pages to the map, after clearing their dirty flag.
+ * @param[in] txn the transaction that's being committed
+ * @param[in] keep number of initial pages in dirty_list to keep dirty.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_page_flush(MDB_txn *txn, int keep)
+{
+	MDB_env		*env = txn->mt_env;
+	MDB_ID2L	dl = txn->mt_u.dirty_list;
+	unsigned	psize = env->me_psize, j;
+	int			i, pagecount = dl[0].mid, rc;
+	size_t		size = 0;
+	lmdb_off_t	pos = 0;
+	pgno_t		pgno = 0;
+	MDB_page	*dp = NULL;
+#ifdef _WIN32
+	OVERLAPPED	ov;
+#else
+	struct iovec iov[MDB_COMMIT_PAGES];
+	ssize_t		wsize = 0, wres;
+	lmdb_off_t	wpos = 0, next_pos = 1; /* impossible pos, so pos != next_pos */
+	int			n = 0;
+#endif
+
+	j = i = keep;
+
+	if (env->me_flags & MDB_WRITEMAP) {
+		/* Clear dirty flags */
+		while (++i <= pagecount) {
+			dp = dl[i].mptr;
+			/* Don't flush this page yet */
+			if (dp->mp_flags & (P_LOOSE|P_KEEP)) {
+				dp->mp_flags &= ~P_KEEP;
+				dl[++j] = dl[i];
+				continue;
+			}
+			dp->mp_flags &= ~P_DIRTY;
+			mdb_page_birth(txn, dl[i].mid, IS_OVERFLOW(dp) ? dp->mp_pages : 1);
+			if (env->me_sync_pgs && mdb_midl_append_range(&env->me_sync_pgs,
+				dl[i].mid, IS_OVERFLOW(dp) ? dp->mp_pages : 1)) {
+				mdb_midl_free(env->me_sync_pgs);
+				env->me_sync_pgs = NULL;
+			}
+		}
+		goto done;
+	}
+
+	/* The dirty list is sorted only here, for contiguous writes */
+	mdb_mid2l_sort(dl);
+
+	/* Write the pages */
+	for (;;) {
+		if (++i <= pagecount) {
+			dp = dl[i].mptr;
+			/* Don't flush this page yet */
+			if (dp->mp_flags & (P_LOOSE|P_KEEP)) {
 				dp->mp_flags &= ~P_KEEP;
 				dl[i].mid = 0;
 				continue;
@@ -3659,6 +4517,7 @@ mdb_page_flush(MDB_txn *txn, int keep)
 			pos = pgno * psize;
 			size = psize;
 			if (IS_OVERFLOW(dp)) size *= dp->mp_pages;
+			mdb_page_birth(txn, pgno, size / psize);
 		}
 #ifdef _WIN32
 		else break;
@@ -3683,6 +4542,13 @@ mdb_page_flush(MDB_txn *txn, int keep)
 		/* Write up to MDB_COMMIT_PAGES dirty pages at a time. */
 		if (pos!=next_pos || n==MDB_COMMIT_PAGES || wsize+size>MAX_WRITE) {
 			if (n) {
+#ifdef MDB_USE_URING
+				if (env->me_uring) {
+					if ((rc = mdb_uring_writev(env, iov, n, wpos, wsize)))
+						return rc;
+					goto written;
+				}
+#endif
 retry_write:
 				/* Write previous page(s) */
 #ifdef MDB_USE_PWRITEV
@@ -3714,6 +4580,9 @@ retry_seek:
 					}
 					return rc;
 				}
+#ifdef MDB_USE_URING
+written:
+#endif
 				n = 0;
 			}
 			if (i > pagecount)
@@ -3729,6 +4598,10 @@ retry_seek:
 		n++;
 #endif	/* _WIN32 */
 	}
+#ifdef MDB_USE_URING
+	if (env->me_uring && (rc = mdb_uring_reap(env)))
+		return rc;
+#endif
 #ifdef MDB_VL32
 	if (pgno > txn->mt_last_pgno)
 		txn->mt_last_pgno = pgno;
@@ -3755,19 +4628,26 @@ done:
 	i--;
 	txn->mt_dirty_room += i - j;
 	dl[0].mid = j;
+	mdb_mid2l_reindex(dl);
 	return MDB_SUCCESS;
 }
 
-int
-mdb_txn_commit(MDB_txn *txn)
+/** Commit a transaction.
+ * @param[in] txn the transaction to commit
+ * @param[in] func if non-NULL, queue the sync and meta page write of a
+ * top-level write txn for #mdb_txn_commit_async(), and call \b func
+ * once they are done. Otherwise \b func is called before returning.
+ * @param[in] ctx the context for \b func
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_txn_commit0(MDB_txn *txn, MDB_commit_func *func, void *ctx)
 {
 	int		rc;
 	unsigned int i, end_mode;
+	txnid_t	txnid;
 	MDB_env	*env;
 
-	if (txn == NULL)
-		return EINVAL;
-
 	/* mdb_txn_end() mode for a commit which writes nothing */
 	end_mode = MDB_END_EMPTY_COMMIT|MDB_END_UPDATE|MDB_END_SLOT|MDB_END_FREE;
 
@@ -3798,6 +4678,10 @@ mdb_txn_commit(MDB_txn *txn)
 		MDB_IDL pspill;
 		unsigned x, y, len, ps_len;
 
+		/* Room for merging our dirty list into parent's */
+		if ((rc = mdb_dirty_need(parent, txn->mt_u.dirty_list[0].mid)))
+			goto fail;
+
 		/* Append our free list to parent's */
 		rc = mdb_midl_append_list(&parent->mt_free_pgs, txn->mt_free_pgs);
 		if (rc)
@@ -3826,6 +4710,8 @@ mdb_txn_commit(MDB_txn *txn)
 
 		dst = parent->mt_u.dirty_list;
 		src = txn->mt_u.dirty_list;
+		mdb_mid2l_sort(dst);
+		mdb_mid2l_sort(src);
 		/* Remove anything in our dirty list from parent's spill list */
 		if ((pspill = parent->mt_spill_pgs) && (ps_len = pspill[0])) {
 			x = y = ps_len;
@@ -3882,7 +4768,7 @@ mdb_txn_commit(MDB_txn *txn)
 				}
 			}
 		} else { /* Simplify the above for single-ancestor case */
-			len = MDB_IDL_UM_MAX - txn->mt_dirty_room;
+			len = env->me_dirty_max - txn->mt_dirty_room;
 		}
 		/* Merge our dirty list with parent's */
 		y = src[0].mid;
@@ -3895,7 +4781,8 @@ mdb_txn_commit(MDB_txn *txn)
 		}
 		mdb_tassert(txn, i == x);
 		dst[0].mid = len;
-		free(txn->mt_u.dirty_list);
+		mdb_mid2l_reindex(dst);
+		mdb_mid2l_free(txn->mt_u.dirty_list);
 		parent->mt_dirty_room = txn->mt_dirty_room;
 		if (txn->mt_spill_pgs) {
 			if (parent->mt_spill_pgs) {
@@ -3917,8 +4804,11 @@ mdb_txn_commit(MDB_txn *txn)
 		parent->mt_loose_count += txn->mt_loose_count;
 
 		parent->mt_child = NULL;
-		mdb_midl_free(((MDB_ntxn *)txn)->mnt_pgstate.mf_pghead);
+		mdb_mext_free(((MDB_ntxn *)txn)->mnt_pgstate.mf_pghead);
+		txnid = txn->mt_txnid;
 		free(txn);
+		if (func && !rc)
+			func(ctx, txnid, MDB_SUCCESS);
 		return rc;
 	}
 
@@ -3964,7 +4854,7 @@ mdb_txn_commit(MDB_txn *txn)
 	if (rc)
 		goto fail;
 
-	mdb_midl_free(env->me_pghead);
+	mdb_mext_free(env->me_pghead);
 	env->me_pghead = NULL;
 	mdb_midl_shrink(&txn->mt_free_pgs);
 
@@ -3974,15 +4864,36 @@ mdb_txn_commit(MDB_txn *txn)
 
 	if ((rc = mdb_page_flush(txn, 0)))
 		goto fail;
-	if (!F_ISSET(txn->mt_flags, MDB_TXN_NOSYNC) &&
-		(rc = mdb_env_sync0(env, 0, txn->mt_next_pgno)))
+	/* Our pages were free in the meta page of a queued commit too,
+	 * but our meta page must not overtake it.
+	 */
+	if ((rc = mdb_env_async_wait(env)))
+		goto fail;
+#ifdef MDB_USE_ASYNC
+	if (func && !((txn->mt_flags | env->me_flags) & (MDB_NOSYNC|MDB_WRITEMAP))) {
+#ifdef MDB_USE_URING
+		if (MDB_URING(env) && (rc = mdb_uring_reap(env)))
+			goto fail;
+#endif
+		if (mdb_env_async_queue(txn, func, ctx) == MDB_SUCCESS) {
+			func = NULL;
+			end_mode = MDB_END_COMMITTED|MDB_END_UPDATE;
+			goto done;
+		}
+	}
+#endif
+	/* With io_uring the data sync is linked before the meta write */
+	if (!MDB_URING(env) && (rc = mdb_env_sync_txn(txn)))
 		goto fail;
 	if ((rc = mdb_env_write_meta(txn)))
 		goto fail;
 	end_mode = MDB_END_COMMITTED|MDB_END_UPDATE;
 
 done:
+	txnid = txn->mt_txnid;
 	mdb_txn_end(txn, end_mode);
+	if (func)
+		func(ctx, txnid, MDB_SUCCESS);
 	return MDB_SUCCESS;
 
 fail:
@@ -3990,6 +4901,30 @@ fail:
 	return rc;
 }
 
+int
+mdb_txn_commit(MDB_txn *txn)
+{
+	if (txn == NULL)
+		return EINVAL;
+	return mdb_txn_commit0(txn, NULL, NULL);
+}
+
+int
+mdb_txn_commit_async(MDB_txn *txn, MDB_commit_func *func, void *ctx)
+{
+	if (txn == NULL || func == NULL)
+		return EINVAL;
+	return mdb_txn_commit0(txn, func, ctx);
+}
+
+int
+mdb_env_commit_wait(MDB_env *env)
+{
+	if (env == NULL)
+		return EINVAL;
+	return mdb_env_async_wait(env);
+}
+
 /** Read the environment parameters of a DB environment before
  * mapping it into memory.
  * @param[in] env the environment handle
@@ -4123,19 +5058,21 @@ mdb_env_init_meta(MDB_env *env, MDB_meta *meta)
 	return rc;
 }
 
-/** Update the environment info to commit a transaction.
- * @param[in] txn the transaction that's being committed
+/** Write a meta page to the file and publish its txn to readers.
+ * @param[in] env the environment handle
+ * @param[in] meta the new values from #mm_mapsize on, its #mm_txnid
+ * selects the meta page.
+ * @param[in] flags the txn and env flags of the commit
+ * @param[in] async non-zero from the #mdb_txn_commit_async() thread,
+ * which must not share the io_uring of the writer.
  * @return 0 on success, non-zero on failure.
  */
 static int
-mdb_env_write_meta(MDB_txn *txn)
+mdb_env_write_meta0(MDB_env *env, MDB_meta *meta, unsigned flags, int async)
 {
-	MDB_env *env;
-	MDB_meta	meta, metab, *mp;
-	unsigned flags;
-	mdb_size_t mapsize;
+	MDB_meta	metab, *mp;
 	lmdb_off_t off;
-	int rc, len, toggle;
+	int rc, len;
 	char *ptr;
 	HANDLE mfd;
 #ifdef _WIN32
@@ -4144,56 +5081,12 @@ mdb_env_write_meta(MDB_txn *txn)
 	int r2;
 #endif
 
-	toggle = txn->mt_txnid & 1;
-	DPRINTF(("writing meta page %d for root page %"Yu,
-		toggle, txn->mt_dbs[MAIN_DBI].md_root));
-
-	env = txn->mt_env;
-	flags = txn->mt_flags | env->me_flags;
-	mp = env->me_metas[toggle];
-	mapsize = env->me_metas[toggle ^ 1]->mm_mapsize;
-	/* Persist any increases of mapsize config */
-	if (mapsize < env->me_mapsize)
-		mapsize = env->me_mapsize;
-
-	if (flags & MDB_WRITEMAP) {
-		mp->mm_mapsize = mapsize;
-		mp->mm_dbs[FREE_DBI] = txn->mt_dbs[FREE_DBI];
-		mp->mm_dbs[MAIN_DBI] = txn->mt_dbs[MAIN_DBI];
-		mp->mm_last_pg = txn->mt_next_pgno - 1;
-#if (__GNUC__ * 100 + __GNUC_MINOR__ >= 404) && /* TODO: portability */	\
-	!(defined(__i386__) || defined(__x86_64__))
-		/* LY: issue a memory barrier, if not x86. ITS#7969 */
-		__sync_synchronize();
-#endif
-		mp->mm_txnid = txn->mt_txnid;
-		if (!(flags & (MDB_NOMETASYNC|MDB_NOSYNC))) {
-			unsigned meta_size = env->me_psize;
-			rc = (env->me_flags & MDB_MAPASYNC) ? MS_ASYNC : MS_SYNC;
-			ptr = (char *)mp - PAGEHDRSZ;
-#ifndef _WIN32	/* POSIX msync() requires ptr = start of OS page */
-			r2 = (ptr - env->me_map) & (env->me_os_psize - 1);
-			ptr -= r2;
-			meta_size += r2;
-#endif
-			if (MDB_MSYNC(ptr, meta_size, rc)) {
-				rc = ErrCode();
-				goto fail;
-			}
-		}
-		goto done;
-	}
+	mp = env->me_metas[meta->mm_txnid & 1];
 	metab.mm_txnid = mp->mm_txnid;
 	metab.mm_last_pg = mp->mm_last_pg;
 
-	meta.mm_mapsize = mapsize;
-	meta.mm_dbs[FREE_DBI] = txn->mt_dbs[FREE_DBI];
-	meta.mm_dbs[MAIN_DBI] = txn->mt_dbs[MAIN_DBI];
-	meta.mm_last_pg = txn->mt_next_pgno - 1;
-	meta.mm_txnid = txn->mt_txnid;
-
 	off = offsetof(MDB_meta, mm_mapsize);
-	ptr = (char *)&meta + off;
+	ptr = (char *)meta + off;
 	len = sizeof(MDB_meta) - off;
 	off += (char *)mp - env->me_map;
 
@@ -4203,6 +5096,7 @@ mdb_env_write_meta(MDB_txn *txn)
 	 */
 	mfd = (flags & (MDB_NOSYNC|MDB_NOMETASYNC)) ? env->me_fd : env->me_mfd;
 #ifdef _WIN32
+	(void) async;
 	{
 		memset(&ov, 0, sizeof(ov));
 		ov.Offset = off;
@@ -4210,6 +5104,13 @@ mdb_env_write_meta(MDB_txn *txn)
 			rc = -1;
 	}
 #else
+#ifdef MDB_USE_URING
+	if (env->me_uring && !async)
+		rc = mdb_uring_meta(env, flags, ptr, len, off);
+	else
+#else
+	(void) async;
+#endif
 retry_write:
 	rc = pwrite(mfd, ptr, len, off);
 #endif
@@ -4224,8 +5125,8 @@ retry_write:
 		 * Write some old data back, to prevent it from being used.
 		 * Use the non-SYNC fd; we know it will fail anyway.
 		 */
-		meta.mm_last_pg = metab.mm_last_pg;
-		meta.mm_txnid = metab.mm_txnid;
+		meta->mm_last_pg = metab.mm_last_pg;
+		meta->mm_txnid = metab.mm_txnid;
 #ifdef _WIN32
 		memset(&ov, 0, sizeof(ov));
 		ov.Offset = off;
@@ -4234,13 +5135,11 @@ retry_write:
 		r2 = pwrite(env->me_fd, ptr, len, off);
 		(void)r2;	/* Silence warnings. We don't care about pwrite's return value */
 #endif
-fail:
 		env->me_flags |= MDB_FATAL_ERROR;
 		return rc;
 	}
 	/* MIPS has cache coherency issues, this is a no-op everywhere else */
 	CACHEFLUSH(env->me_map + off, len, DCACHE);
-done:
 	/* Memory ordering issues are irrelevant; since the entire writer
 	 * is wrapped by wmutex, all of these changes will become visible
 	 * after the wmutex is unlocked. Since the DB is multi-version,
@@ -4248,52 +5147,370 @@ done:
 	 * how stale their view of these values is.
 	 */
 	if (env->me_txns)
-		env->me_txns->mti_txnid = txn->mt_txnid;
+		env->me_txns->mti_txnid = meta->mm_txnid;
 
 	return MDB_SUCCESS;
 }
 
-/** Check both meta pages to see which one is newer.
- * @param[in] env the environment handle
- * @return newest #MDB_meta.
+/** Fill in the meta page values of a transaction that's being committed.
+ * @param[in] txn the transaction
+ * @param[out] meta the values from #mm_mapsize on
  */
-static MDB_meta *
-mdb_env_pick_meta(const MDB_env *env)
+static void
+mdb_txn_meta(MDB_txn *txn, MDB_meta *meta)
 {
-	MDB_meta *const *metas = env->me_metas;
-	return metas[ metas[0]->mm_txnid < metas[1]->mm_txnid ];
+	MDB_env *env = txn->mt_env;
+	mdb_size_t mapsize;
+
+	mapsize = env->me_metas[(txn->mt_txnid & 1) ^ 1]->mm_mapsize;
+	/* Persist any increases of mapsize config */
+	if (mapsize < env->me_mapsize)
+		mapsize = env->me_mapsize;
+	meta->mm_mapsize = mapsize;
+	meta->mm_dbs[FREE_DBI] = txn->mt_dbs[FREE_DBI];
+	meta->mm_dbs[MAIN_DBI] = txn->mt_dbs[MAIN_DBI];
+	meta->mm_last_pg = txn->mt_next_pgno - 1;
+	meta->mm_txnid = txn->mt_txnid;
 }
 
-int ESECT
-mdb_env_create(MDB_env **env)
+/** Update the environment info to commit a transaction.
+ * @param[in] txn the transaction that's being committed
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_env_write_meta(MDB_txn *txn)
 {
-	MDB_env *e;
+	MDB_env *env;
+	MDB_meta	meta, *mp;
+	unsigned flags;
+	int rc, toggle;
+	char *ptr;
+#ifndef _WIN32
+	int r2;
+#endif
 
-	e = calloc(1, sizeof(MDB_env));
-	if (!e)
-		return ENOMEM;
+	toggle = txn->mt_txnid & 1;
+	DPRINTF(("writing meta page %d for root page %"Yu,
+		toggle, txn->mt_dbs[MAIN_DBI].md_root));
 
-	e->me_maxreaders = DEFAULT_READERS;
-	e->me_maxdbs = e->me_numdbs = CORE_DBS;
-	e->me_fd = INVALID_HANDLE_VALUE;
-	e->me_lfd = INVALID_HANDLE_VALUE;
-	e->me_mfd = INVALID_HANDLE_VALUE;
-#ifdef MDB_USE_POSIX_SEM
-	e->me_rmutex = SEM_FAILED;
-	e->me_wmutex = SEM_FAILED;
-#elif defined MDB_USE_SYSV_SEM
-	e->me_rmutex->semid = -1;
-	e->me_wmutex->semid = -1;
-#endif
-	e->me_pid = getpid();
-	GET_PAGESIZE(e->me_os_psize);
-	VGMEMP_CREATE(e,0,0);
-	*env = e;
-	return MDB_SUCCESS;
-}
+	env = txn->mt_env;
+	flags = txn->mt_flags | env->me_flags;
+	mdb_txn_meta(txn, &meta);
+	if (!(flags & MDB_WRITEMAP))
+		return mdb_env_write_meta0(env, &meta, flags, 0);
 
-#ifdef _WIN32
-/** @brief Map a result from an NTAPI call to WIN32. */
+	mp = env->me_metas[toggle];
+	mp->mm_mapsize = meta.mm_mapsize;
+	mp->mm_dbs[FREE_DBI] = meta.mm_dbs[FREE_DBI];
+	mp->mm_dbs[MAIN_DBI] = meta.mm_dbs[MAIN_DBI];
+	mp->mm_last_pg = meta.mm_last_pg;
+#if (__GNUC__ * 100 + __GNUC_MINOR__ >= 404) && /* TODO: portability */	\
+	!(defined(__i386__) || defined(__x86_64__))
+	/* LY: issue a memory barrier, if not x86. ITS#7969 */
+	__sync_synchronize();
+#endif
+	mp->mm_txnid = txn->mt_txnid;
+	if (!(flags & (MDB_NOMETASYNC|MDB_NOSYNC))) {
+		unsigned meta_size = env->me_psize;
+		rc = (env->me_flags & MDB_MAPASYNC) ? MS_ASYNC : MS_SYNC;
+		ptr = (char *)mp - PAGEHDRSZ;
+#ifndef _WIN32	/* POSIX msync() requires ptr = start of OS page */
+		r2 = (ptr - env->me_map) & (env->me_os_psize - 1);
+		ptr -= r2;
+		meta_size += r2;
+#endif
+		if (MDB_MSYNC(ptr, meta_size, rc)) {
+			rc = ErrCode();
+			env->me_flags |= MDB_FATAL_ERROR;
+			return rc;
+		}
+	}
+	if (env->me_txns)
+		env->me_txns->mti_txnid = txn->mt_txnid;
+
+	return MDB_SUCCESS;
+}
+
+#ifdef MDB_USE_ASYNC
+/** @defgroup async	Asynchronous commits
+ *	A commit queued by #mdb_txn_commit_async() has its pages written to
+ *	the OS but not synced, and its meta page not written. A background
+ *	thread of the env syncs the data, then writes the meta page, which
+ *	publishes the txn to readers. So a crash never finds a meta page
+ *	whose data is missing. Until then the next write txn of this
+ *	process starts from the queued meta page, and writers of other
+ *	processes wait (#mti_async_pid). At most one commit is queued: a
+ *	commit waits for the previous one before writing its meta page, so
+ *	pages freed by a queued txn are never reused before it is durable.
+ *	@{
+ */
+enum {
+	MDB_ASYNC_IDLE,		/**< no commit queued */
+	MDB_ASYNC_QUEUED,	/**< #ma_meta is waiting for its sync */
+	MDB_ASYNC_STOP		/**< the thread is to exit */
+};
+
+typedef struct MDB_async {
+	pthread_t		ma_thr;
+	pthread_mutex_t	ma_mutex;	/**< protects the fields below */
+	pthread_cond_t	ma_cond;	/**< signals each #ma_state change */
+	int				ma_state;
+	/** Error of a failed background commit. It also fails all later
+	 *	commits, since they built on it.
+	 */
+	int				ma_rc;
+	unsigned		ma_flags;	/**< txn and env flags of the commit */
+	MDB_meta		ma_meta;	/**< meta page values of the commit */
+	MDB_commit_func	*ma_func;
+	void			*ma_ctx;
+} MDB_async;
+
+/** The background thread: sync, write the meta page, call back. */
+static void *
+mdb_env_async_thr(void *arg)
+{
+	MDB_env *env = arg;
+	MDB_async *as = env->me_async;
+	MDB_meta meta;
+	MDB_commit_func *func;
+	void *ctx;
+	unsigned flags;
+	int rc;
+
+	pthread_mutex_lock(&as->ma_mutex);
+	for (;;) {
+		while (as->ma_state == MDB_ASYNC_IDLE)
+			pthread_cond_wait(&as->ma_cond, &as->ma_mutex);
+		if (as->ma_state == MDB_ASYNC_STOP)
+			break;
+		meta = as->ma_meta;
+		flags = as->ma_flags;
+		func = as->ma_func;
+		ctx = as->ma_ctx;
+		rc = as->ma_rc;
+		pthread_mutex_unlock(&as->ma_mutex);
+
+		if (!rc && !(rc = mdb_env_sync0(env, 0, 0)))
+			rc = mdb_env_write_meta0(env, &meta, flags, 1);
+		if (rc)
+			env->me_flags |= MDB_FATAL_ERROR;
+		/* Published, or never will be: let other writers go on */
+		if (env->me_txns && env->me_txns->mti_async_pid == env->me_pid)
+			env->me_txns->mti_async_pid = 0;
+
+		/* Before the next commit, and before waiters return */
+		func(ctx, meta.mm_txnid, rc);
+
+		pthread_mutex_lock(&as->ma_mutex);
+		if (rc)
+			as->ma_rc = rc;
+		as->ma_state = MDB_ASYNC_IDLE;
+		pthread_cond_broadcast(&as->ma_cond);
+	}
+	pthread_mutex_unlock(&as->ma_mutex);
+	return NULL;
+}
+
+/** Wait until no commit is queued.
+ * @param[in] env the environment handle
+ * @return 0, or the error of a failed background commit.
+ */
+static int
+mdb_env_async_wait(MDB_env *env)
+{
+	MDB_async *as = env->me_async;
+	int rc;
+
+	if (!as)
+		return MDB_SUCCESS;
+	pthread_mutex_lock(&as->ma_mutex);
+	while (as->ma_state == MDB_ASYNC_QUEUED)
+		pthread_cond_wait(&as->ma_cond, &as->ma_mutex);
+	rc = as->ma_rc;
+	pthread_mutex_unlock(&as->ma_mutex);
+	return rc;
+}
+
+/** Get the meta page values of the queued commit, if any.
+ * @param[in] env the environment handle
+ * @param[out] meta the values, when a commit is queued
+ * @return non-zero if a commit is queued.
+ */
+static int
+mdb_env_async_meta(MDB_env *env, MDB_meta *meta)
+{
+	MDB_async *as = env->me_async;
+	int queued;
+
+	if (!as)
+		return 0;
+	pthread_mutex_lock(&as->ma_mutex);
+	queued = as->ma_state == MDB_ASYNC_QUEUED;
+	if (queued)
+		*meta = as->ma_meta;
+	pthread_mutex_unlock(&as->ma_mutex);
+	return queued;
+}
+
+/** Wait for the queued commit of another process, if any.
+ *	The caller holds the writer lock, which that process released
+ *	before its meta page was written.
+ * @param[in] env the environment handle
+ */
+static void
+mdb_env_async_other(MDB_env *env)
+{
+	MDB_txninfo *ti = env->me_txns;
+	MDB_meta pending;
+	MDB_PID_T pid;
+	struct timespec ts;
+
+	while ((pid = ti->mti_async_pid) != 0) {
+		if (pid == env->me_pid) {
+			/* Ours is in me_async. Else a stale entry, from a dead
+			 * process whose pid was reused.
+			 */
+			if (!mdb_env_async_meta(env, &pending))
+				ti->mti_async_pid = 0;
+			return;
+		}
+		if (!mdb_reader_pid(env, Pidcheck, pid)) {
+			/* Died before writing its meta page. The data it wrote
+			 * went to pages that are free in the last meta page.
+			 * Its pid lock tells, even if the pid was reused.
+			 */
+			ti->mti_async_pid = 0;
+			return;
+		}
+		ts.tv_sec = 0;
+		ts.tv_nsec = 1000000;
+		nanosleep(&ts, NULL);
+	}
+}
+
+/** Queue the sync and meta page write of a transaction.
+ *	The caller waited for the previous queued commit.
+ * @param[in] txn the transaction that's being committed
+ * @param[in] func the callback for #mdb_txn_commit_async()
+ * @param[in] ctx its context
+ * @return 0 on success, non-zero if the thread could not be started.
+ */
+static int
+mdb_env_async_queue(MDB_txn *txn, MDB_commit_func *func, void *ctx)
+{
+	MDB_env *env = txn->mt_env;
+	MDB_async *as = env->me_async;
+	int rc;
+
+	/* Other writers wait while our pid lock shows we are alive */
+	if (env->me_txns && !env->me_live_reader) {
+		if ((rc = mdb_reader_pid(env, Pidset, env->me_pid)) != 0)
+			return rc;
+		env->me_live_reader = 1;
+	}
+	if (!as) {
+		if ((as = calloc(1, sizeof(MDB_async))) == NULL)
+			return ENOMEM;
+		if ((rc = pthread_mutex_init(&as->ma_mutex, NULL)) != 0) {
+			free(as);
+			return rc;
+		}
+		if ((rc = pthread_cond_init(&as->ma_cond, NULL)) != 0) {
+			pthread_mutex_destroy(&as->ma_mutex);
+			free(as);
+			return rc;
+		}
+		env->me_async = as;
+		if ((rc = pthread_create(&as->ma_thr, NULL, mdb_env_async_thr, env))) {
+			env->me_async = NULL;
+			pthread_cond_destroy(&as->ma_cond);
+			pthread_mutex_destroy(&as->ma_mutex);
+			free(as);
+			return rc;
+		}
+	}
+
+	pthread_mutex_lock(&as->ma_mutex);
+	mdb_txn_meta(txn, &as->ma_meta);
+	as->ma_flags = txn->mt_flags | env->me_flags;
+	as->ma_func = func;
+	as->ma_ctx = ctx;
+	as->ma_state = MDB_ASYNC_QUEUED;
+	if (env->me_txns)
+		env->me_txns->mti_async_pid = env->me_pid;
+	pthread_cond_broadcast(&as->ma_cond);
+	pthread_mutex_unlock(&as->ma_mutex);
+	return MDB_SUCCESS;
+}
+
+/** Finish the queued commit and stop the background thread.
+ * @param[in] env the environment handle
+ */
+static void
+mdb_env_async_stop(MDB_env *env)
+{
+	MDB_async *as = env->me_async;
+
+	if (!as)
+		return;
+	pthread_mutex_lock(&as->ma_mutex);
+	while (as->ma_state == MDB_ASYNC_QUEUED)
+		pthread_cond_wait(&as->ma_cond, &as->ma_mutex);
+	as->ma_state = MDB_ASYNC_STOP;
+	pthread_cond_broadcast(&as->ma_cond);
+	pthread_mutex_unlock(&as->ma_mutex);
+	pthread_join(as->ma_thr, NULL);
+	pthread_cond_destroy(&as->ma_cond);
+	pthread_mutex_destroy(&as->ma_mutex);
+	free(as);
+	env->me_async = NULL;
+}
+/** @} */
+#endif	/* MDB_USE_ASYNC */
+
+/** Check both meta pages to see which one is newer.
+ * @param[in] env the environment handle
+ * @return newest #MDB_meta.
+ */
+static MDB_meta *
+mdb_env_pick_meta(const MDB_env *env)
+{
+	MDB_meta *const *metas = env->me_metas;
+	return metas[ metas[0]->mm_txnid < metas[1]->mm_txnid ];
+}
+
+int ESECT
+mdb_env_create(MDB_env **env)
+{
+	MDB_env *e;
+
+	e = calloc(1, sizeof(MDB_env));
+	if (!e)
+		return ENOMEM;
+
+	e->me_maxreaders = DEFAULT_READERS;
+	e->me_maxdbs = e->me_numdbs = CORE_DBS;
+	e->me_dirty_max = MDB_IDL_UM_MAX;
+	e->me_births_max = MDB_BIRTHS_DEFAULT;
+	e->me_fd = INVALID_HANDLE_VALUE;
+	e->me_lfd = INVALID_HANDLE_VALUE;
+	e->me_mfd = INVALID_HANDLE_VALUE;
+#ifdef MDB_USE_POSIX_SEM
+	e->me_rmutex = SEM_FAILED;
+	e->me_wmutex = SEM_FAILED;
+#elif defined MDB_USE_SYSV_SEM
+	e->me_rmutex->semid = -1;
+	e->me_wmutex->semid = -1;
+#endif
+	e->me_pid = getpid();
+	GET_PAGESIZE(e->me_os_psize);
+	VGMEMP_CREATE(e,0,0);
+	*env = e;
+	return MDB_SUCCESS;
+}
+
+#ifdef _WIN32
+/** @brief Map a result from an NTAPI call to WIN32. */
 static DWORD
 mdb_nt2win32(NTSTATUS st)
 {
@@ -4396,7 +5613,8 @@ mdb_env_map(MDB_env *env, void *addr)
 	env->me_metas[0] = METADATA(p);
 	env->me_metas[1] = (MDB_meta *)((char *)env->me_metas[0] + env->me_psize);
 
-	return MDB_SUCCESS;
+	/* the new map has no hints yet */
+	return mdb_env_access_init(env);
 }
 
 int ESECT
@@ -4413,6 +5631,11 @@ mdb_env_set_mapsize(MDB_env *env, mdb_size_t size)
 #endif
 		if (env->me_txn)
 			return EINVAL;
+#ifndef MDB_VL32
+		/* The queued commit writes its meta page into the old map */
+		if ((rc = mdb_env_async_wait(env)))
+			return rc;
+#endif
 		meta = mdb_env_pick_meta(env);
 		if (!size)
 			size = meta->mm_mapsize;
@@ -4426,10 +5649,13 @@ mdb_env_set_mapsize(MDB_env *env, mdb_size_t size)
 		/* For MDB_VL32 this bit is a noop since we dynamically remap
 		 * chunks of the DB anyway.
 		 */
+		/* The reaper reads the freelist in a txn of its own */
+		mdb_env_reaper_hold(env);
 		munmap(env->me_map, env->me_mapsize);
 		env->me_mapsize = size;
 		old = (env->me_flags & MDB_FIXEDMAP) ? env->me_map : NULL;
 		rc = mdb_env_map(env, old);
+		mdb_env_reaper_release(env);
 		if (rc)
 			return rc;
 #endif /* !MDB_VL32 */
@@ -4449,6 +5675,64 @@ mdb_env_set_maxdbs(MDB_env *env, MDB_dbi dbs)
 	return MDB_SUCCESS;
 }
 
+int ESECT
+mdb_env_set_maxdirty(MDB_env *env, unsigned int pages)
+{
+	if (env->me_txn || pages < MDB_DIRTY_MIN || pages > MDB_DIRTY_MAX)
+		return EINVAL;
+	env->me_dirty_max = pages;
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_set_maxgap(MDB_env *env, unsigned int pages)
+{
+	uint32_t *births;
+
+	if (!env || env->me_txn)
+		return EINVAL;
+	env->me_births_max = pages;
+	if (env->me_births_len > pages) {
+		if (!pages) {
+			free(env->me_births);
+			env->me_births = NULL;
+		} else if ((births = realloc(env->me_births,
+			pages * sizeof(uint32_t))) != NULL) {
+			env->me_births = births;
+		}
+		env->me_births_len = pages;
+	}
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_get_maxdirty(MDB_env *env, unsigned int *pages)
+{
+	if (!env || !pages)
+		return EINVAL;
+	*pages = env->me_dirty_max;
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_set_uring(MDB_env *env, unsigned int depth)
+{
+#ifdef MDB_USE_URING
+	if (env->me_txn)
+		return EINVAL;
+	mdb_uring_close(env);
+	if (!depth)
+		return MDB_SUCCESS;
+	if (depth < 4)
+		depth = 4;	/* room for the meta page chain */
+	else if (depth > 4096)
+		depth = 4096;
+	return mdb_uring_open(env, depth);
+#else
+	return depth ? ENOSYS : MDB_SUCCESS;
+#endif
+}
+
 int ESECT
 mdb_env_set_maxreaders(MDB_env *env, unsigned int readers)
 {
@@ -5275,6 +6559,7 @@ mdb_env_setup_locks(MDB_env *env, MDB_name *fname, int mode, int *excl)
 		env->me_txns->mti_format = MDB_LOCK_FORMAT;
 		env->me_txns->mti_txnid = 0;
 		env->me_txns->mti_numreaders = 0;
+		env->me_txns->mti_async_pid = 0;
 
 	} else {
 #ifdef MDB_USE_SYSV_SEM
@@ -5392,7 +6677,9 @@ mdb_env_open(MDB_env *env, const char *path, unsigned int flags, mdb_mode_t mode
 		flags &= ~MDB_WRITEMAP;
 	} else {
 		if (!((env->me_free_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX)) &&
-			  (env->me_dirty_list = calloc(MDB_IDL_UM_SIZE, sizeof(MDB_ID2)))))
+			  (env->me_dirty_list = mdb_mid2l_alloc(
+				env->me_dirty_max < MDB_IDL_UM_MAX ?
+				env->me_dirty_max : MDB_IDL_UM_MAX))))
 			rc = ENOMEM;
 	}
 
@@ -5515,7 +6802,12 @@ mdb_env_close0(MDB_env *env, int excl)
 	free(env->me_dbiseqs);
 	free(env->me_dbflags);
 	free(env->me_path);
-	free(env->me_dirty_list);
+	mdb_mid2l_free(env->me_dirty_list);
+	mdb_midl_free(env->me_sync_pgs);
+	free(env->me_access_map);
+	mdb_midl_free(env->me_pggaps);
+	mdb_midl_free(env->me_pgsnaps);
+	free(env->me_births);
 #ifdef MDB_VL32
 	if (env->me_txn0 && env->me_txn0->mt_rpages)
 		free(env->me_txn0->mt_rpages);
@@ -5633,6 +6925,8 @@ mdb_env_close(MDB_env *env)
 	if (env == NULL)
 		return;
 
+	mdb_env_reaper_stop(env);
+	mdb_env_async_stop(env);
 	VGMEMP_DESTROY(env);
 	while ((dp = env->me_dpages) != NULL) {
 		VGMEMP_DEFINED(&dp->mp_next, sizeof(dp->mp_next));
@@ -5641,6 +6935,9 @@ mdb_env_close(MDB_env *env)
 	}
 
 	mdb_env_close0(env, 0);
+#ifdef MDB_USE_URING
+	mdb_uring_close(env);
+#endif
 	free(env);
 }
 
@@ -5739,6 +7036,212 @@ mdb_cmp_memnr(const MDB_val *a, const MDB_val *b)
 	return len_diff<0 ? -1 : len_diff;
 }
 
+/** Number of keys left to #mdb_count_lt32() and #mdb_count_lt64()
+ *	by the binary search in #mdb_node_isearch().
+ */
+#define MDB_SCAN_KEYS	16
+
+/** Count the n unsigned ints of unknown alignment at p that are < k. */
+static unsigned int
+mdb_count_lt32_c(const char *p, unsigned int n, unsigned int k)
+{
+	unsigned int i, c = 0, x;
+	for (i = 0; i < n; i++) {
+		memcpy(&x, p + (size_t)i * sizeof(x), sizeof(x));
+		c += x < k;
+	}
+	return c;
+}
+
+/** Count the n mdb_size_t's of unknown alignment at p that are < k. */
+static unsigned int
+mdb_count_lt64_c(const char *p, unsigned int n, mdb_size_t k)
+{
+	unsigned int i, c = 0;
+	mdb_size_t x;
+	for (i = 0; i < n; i++) {
+		memcpy(&x, p + (size_t)i * sizeof(x), sizeof(x));
+		c += x < k;
+	}
+	return c;
+}
+
+#ifdef MDB_SIMD_X86
+/* SSE/AVX2 only have signed compares: flip the sign bits first */
+__attribute__((target("avx2"))) static unsigned int
+mdb_count_lt32_avx2(const char *p, unsigned int n, unsigned int k)
+{
+	const __m256i sign = _mm256_set1_epi32((int)0x80000000U);
+	const __m256i kv = _mm256_xor_si256(_mm256_set1_epi32((int)k), sign);
+	__m256i v;
+	unsigned int i, c = 0;
+	for (i = 0; i + 8 <= n; i += 8) {
+		v = _mm256_loadu_si256((const __m256i *)(p + (size_t)i * 4));
+		v = _mm256_cmpgt_epi32(kv, _mm256_xor_si256(v, sign));
+		c += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(v)));
+	}
+	return c + mdb_count_lt32_c(p + (size_t)i * 4, n - i, k);
+}
+
+__attribute__((target("avx2"))) static unsigned int
+mdb_count_lt64_avx2(const char *p, unsigned int n, mdb_size_t k)
+{
+	const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+	const __m256i kv = _mm256_xor_si256(_mm256_set1_epi64x((long long)k), sign);
+	__m256i v;
+	unsigned int i, c = 0;
+	for (i = 0; i + 4 <= n; i += 4) {
+		v = _mm256_loadu_si256((const __m256i *)(p + (size_t)i * 8));
+		v = _mm256_cmpgt_epi64(kv, _mm256_xor_si256(v, sign));
+		c += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(v)));
+	}
+	return c + mdb_count_lt64_c(p + (size_t)i * 8, n - i, k);
+}
+
+__attribute__((target("sse4.2"))) static unsigned int
+mdb_count_lt32_sse4(const char *p, unsigned int n, unsigned int k)
+{
+	const __m128i sign = _mm_set1_epi32((int)0x80000000U);
+	const __m128i kv = _mm_xor_si128(_mm_set1_epi32((int)k), sign);
+	__m128i v;
+	unsigned int i, c = 0;
+	for (i = 0; i + 4 <= n; i += 4) {
+		v = _mm_loadu_si128((const __m128i *)(p + (size_t)i * 4));
+		v = _mm_cmpgt_epi32(kv, _mm_xor_si128(v, sign));
+		c += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(v)));
+	}
+	return c + mdb_count_lt32_c(p + (size_t)i * 4, n - i, k);
+}
+
+__attribute__((target("sse4.2"))) static unsigned int
+mdb_count_lt64_sse4(const char *p, unsigned int n, mdb_size_t k)
+{
+	const __m128i sign = _mm_set1_epi64x((long long)0x8000000000000000ULL);
+	const __m128i kv = _mm_xor_si128(_mm_set1_epi64x((long long)k), sign);
+	__m128i v;
+	unsigned int i, c = 0;
+	for (i = 0; i + 2 <= n; i += 2) {
+		v = _mm_loadu_si128((const __m128i *)(p + (size_t)i * 8));
+		v = _mm_cmpgt_epi64(kv, _mm_xor_si128(v, sign));
+		c += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(v)));
+	}
+	return c + mdb_count_lt64_c(p + (size_t)i * 8, n - i, k);
+}
+#endif
+
+static unsigned int
+mdb_count_lt32(const char *p, unsigned int n, unsigned int k)
+{
+#ifdef MDB_SIMD_X86
+	if (__builtin_cpu_supports("avx2"))
+		return mdb_count_lt32_avx2(p, n, k);
+	if (__builtin_cpu_supports("sse4.2"))
+		return mdb_count_lt32_sse4(p, n, k);
+#endif
+	return mdb_count_lt32_c(p, n, k);
+}
+
+static unsigned int
+mdb_count_lt64(const char *p, unsigned int n, mdb_size_t k)
+{
+#ifdef MDB_SIMD_X86
+	if (__builtin_cpu_supports("avx2"))
+		return mdb_count_lt64_avx2(p, n, k);
+	if (__builtin_cpu_supports("sse4.2"))
+		return mdb_count_lt64_sse4(p, n, k);
+#endif
+	return mdb_count_lt64_c(p, n, k);
+}
+
+/** Search for a native unsigned integer key within a page.
+ *	Handles #mdb_cmp_int, #mdb_cmp_long and #mdb_cmp_cint for keys of
+ *	sizeof(unsigned int) and sizeof(#mdb_size_t) without calling \b cmp:
+ *	#P_LEAF2 pages are a dense array, a branchless binary search narrows
+ *	it down to #MDB_SCAN_KEYS keys which are counted with SIMD. Other
+ *	pages get a branchless binary search over their nodes.
+ * @param[in] mc The cursor, searching in the page at mc_top.
+ * @param[in] cmp The compare function #mdb_node_search() would use.
+ * @param[in] key The key to search for.
+ * @param[in] low The first index to search, low < NUMKEYS.
+ * @param[out] exactp Whether the found key is equal to key.
+ * @return The index of the smallest key >= key (NUMKEYS if there is
+ *	none), or -1 if the page or compare function are not supported.
+ */
+static int
+mdb_node_isearch(MDB_cursor *mc, MDB_cmp_func *cmp, MDB_val *key,
+	unsigned int low, int *exactp)
+{
+	MDB_page *mp = mc->mc_pg[mc->mc_top];
+	unsigned int nkeys = NUMKEYS(mp), n = nkeys - low, half, lt, x, k;
+	size_t ksize = IS_LEAF2(mp) ? mc->mc_db->md_pad
+		: NODEKSZ(NODEPTR(mp, low));
+	mdb_size_t xl, kl;
+	char *base;
+
+	if (key->mv_size != ksize)
+		return -1;
+	if (ksize == sizeof(unsigned int)) {
+		if (cmp != mdb_cmp_int && cmp != mdb_cmp_cint)
+			return -1;
+		memcpy(&k, key->mv_data, sizeof(k));
+		if (IS_LEAF2(mp)) {
+			base = LEAF2KEY(mp, 0, ksize);
+			while (n > MDB_SCAN_KEYS) {
+				half = n >> 1;
+				memcpy(&x, base + (size_t)(low + half) * ksize, ksize);
+				lt = x < k;
+				low = lt ? low + half + 1 : low;
+				n = lt ? n - half - 1 : half;
+			}
+			low += mdb_count_lt32(base + (size_t)low * ksize, n, k);
+			if (low < nkeys)
+				memcpy(&x, base + (size_t)low * ksize, ksize);
+		} else {
+			while (n > 0) {
+				half = n >> 1;
+				memcpy(&x, NODEKEY(NODEPTR(mp, low + half)), ksize);
+				lt = x < k;
+				low = lt ? low + half + 1 : low;
+				n = lt ? n - half - 1 : half;
+			}
+			if (low < nkeys)
+				memcpy(&x, NODEKEY(NODEPTR(mp, low)), ksize);
+		}
+		*exactp = low < nkeys && x == k;
+	} else if (ksize == sizeof(mdb_size_t)) {
+		if (cmp != mdb_cmp_long && cmp != mdb_cmp_cint)
+			return -1;
+		memcpy(&kl, key->mv_data, sizeof(kl));
+		if (IS_LEAF2(mp)) {
+			base = LEAF2KEY(mp, 0, ksize);
+			while (n > MDB_SCAN_KEYS) {
+				half = n >> 1;
+				memcpy(&xl, base + (size_t)(low + half) * ksize, ksize);
+				lt = xl < kl;
+				low = lt ? low + half + 1 : low;
+				n = lt ? n - half - 1 : half;
+			}
+			low += mdb_count_lt64(base + (size_t)low * ksize, n, kl);
+			if (low < nkeys)
+				memcpy(&xl, base + (size_t)low * ksize, ksize);
+		} else {
+			while (n > 0) {
+				half = n >> 1;
+				memcpy(&xl, NODEKEY(NODEPTR(mp, low + half)), ksize);
+				lt = xl < kl;
+				low = lt ? low + half + 1 : low;
+				n = lt ? n - half - 1 : half;
+			}
+			if (low < nkeys)
+				memcpy(&xl, NODEKEY(NODEPTR(mp, low)), ksize);
+		}
+		*exactp = low < nkeys && xl == kl;
+	} else {
+		return -1;
+	}
+	return (int)low;
+}
+
 /** Search for key within a page, using binary search.
  * Returns the smallest entry larger or equal to the key.
  * If exactp is non-null, stores whether the found entry was an exact match
@@ -5750,7 +7253,7 @@ static MDB_node *
 mdb_node_search(MDB_cursor *mc, MDB_val *key, int *exactp)
 {
 	unsigned int	 i = 0, nkeys;
-	int		 low, high;
+	int		 low, high, j, exact;
 	int		 rc = 0;
 	MDB_page *mp = mc->mc_pg[mc->mc_top];
 	MDB_node	*node = NULL;
@@ -5778,7 +7281,13 @@ mdb_node_search(MDB_cursor *mc, MDB_val *key, int *exactp)
 			cmp = mdb_cmp_int;
 	}
 
-	if (IS_LEAF2(mp)) {
+	if (low <= high && (j = mdb_node_isearch(mc, cmp, key, low, &exact)) >= 0) {
+		i = j;
+		rc = exact ? 0 : -1;
+		node = NODEPTR(mp, IS_LEAF2(mp) || i >= nkeys ? 0 : i);
+		DPRINTF(("found %s index %u, exact = %i",
+		    IS_LEAF(mp) ? "leaf" : "branch", i, exact));
+	} else if (IS_LEAF2(mp)) {
 		nodekey.mv_size = mc->mc_db->md_pad;
 		node = NODEPTR(mp, 0);	/* fake */
 		while (low <= high) {
@@ -6177,31 +7686,128 @@ ok:
 }
 #endif
 
-/** Find the address of the page corresponding to a given page number.
- * Set #MDB_TXN_ERROR on failure.
- * @param[in] mc the cursor accessing the page.
- * @param[in] pgno the page number for the page to retrieve.
- * @param[out] ret address of a pointer where the page's address will be stored.
- * @param[out] lvl dirty_list inheritance level of found page. 1=current txn, 0=mapped page.
- * @return 0 on success, non-zero on failure.
+#if !defined(MDB_VL32) && !defined(_WIN32) && \
+	(defined(MADV_RANDOM) || defined(POSIX_MADV_RANDOM))
+#define MDB_ACCESS_HINTS	1
+#endif
+
+	/** Size of the map chunks that get an @ref mdb_access hint, as a
+	 *	power of two. Hints change the VM flags of a range, so the kernel
+	 *	splits the mapping at their edges; large chunks keep the number
+	 *	of mappings low. Adjacent chunks with the same hint are merged.
+	 */
+#define MDB_ACCESS_SHIFT	20
+
+/** Allocate the per-chunk state for @ref mdb_access hints, one byte
+ *	per chunk of the map. Called when the map is created or resized,
+ *	when no transaction of this process reads it, so readers see the
+ *	table without further synchronization.
+ * @param[in] env An environment with an open map.
+ * @return 0 on success, ENOMEM on failure.
  */
-static int
-mdb_page_get(MDB_cursor *mc, pgno_t pgno, MDB_page **ret, int *lvl)
+static int ESECT
+mdb_env_access_init(MDB_env *env)
 {
-	MDB_txn *txn = mc->mc_txn;
-	MDB_page *p = NULL;
-	int level;
+#ifdef MDB_ACCESS_HINTS
+	size_t chunks = (env->me_mapsize >> MDB_ACCESS_SHIFT) + 1;
+	unsigned char *map;
 
-	if (! (mc->mc_flags & (C_ORIG_RDONLY|C_WRITEMAP))) {
-		MDB_txn *tx2 = txn;
-		level = 1;
-		do {
-			MDB_ID2L dl = tx2->mt_u.dirty_list;
-			unsigned x;
-			/* Spilled pages were dirtied in this txn and flushed
-			 * because the dirty list got full. Bring this page
-			 * back in from the map (but don't unspill it here,
-			 * leave that unless page_touch happens again).
+	if ((map = calloc(chunks, 1)) == NULL)
+		return ENOMEM;
+	free(env->me_access_map);
+	env->me_access_map = map;
+	env->me_access_chunks = chunks;
+#else
+	(void) env;
+#endif
+	return MDB_SUCCESS;
+}
+
+	/** #me_access_map value of a chunk that got different hints */
+#define MDB_ACCESS_MIXED	0xff
+
+/** Apply a cursor's @ref mdb_access hint to the map chunk of a page.
+ *	Only calls into the kernel for the first hint of a chunk. A chunk
+ *	shared by databases with different hints is set back to
+ *	#MDB_ACCESS_NORMAL once and keeps it, so readers of both do not
+ *	advise it over and over. Reader threads race on the chunk state,
+ *	so it changes by compare-and-swap and only the thread that changed
+ *	it advises the chunk.
+ * @param[in] env The environment.
+ * @param[in] pgno The mapped page to be accessed.
+ * @param[in] access The cursor's @ref mdb_access hint.
+ */
+static void
+mdb_page_access(MDB_env *env, pgno_t pgno, unsigned int access)
+{
+#ifdef MDB_ACCESS_HINTS
+	size_t chunk = ((size_t)pgno * env->me_psize) >> MDB_ACCESS_SHIFT;
+	unsigned char *state;
+	unsigned char last, next;
+	size_t off, len;
+	int advice;
+
+	if (chunk >= env->me_access_chunks)
+		return;
+	state = &env->me_access_map[chunk];
+	last = __atomic_load_n(state, __ATOMIC_RELAXED);
+	do {
+		if (last == access || last == MDB_ACCESS_MIXED)
+			return;
+		next = last ? MDB_ACCESS_MIXED : access;
+	} while (!__atomic_compare_exchange_n(state, &last, next, 1,
+		__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	if (last) {
+		if (last == MDB_ACCESS_NORMAL)
+			return;
+		access = MDB_ACCESS_NORMAL;
+	}
+	off = chunk << MDB_ACCESS_SHIFT;
+	len = (size_t)1 << MDB_ACCESS_SHIFT;
+	if (len > env->me_mapsize - off)
+		len = env->me_mapsize - off;
+#ifdef MADV_RANDOM
+	advice = access == MDB_ACCESS_RANDOM ? MADV_RANDOM :
+		access == MDB_ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_NORMAL;
+	madvise(env->me_map + off, len, advice);
+#else
+	advice = access == MDB_ACCESS_RANDOM ? POSIX_MADV_RANDOM :
+		access == MDB_ACCESS_SEQUENTIAL ? POSIX_MADV_SEQUENTIAL :
+		POSIX_MADV_NORMAL;
+	posix_madvise(env->me_map + off, len, advice);
+#endif
+#else
+	(void) env;
+	(void) pgno;
+	(void) access;
+#endif
+}
+
+/** Find the address of the page corresponding to a given page number.
+ * Set #MDB_TXN_ERROR on failure.
+ * @param[in] mc the cursor accessing the page.
+ * @param[in] pgno the page number for the page to retrieve.
+ * @param[out] ret address of a pointer where the page's address will be stored.
+ * @param[out] lvl dirty_list inheritance level of found page. 1=current txn, 0=mapped page.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_page_get(MDB_cursor *mc, pgno_t pgno, MDB_page **ret, int *lvl)
+{
+	MDB_txn *txn = mc->mc_txn;
+	MDB_page *p = NULL;
+	int level;
+
+	if (! (mc->mc_flags & (C_ORIG_RDONLY|C_WRITEMAP))) {
+		MDB_txn *tx2 = txn;
+		level = 1;
+		do {
+			MDB_ID2L dl = tx2->mt_u.dirty_list;
+			unsigned x;
+			/* Spilled pages were dirtied in this txn and flushed
+			 * because the dirty list got full. Bring this page
+			 * back in from the map (but don't unspill it here,
+			 * leave that unless page_touch happens again).
 			 */
 			if (tx2->mt_spill_pgs) {
 				MDB_ID pn = pgno << 1;
@@ -6210,12 +7816,9 @@ mdb_page_get(MDB_cursor *mc, pgno_t pgno, MDB_page **ret, int *lvl)
 					goto mapped;
 				}
 			}
-			if (dl[0].mid) {
-				unsigned x = mdb_mid2l_search(dl, pgno);
-				if (x <= dl[0].mid && dl[x].mid == pgno) {
-					p = dl[x].mptr;
-					goto done;
-				}
+			if (dl[0].mid && (x = mdb_mid2l_find(dl, pgno))) {
+				p = dl[x].mptr;
+				goto done;
 			}
 			level++;
 		} while ((tx2 = tx2->mt_parent) != NULL);
@@ -6240,6 +7843,8 @@ mapped:
 #else
 		MDB_env *env = txn->mt_env;
 		p = (MDB_page *)(env->me_map + env->me_psize * pgno);
+		if (mc->mc_access)
+			mdb_page_access(env, pgno, mc->mc_access);
 #endif
 	}
 
@@ -6479,10 +8084,8 @@ mdb_ovpage_free(MDB_cursor *mc, MDB_page *mp)
 		((mp->mp_flags & P_DIRTY) ||
 		 (sl && (x = mdb_midl_search(sl, pn)) <= sl[0] && sl[x] == pn)))
 	{
-		unsigned i, j;
-		pgno_t *mop;
-		MDB_ID2 *dl, ix, iy;
-		rc = mdb_midl_need(&env->me_pghead, ovpages);
+		MDB_ID2 *dl;
+		rc = mdb_mext_need(&env->me_pghead, 1);
 		if (rc)
 			return rc;
 		if (!(mp->mp_flags & P_DIRTY)) {
@@ -6495,32 +8098,19 @@ mdb_ovpage_free(MDB_cursor *mc, MDB_page *mp)
 		}
 		/* Remove from dirty list */
 		dl = txn->mt_u.dirty_list;
-		x = dl[0].mid--;
-		for (ix = dl[x]; ix.mptr != mp; ix = iy) {
-			if (x > 1) {
-				x--;
-				iy = dl[x];
-				dl[x] = ix;
-			} else {
-				mdb_cassert(mc, x > 1);
-				j = ++(dl[0].mid);
-				dl[j] = ix;		/* Unsorted. OK when MDB_TXN_ERROR. */
-				txn->mt_flags |= MDB_TXN_ERROR;
-				return MDB_PROBLEM;
-			}
+		x = mdb_mid2l_find(dl, pg);
+		if (!x || dl[x].mptr != mp) {
+			mdb_cassert(mc, x && dl[x].mptr == mp);
+			txn->mt_flags |= MDB_TXN_ERROR;
+			return MDB_PROBLEM;
 		}
+		mdb_mid2l_delete(dl, x);
 		txn->mt_dirty_room++;
 		if (!(env->me_flags & MDB_WRITEMAP))
 			mdb_dpage_free(env, mp);
 release:
 		/* Insert in me_pghead */
-		mop = env->me_pghead;
-		j = mop[0] + ovpages;
-		for (i = mop[0]; i && mop[i] < pg; i--)
-			mop[j--] = mop[i];
-		while (j>i)
-			mop[j--] = pg++;
-		mop[0] += ovpages;
+		mdb_mext_xinsert(env->me_pghead, pg, ovpages);
 	} else {
 		rc = mdb_midl_append_range(&txn->mt_free_pgs, pg, ovpages);
 		if (rc)
@@ -6581,7 +8171,7 @@ mdb_get(MDB_txn *txn, MDB_dbi dbi,
 	if (!key || !data || !TXN_DBI_EXIST(txn, dbi, DB_USRVALID))
 		return EINVAL;
 
-	if (txn->mt_flags & MDB_TXN_BLOCKED)
+	if ((txn->mt_flags & MDB_TXN_BLOCKED) || TXN_EVICTED(txn))
 		return MDB_BAD_TXN;
 
 	mdb_cursor_init(&mc, txn, dbi, &mx);
@@ -6593,6 +8183,126 @@ mdb_get(MDB_txn *txn, MDB_dbi dbi,
 	return rc;
 }
 
+#if !defined(MDB_VL32) && !defined(_WIN32) && \
+	(defined(MADV_WILLNEED) || defined(POSIX_MADV_WILLNEED))
+#define MDB_READAHEAD	1
+#endif
+
+/** Max read-ahead depth of a cursor, see #mdb_cursor_prefetch() */
+#define MDB_PREFETCH_MAX	256U
+
+#ifdef MDB_READAHEAD
+/** Ask the OS to read in a run of pages of the map.
+ * @param[in] txn the transaction the pages are used by.
+ * @param[in] pgno the first page of the run.
+ * @param[in] cnt the number of pages in the run.
+ */
+static void
+mdb_page_readahead(MDB_txn *txn, pgno_t pgno, pgno_t cnt)
+{
+	MDB_env *env = txn->mt_env;
+	size_t off, len;
+
+	if (pgno >= txn->mt_next_pgno)
+		return;
+	if (cnt > txn->mt_next_pgno - pgno)
+		cnt = txn->mt_next_pgno - pgno;
+	off = (size_t)pgno * env->me_psize;
+	len = (size_t)cnt * env->me_psize;
+	/* the map is OS page aligned, but me_psize may be smaller */
+	len += off & (env->me_os_psize - 1);
+	off &= ~(size_t)(env->me_os_psize - 1);
+#ifdef MADV_WILLNEED
+	madvise(env->me_map + off, len, MADV_WILLNEED);
+#else
+	posix_madvise(env->me_map + off, len, POSIX_MADV_WILLNEED);
+#endif
+}
+#endif
+
+/** Read ahead the pages a scan reaches next.
+ *	Requests up to mc_prefetch siblings of the leaf at the top of the
+ *	cursor, taken from the parent branch page in scan direction, and
+ *	the overflow pages of that leaf. Each sibling is requested once
+ *	while the scan stays below the same parent.
+ * @param[in] mc A cursor whose top page is a leaf it just moved to.
+ * @param[in] move_right Non-zero if the scan moves right.
+ */
+static void
+mdb_cursor_readahead(MDB_cursor *mc, int move_right)
+{
+#ifdef MDB_READAHEAD
+	MDB_txn *txn = mc->mc_txn;
+	MDB_page *mp = mc->mc_pg[mc->mc_top], *parent;
+	MDB_node *node;
+	pgno_t pgno, run = 0, cnt = 0;
+	int ki, i, end, step;
+	unsigned int n;
+
+	if (mc->mc_snum > 1) {
+		parent = mc->mc_pg[mc->mc_top-1];
+		ki = mc->mc_ki[mc->mc_top-1];
+		if (mc->mc_pf_pgno != parent->mp_pgno ||
+			ki + 1 < mc->mc_pf_lo || ki > mc->mc_pf_hi + 1) {
+			mc->mc_pf_pgno = parent->mp_pgno;
+			mc->mc_pf_lo = mc->mc_pf_hi = ki;
+		}
+		if (ki < mc->mc_pf_lo)
+			mc->mc_pf_lo = ki;
+		if (ki > mc->mc_pf_hi)
+			mc->mc_pf_hi = ki;
+		if (move_right) {
+			i = mc->mc_pf_hi + 1;
+			end = ki + mc->mc_prefetch;
+			if (end > (int)NUMKEYS(parent) - 1)
+				end = NUMKEYS(parent) - 1;
+			step = 1;
+			if (end > mc->mc_pf_hi)
+				mc->mc_pf_hi = end;
+		} else {
+			i = mc->mc_pf_lo - 1;
+			end = ki - mc->mc_prefetch;
+			if (end < 0)
+				end = 0;
+			step = -1;
+			if (end < mc->mc_pf_lo)
+				mc->mc_pf_lo = end;
+		}
+		/* Siblings often sit in consecutive pages, request runs */
+		for (; step > 0 ? i <= end : i >= end; i += step) {
+			pgno = NODEPGNO(NODEPTR(parent, i));
+			if (cnt && pgno == run + cnt) {
+				cnt++;
+			} else if (cnt && pgno + 1 == run) {
+				run = pgno;
+				cnt++;
+			} else {
+				if (cnt)
+					mdb_page_readahead(txn, run, cnt);
+				run = pgno;
+				cnt = 1;
+			}
+		}
+		if (cnt)
+			mdb_page_readahead(txn, run, cnt);
+	}
+
+	if (IS_LEAF2(mp))
+		return;
+	for (n = 0; n < NUMKEYS(mp); n++) {
+		node = NODEPTR(mp, n);
+		if (F_ISSET(node->mn_flags, F_BIGDATA)) {
+			memcpy(&pgno, NODEDATA(node), sizeof(pgno));
+			mdb_page_readahead(txn, pgno,
+				OVPAGES(NODEDSZ(node), txn->mt_env->me_psize));
+		}
+	}
+#else
+	(void) mc;
+	(void) move_right;
+#endif
+}
+
 /** Find a sibling for a page.
  * Replaces the page at the top of the cursor's stack with the
  * specified sibling, if one exists.
@@ -6654,6 +8364,8 @@ mdb_cursor_sibling(MDB_cursor *mc, int move_right)
 	mdb_cursor_push(mc, mp);
 	if (!move_right)
 		mc->mc_ki[mc->mc_top] = NUMKEYS(mp)-1;
+	if (mc->mc_prefetch && IS_LEAF(mp))
+		mdb_cursor_readahead(mc, move_right);
 
 	return MDB_SUCCESS;
 }
@@ -6934,6 +8646,39 @@ mdb_cursor_set(MDB_cursor *mc, MDB_val *key, MDB_val *data,
 				mc->mc_ki[mc->mc_top] = nkeys;
 				return MDB_NOTFOUND;
 			}
+			/* The key is past this leaf, so it is above the lower
+			 * bound of every page on the stack. Climb to the lowest
+			 * parent whose next separator is above the key and search
+			 * down from there instead of from the root. Lookups in
+			 * ascending key order mostly stay below the lowest branch.
+			 */
+			{
+				int j;
+				for (j = mc->mc_top - 1; j >= 0; j--) {
+					MDB_page *bp = mc->mc_pg[j];
+					if (mc->mc_ki[j] + 1u < NUMKEYS(bp)) {
+						leaf = NODEPTR(bp, mc->mc_ki[j] + 1);
+						nodekey.mv_size = NODEKSZ(leaf);
+						nodekey.mv_data = NODEKEY(leaf);
+						if (mc->mc_dbx->md_cmp(key, &nodekey) < 0)
+							break;
+					}
+				}
+				if (j > 0) {
+#ifdef MDB_VL32
+					for (i = j+1; i < mc->mc_snum; i++)
+						MDB_PAGE_UNREF(mc->mc_txn, mc->mc_pg[i]);
+#endif
+					mc->mc_top = j;
+					mc->mc_snum = j + 1;
+					if ((rc = mdb_page_search_root(mc, key, 0)) != MDB_SUCCESS)
+						return rc;
+					mp = mc->mc_pg[mc->mc_top];
+					if (op == MDB_SET_RANGE && mc->mc_prefetch)
+						mdb_cursor_readahead(mc, 1);
+					goto set2;
+				}
+			}
 		}
 		if (!mc->mc_top) {
 			/* There are no other pages */
@@ -6954,6 +8699,8 @@ mdb_cursor_set(MDB_cursor *mc, MDB_val *key, MDB_val *data,
 
 	mp = mc->mc_pg[mc->mc_top];
 	mdb_cassert(mc, IS_LEAF(mp));
+	if (op == MDB_SET_RANGE && mc->mc_prefetch)
+		mdb_cursor_readahead(mc, 1);
 
 set2:
 	leaf = mdb_node_search(mc, key, exactp);
@@ -7052,6 +8799,8 @@ mdb_cursor_first(MDB_cursor *mc, MDB_val *key, MDB_val *data)
 		rc = mdb_page_search(mc, NULL, MDB_PS_FIRST);
 		if (rc != MDB_SUCCESS)
 			return rc;
+		if (mc->mc_prefetch)
+			mdb_cursor_readahead(mc, 1);
 	}
 	mdb_cassert(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
 
@@ -7098,6 +8847,8 @@ mdb_cursor_last(MDB_cursor *mc, MDB_val *key, MDB_val *data)
 		rc = mdb_page_search(mc, NULL, MDB_PS_LAST);
 		if (rc != MDB_SUCCESS)
 			return rc;
+		if (mc->mc_prefetch)
+			mdb_cursor_readahead(mc, 0);
 	}
 	mdb_cassert(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
 
@@ -7138,7 +8889,7 @@ mdb_cursor_get(MDB_cursor *mc, MDB_val *key, MDB_val *data,
 	if (mc == NULL)
 		return EINVAL;
 
-	if (mc->mc_txn->mt_flags & MDB_TXN_BLOCKED)
+	if ((mc->mc_txn->mt_flags & MDB_TXN_BLOCKED) || TXN_EVICTED(mc->mc_txn))
 		return MDB_BAD_TXN;
 
 	switch (op) {
@@ -7687,14 +9438,17 @@ current:
 				if (level > 1) {
 					/* It is writable only in a parent txn */
 					size_t sz = (size_t) env->me_psize * ovpages, off;
-					MDB_page *np = mdb_page_malloc(mc->mc_txn, ovpages);
+					MDB_page *np;
 					MDB_ID2 id2;
+					if ((rc2 = mdb_dirty_need(mc->mc_txn, 1)))
+						return rc2;
+					np = mdb_page_malloc(mc->mc_txn, ovpages);
 					if (!np)
 						return ENOMEM;
 					id2.mid = pg;
 					id2.mptr = np;
 					/* Note - this page is already counted in parent's dirty_room */
-					rc2 = mdb_mid2l_insert(mc->mc_txn->mt_u.dirty_list, &id2);
+					rc2 = mdb_mid2l_add(mc->mc_txn->mt_u.dirty_list, &id2);
 					mdb_cassert(mc, rc2 == 0);
 					/* Currently we make the page look as with put() in the
 					 * parent txn, in case the user peeks at MDB_RESERVEd
@@ -8325,6 +10079,8 @@ mdb_xcursor_init0(MDB_cursor *mc)
 	mx->mx_cursor.mc_dbflag = &mx->mx_dbflag;
 	mx->mx_cursor.mc_snum = 0;
 	mx->mx_cursor.mc_top = 0;
+	mx->mx_cursor.mc_prefetch = 0;
+	mx->mx_cursor.mc_access = mc->mc_access;
 	MC_SET_OVPG(&mx->mx_cursor, NULL);
 	mx->mx_cursor.mc_flags = C_SUB | (mc->mc_flags & (C_ORIG_RDONLY|C_WRITEMAP));
 	mx->mx_dbx.md_name.mv_size = 0;
@@ -8427,6 +10183,9 @@ mdb_cursor_init(MDB_cursor *mc, MDB_txn *txn, MDB_dbi dbi, MDB_xcursor *mx)
 	mc->mc_top = 0;
 	mc->mc_pg[0] = 0;
 	mc->mc_ki[0] = 0;
+	mc->mc_prefetch = 0;
+	mc->mc_access = txn->mt_dbxs[dbi].md_access;
+	mc->mc_pf_pgno = P_INVALID;
 	MC_SET_OVPG(mc, NULL);
 	mc->mc_flags = txn->mt_flags & (C_ORIG_RDONLY|C_WRITEMAP);
 	if (txn->mt_dbs[dbi].md_flags & MDB_DUPSORT) {
@@ -8478,6 +10237,8 @@ mdb_cursor_open(MDB_txn *txn, MDB_dbi dbi, MDB_cursor **ret)
 int
 mdb_cursor_renew(MDB_txn *txn, MDB_cursor *mc)
 {
+	unsigned short prefetch, access;
+
 	if (!mc || !TXN_DBI_EXIST(txn, mc->mc_dbi, DB_VALID))
 		return EINVAL;
 
@@ -8487,7 +10248,38 @@ mdb_cursor_renew(MDB_txn *txn, MDB_cursor *mc)
 	if (txn->mt_flags & MDB_TXN_BLOCKED)
 		return MDB_BAD_TXN;
 
+	prefetch = mc->mc_prefetch;
+	access = mc->mc_access;
 	mdb_cursor_init(mc, txn, mc->mc_dbi, mc->mc_xcursor);
+	mc->mc_prefetch = prefetch;
+	mc->mc_access = access;
+	if (mc->mc_xcursor)
+		mc->mc_xcursor->mx_cursor.mc_access = access;
+	return MDB_SUCCESS;
+}
+
+int
+mdb_cursor_prefetch(MDB_cursor *mc, unsigned int depth)
+{
+	if (!mc || (mc->mc_flags & C_SUB))
+		return EINVAL;
+
+	if (depth > MDB_PREFETCH_MAX)
+		depth = MDB_PREFETCH_MAX;
+	mc->mc_prefetch = depth;
+	mc->mc_pf_pgno = P_INVALID;
+	return MDB_SUCCESS;
+}
+
+int
+mdb_cursor_access(MDB_cursor *mc, unsigned int access)
+{
+	if (!mc || (mc->mc_flags & C_SUB) || access > MDB_ACCESS_SEQUENTIAL)
+		return EINVAL;
+
+	mc->mc_access = access;
+	if (mc->mc_xcursor)
+		mc->mc_xcursor->mx_cursor.mc_access = access;
 	return MDB_SUCCESS;
 }
 
@@ -8530,6 +10322,33 @@ mdb_cursor_count(MDB_cursor *mc, mdb_size_t *countp)
 	return MDB_SUCCESS;
 }
 
+int
+mdb_cursor_dbstat(MDB_cursor *mc, MDB_stat *arg)
+{
+	MDB_node	*leaf;
+	MDB_db		db;
+
+	if (mc == NULL || arg == NULL || mc->mc_dbi != MAIN_DBI)
+		return EINVAL;
+
+	if (mc->mc_txn->mt_flags & MDB_TXN_BLOCKED)
+		return MDB_BAD_TXN;
+
+	if (!(mc->mc_flags & C_INITIALIZED))
+		return EINVAL;
+
+	if (!mc->mc_snum ||
+		mc->mc_ki[mc->mc_top] >= NUMKEYS(mc->mc_pg[mc->mc_top]))
+		return MDB_NOTFOUND;
+
+	/* A named DB, not the duplicates of a key */
+	leaf = NODEPTR(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+	if ((leaf->mn_flags & (F_SUBDATA|F_DUPDATA)) != F_SUBDATA)
+		return MDB_INCOMPATIBLE;
+	memcpy(&db, NODEDATA(leaf), sizeof(db));
+	return mdb_stat0(mc->mc_txn->mt_env, &db, arg);
+}
+
 void
 mdb_cursor_close(MDB_cursor *mc)
 {
@@ -9043,6 +10862,8 @@ mdb_cursor_copy(const MDB_cursor *csrc, MDB_cursor *cdst)
 	cdst->mc_snum = csrc->mc_snum;
 	cdst->mc_top = csrc->mc_top;
 	cdst->mc_flags = csrc->mc_flags;
+	cdst->mc_prefetch = 0;
+	cdst->mc_access = csrc->mc_access;
 	MC_SET_OVPG(cdst, MC_OVPG(csrc));
 
 	for (i=0; i<csrc->mc_snum; i++) {
@@ -9850,6 +11671,45 @@ mdb_put(MDB_txn *txn, MDB_dbi dbi,
 	return rc;
 }
 
+	/** Write size bytes to fd at file offset pos. */
+static int
+mdb_fd_pwrite(HANDLE fd, const char *ptr, size_t size, lmdb_off_t pos)
+{
+	size_t chunk;
+#ifdef _WIN32
+	DWORD len;
+	OVERLAPPED ov;
+#else
+	ssize_t len;
+	int rc;
+#endif
+
+	while (size) {
+		chunk = size > MAX_WRITE ? MAX_WRITE : size;
+#ifdef _WIN32
+		memset(&ov, 0, sizeof(ov));
+		ov.Offset = pos & 0xffffffff;
+		ov.OffsetHigh = pos >> 16 >> 16;
+		if (!WriteFile(fd, ptr, chunk, &len, &ov))
+			return ErrCode();
+#else
+		len = pwrite(fd, ptr, chunk, pos);
+		if (len < 0) {
+			rc = ErrCode();
+			if (rc == EINTR)
+				continue;
+			return rc;
+		}
+#endif
+		if (len == 0)
+			return EIO;	/* like mdb_page_flush: filesystem full? */
+		ptr += len;
+		pos += len;
+		size -= len;
+	}
+	return MDB_SUCCESS;
+}
+
 #ifndef MDB_WBUF
 #define MDB_WBUF	(1024*1024)
 #endif
@@ -10134,6 +11994,26 @@ done:
 	return rc;
 }
 
+	/** Count free pages + freeDB pages: the pages a compacting copy omits. */
+static int ESECT
+mdb_env_freecount(MDB_txn *txn, MDB_ID *count)
+{
+	MDB_cursor mc;
+	MDB_val key, data;
+	int rc;
+
+	*count = 0;
+	mdb_cursor_init(&mc, txn, FREE_DBI, NULL);
+	while ((rc = mdb_cursor_get(&mc, &key, &data, MDB_NEXT)) == 0)
+		*count += *(MDB_ID *)data.mv_data;
+	if (rc != MDB_NOTFOUND)
+		return rc;
+	*count += txn->mt_dbs[FREE_DBI].md_branch_pages +
+		txn->mt_dbs[FREE_DBI].md_leaf_pages +
+		txn->mt_dbs[FREE_DBI].md_overflow_pages;
+	return MDB_SUCCESS;
+}
+
 	/** Copy environment with compaction. */
 static int ESECT
 mdb_env_copyfd1(MDB_env *env, HANDLE fd)
@@ -10208,20 +12088,13 @@ mdb_env_copyfd1(MDB_env *env, HANDLE fd)
 	/* Set metapage 1 with current main DB */
 	root = new_root = txn->mt_dbs[MAIN_DBI].md_root;
 	if (root != P_INVALID) {
-		/* Count free pages + freeDB pages.  Subtract from last_pg
-		 * to find the new last_pg, which also becomes the new root.
+		/* Subtract the free pages from last_pg to find
+		 * the new last_pg, which also becomes the new root.
 		 */
-		MDB_ID freecount = 0;
-		MDB_cursor mc;
-		MDB_val key, data;
-		mdb_cursor_init(&mc, txn, FREE_DBI, NULL);
-		while ((rc = mdb_cursor_get(&mc, &key, &data, MDB_NEXT)) == 0)
-			freecount += *(MDB_ID *)data.mv_data;
-		if (rc != MDB_NOTFOUND)
+		MDB_ID freecount;
+		rc = mdb_env_freecount(txn, &freecount);
+		if (rc)
 			goto finish;
-		freecount += txn->mt_dbs[FREE_DBI].md_branch_pages +
-			txn->mt_dbs[FREE_DBI].md_leaf_pages +
-			txn->mt_dbs[FREE_DBI].md_overflow_pages;
 
 		new_root = txn->mt_next_pgno - 1 - freecount;
 		mm->mm_last_pg = new_root;
@@ -10299,7 +12172,10 @@ mdb_env_copyfd0(MDB_env *env, HANDLE fd)
 		if (LOCK_MUTEX(rc, env, wmutex))
 			goto leave;
 
-		rc = mdb_txn_renew0(txn);
+		/* A queued commit writes its meta page without the lock */
+		mdb_env_async_other(env);
+		if (!(rc = mdb_env_async_wait(env)))
+			rc = mdb_txn_renew0(txn);
 		if (rc) {
 			UNLOCK_MUTEX(wmutex);
 			goto leave;
@@ -10328,83 +12204,1638 @@ mdb_env_copyfd0(MDB_env *env, HANDLE fd)
 	if (wmutex)
 		UNLOCK_MUTEX(wmutex);
 
-	if (rc)
-		goto leave;
+	if (rc)
+		goto leave;
+
+	w3 = txn->mt_next_pgno * env->me_psize;
+	{
+		mdb_size_t fsize = 0;
+		if ((rc = mdb_fsize(env->me_fd, &fsize)))
+			goto leave;
+		if (w3 > fsize)
+			w3 = fsize;
+	}
+	wsize = w3 - wsize;
+	while (wsize > 0) {
+		if (wsize > MAX_WRITE)
+			w2 = MAX_WRITE;
+		else
+			w2 = wsize;
+		DO_WRITE(rc, fd, ptr, w2, len);
+		if (!rc) {
+			rc = ErrCode();
+			break;
+		} else if (len > 0) {
+			rc = MDB_SUCCESS;
+			ptr += len;
+			wsize -= len;
+			continue;
+		} else {
+			rc = EIO;
+			break;
+		}
+	}
+
+leave:
+	mdb_txn_abort(txn);
+	return rc;
+}
+
+/** @defgroup pcopy Parallel compacting copy
+ *	The main DB is split into subtrees at its top levels, named DBs and
+ *	sub-DBs hanging off the top are split on their own. A counting pass
+ *	sizes every subtree, so each gets a range of page numbers and any
+ *	thread can renumber and write it with positional writes. The pages
+ *	above the subtrees are written last, followed by the meta pages.
+ *	@{
+ */
+#ifndef MDB_PCOPY_SPLIT
+	/** Subtrees per thread, for load balancing. */
+#define MDB_PCOPY_SPLIT	8
+#endif
+	/** Max. depth of a subtree plus the sub-DBs below it. */
+#define MDB_PCOPY_DEPTH	(CURSOR_STACK*2)
+
+enum { MDB_PC_UNIT, MDB_PC_UPPER, MDB_PC_OVERFLOW };
+
+	/** A subtree copied by one thread, a page above the subtrees
+	 *	or an overflow page referenced from one.
+	 */
+typedef struct mdb_pcopy_item {
+	pgno_t		 mi_pgno;	/**< page (root) in the env */
+	pgno_t		 mi_count;	/**< number of pages */
+	pgno_t		 mi_first;	/**< first page of a subtree in the copy */
+	pgno_t		 mi_new;	/**< page (root) in the copy */
+	MDB_page	*mi_copy;	/**< upper page, patched with the new children */
+	int			 mi_kind;	/**< #MDB_PC_UNIT, #MDB_PC_UPPER, ... */
+	int			 mi_flags;	/**< #F_DUPDATA in a sorted-duplicate sub-DB */
+	int			 mi_parent;	/**< upper page pointing here, -1 = main DB */
+	indx_t		 mi_node;	/**< node in the parent */
+} mdb_pcopy_item;
+
+	/** State shared by the threads of #mdb_env_copyfd3(). */
+typedef struct mdb_pcopy {
+	MDB_txn		*pc_txn;
+	HANDLE		 pc_fd;
+	lmdb_off_t	 pc_base;	/**< file offset of page 0 */
+	pthread_mutex_t pc_mutex;	/**< protects #pc_next */
+	mdb_pcopy_item *pc_items;
+	unsigned int pc_nitems;
+	unsigned int pc_size;	/**< allocated items */
+	unsigned int pc_next;	/**< next item to take */
+	int			 pc_count;	/**< counting pass, else copying */
+	/** Error code.  Never cleared if set, any thread can set it. */
+	volatile int pc_error;
+} mdb_pcopy;
+
+	/** A thread of #mdb_env_copyfd3(). */
+typedef struct mdb_pcopy_thr {
+	mdb_pcopy	*pt_pc;
+	pthread_t	 pt_thr;
+	char		*pt_wbuf;	/**< #MDB_WBUF bytes, OS page aligned */
+	size_t		 pt_wlen;
+	lmdb_off_t	 pt_wpos;	/**< file offset of #pt_wbuf */
+	char		*pt_pages;	/**< writable pages, one per level */
+	pgno_t		 pt_next;	/**< next page number in the copy */
+} mdb_pcopy_thr;
+
+	/** Allocate a buffer suitable for O_DIRECT writes. */
+static char * ESECT
+mdb_pcopy_alloc(MDB_env *env, size_t size)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, env->me_os_psize);
+#elif defined(HAVE_MEMALIGN)
+	return memalign(env->me_os_psize, size);
+#else
+	void *p;
+	return posix_memalign(&p, env->me_os_psize, size) ? NULL : p;
+#endif
+}
+
+static void ESECT
+mdb_pcopy_free(char *ptr)
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+static int ESECT
+mdb_pcopy_flush(mdb_pcopy_thr *pt)
+{
+	int rc = MDB_SUCCESS;
+
+	if (pt->pt_wlen) {
+		rc = mdb_fd_pwrite(pt->pt_pc->pc_fd, pt->pt_wbuf, pt->pt_wlen,
+			pt->pt_wpos);
+		pt->pt_wpos += pt->pt_wlen;
+		pt->pt_wlen = 0;
+	}
+	return rc;
+}
+
+	/** Write mp (npages if it is an overflow page) as page pgno. */
+static int ESECT
+mdb_pcopy_emit(mdb_pcopy_thr *pt, MDB_page *mp, pgno_t pgno, pgno_t npages)
+{
+	mdb_pcopy *pc = pt->pt_pc;
+	size_t psize = pc->pc_txn->mt_env->me_psize;
+	size_t rest = psize * (npages - 1);
+	lmdb_off_t pos = pc->pc_base + (lmdb_off_t)pgno * psize;
+	MDB_page *mo;
+	int rc;
+
+	if (pos != pt->pt_wpos + (lmdb_off_t)pt->pt_wlen ||
+		pt->pt_wlen + psize > MDB_WBUF) {
+		if ((rc = mdb_pcopy_flush(pt)))
+			return rc;
+		pt->pt_wpos = pos;
+	}
+	mo = (MDB_page *)(pt->pt_wbuf + pt->pt_wlen);
+	if (IS_OVERFLOW(mp))
+		memcpy(mo, mp, psize);
+	else
+		mdb_page_copy(mo, mp, psize);
+	mo->mp_pgno = pgno;
+	pt->pt_wlen += psize;
+	if (rest) {
+		/* The remaining overflow pages are copied unchanged */
+		if (pt->pt_wlen + rest <= MDB_WBUF) {
+			memcpy(pt->pt_wbuf + pt->pt_wlen, (char *)mp + psize, rest);
+			pt->pt_wlen += rest;
+		} else {
+			if ((rc = mdb_pcopy_flush(pt)) ||
+				(rc = mdb_fd_pwrite(pc->pc_fd, (char *)mp + psize, rest,
+					pos + psize)))
+				return rc;
+			pt->pt_wpos = pos + psize + rest;
+		}
+	}
+	return MDB_SUCCESS;
+}
+
+	/** Count the pages of a subtree, like #mdb_pcopy_walk() copies them. */
+static int ESECT
+mdb_pcopy_count(MDB_cursor *mc, pgno_t pg, int flags, int depth,
+	pgno_t *count)
+{
+	MDB_page *mp, *omp;
+	MDB_node *ni;
+	MDB_db db;
+	unsigned int i, n;
+	int rc;
+
+	if (depth >= MDB_PCOPY_DEPTH)
+		return MDB_CORRUPTED;
+	if ((rc = mdb_page_get(mc, pg, &mp, NULL)))
+		return rc;
+	++*count;
+	n = NUMKEYS(mp);
+	if (IS_BRANCH(mp)) {
+		for (i=0; i<n; i++) {
+			rc = mdb_pcopy_count(mc, NODEPGNO(NODEPTR(mp, i)), flags,
+				depth+1, count);
+			if (rc)
+				return rc;
+		}
+	} else if (!IS_LEAF2(mp) && !(flags & F_DUPDATA)) {
+		for (i=0; i<n; i++) {
+			ni = NODEPTR(mp, i);
+			if (ni->mn_flags & F_BIGDATA) {
+				memcpy(&pg, NODEDATA(ni), sizeof(pg));
+				if ((rc = mdb_page_get(mc, pg, &omp, NULL)))
+					return rc;
+				*count += omp->mp_pages;
+			} else if (ni->mn_flags & F_SUBDATA) {
+				memcpy(&db, NODEDATA(ni), sizeof(db));
+				if (db.md_root != P_INVALID &&
+					(rc = mdb_pcopy_count(mc, db.md_root,
+						ni->mn_flags & F_DUPDATA, depth+1, count)))
+					return rc;
+			}
+		}
+	}
+	return MDB_SUCCESS;
+}
+
+	/** Copy a subtree to the pages from pt->pt_next on, in post-order
+	 *	like #mdb_env_cwalk().
+	 * @param[in,out] pg root of the subtree, in the env / in the copy.
+	 */
+static int ESECT
+mdb_pcopy_walk(mdb_pcopy_thr *pt, MDB_cursor *mc, pgno_t *pg, int flags,
+	int depth)
+{
+	unsigned int psize = mc->mc_txn->mt_env->me_psize;
+	MDB_page *mp, *omp, *mo;
+	MDB_node *ni;
+	MDB_db db;
+	pgno_t cpg;
+	unsigned int i, n;
+	int rc;
+
+	if (depth >= MDB_PCOPY_DEPTH)
+		return MDB_CORRUPTED;
+	if ((rc = mdb_page_get(mc, *pg, &mp, NULL)))
+		return rc;
+	mo = (MDB_page *)(pt->pt_pages + (size_t)depth * psize);
+	n = NUMKEYS(mp);
+	if (IS_BRANCH(mp)) {
+		mdb_page_copy(mo, mp, psize);
+		mp = mo;
+		for (i=0; i<n; i++) {
+			ni = NODEPTR(mp, i);
+			cpg = NODEPGNO(ni);
+			if ((rc = mdb_pcopy_walk(pt, mc, &cpg, flags, depth+1)))
+				return rc;
+			SETPGNO(ni, cpg);
+		}
+	} else if (!IS_LEAF2(mp) && !(flags & F_DUPDATA)) {
+		for (i=0; i<n; i++) {
+			ni = NODEPTR(mp, i);
+			if (!(ni->mn_flags & (F_BIGDATA|F_SUBDATA)))
+				continue;
+			/* Need writable leaf */
+			if (mp != mo) {
+				mdb_page_copy(mo, mp, psize);
+				mp = mo;
+				ni = NODEPTR(mp, i);
+			}
+			if (ni->mn_flags & F_BIGDATA) {
+				memcpy(&cpg, NODEDATA(ni), sizeof(cpg));
+				if ((rc = mdb_page_get(mc, cpg, &omp, NULL)))
+					return rc;
+				memcpy(NODEDATA(ni), &pt->pt_next, sizeof(pgno_t));
+				rc = mdb_pcopy_emit(pt, omp, pt->pt_next, omp->mp_pages);
+				pt->pt_next += omp->mp_pages;
+			} else {
+				memcpy(&db, NODEDATA(ni), sizeof(db));
+				if (db.md_root != P_INVALID)
+					rc = mdb_pcopy_walk(pt, mc, &db.md_root,
+						ni->mn_flags & F_DUPDATA, depth+1);
+				memcpy(NODEDATA(ni), &db, sizeof(db));
+			}
+			if (rc)
+				return rc;
+		}
+	}
+	*pg = pt->pt_next++;
+	return mdb_pcopy_emit(pt, mp, *pg, 1);
+}
+
+	/** Worker of #mdb_env_copyfd3(): counts or copies subtrees until
+	 *	there are none left.
+	 */
+static THREAD_RET ESECT CALL_CONV
+mdb_pcopy_worker(void *arg)
+{
+	mdb_pcopy_thr *pt = arg;
+	mdb_pcopy *pc = pt->pt_pc;
+	mdb_pcopy_item *mi;
+	MDB_cursor mc = {0};
+	unsigned int i;
+	int rc;
+
+	mc.mc_txn = pc->pc_txn;
+	mc.mc_flags = pc->pc_txn->mt_flags & (C_ORIG_RDONLY|C_WRITEMAP);
+	while (!pc->pc_error) {
+		pthread_mutex_lock(&pc->pc_mutex);
+		i = pc->pc_next++;
+		pthread_mutex_unlock(&pc->pc_mutex);
+		if (i >= pc->pc_nitems)
+			break;
+		mi = &pc->pc_items[i];
+		if (mi->mi_kind != MDB_PC_UNIT)
+			continue;
+		if (pc->pc_count) {
+			mi->mi_count = 0;
+			rc = mdb_pcopy_count(&mc, mi->mi_pgno, mi->mi_flags, 0,
+				&mi->mi_count);
+		} else {
+			pt->pt_next = mi->mi_first;
+			mi->mi_new = mi->mi_pgno;
+			rc = mdb_pcopy_walk(pt, &mc, &mi->mi_new, mi->mi_flags, 0);
+			if (!rc && pt->pt_next != mi->mi_first + mi->mi_count)
+				rc = MDB_CORRUPTED;
+		}
+		if (rc)
+			pc->pc_error = rc;
+	}
+	if ((rc = mdb_pcopy_flush(pt)))
+		pc->pc_error = rc;
+	return 0;
+}
+
+	/** Run a pass of #mdb_pcopy_worker() on threads threads. */
+static int ESECT
+mdb_pcopy_run(mdb_pcopy *pc, mdb_pcopy_thr *pt, unsigned int threads,
+	int count)
+{
+	unsigned int i, n;
+	int rc = MDB_SUCCESS;
+
+	pc->pc_next = 0;
+	pc->pc_count = count;
+	for (n=1; n<threads; n++) {
+		if ((rc = THREAD_CREATE(pt[n].pt_thr, mdb_pcopy_worker, &pt[n]))) {
+			pc->pc_error = rc;
+			break;
+		}
+	}
+	(void) mdb_pcopy_worker(&pt[0]);
+	for (i=1; i<n; i++) {
+		if ((rc = THREAD_FINISH(pt[i].pt_thr)))
+			pc->pc_error = rc;
+	}
+	return pc->pc_error;
+}
+
+static int ESECT
+mdb_pcopy_add(mdb_pcopy *pc, pgno_t pgno, int kind, int flags, int parent,
+	indx_t node)
+{
+	mdb_pcopy_item *mi;
+
+	if (pc->pc_nitems == pc->pc_size) {
+		unsigned int n = pc->pc_size ? pc->pc_size * 2 : 64;
+		if ((mi = realloc(pc->pc_items, n * sizeof(*mi))) == NULL)
+			return ENOMEM;
+		pc->pc_items = mi;
+		pc->pc_size = n;
+	}
+	mi = &pc->pc_items[pc->pc_nitems++];
+	memset(mi, 0, sizeof(*mi));
+	mi->mi_pgno = pgno;
+	mi->mi_kind = kind;
+	mi->mi_flags = flags;
+	mi->mi_parent = parent;
+	mi->mi_node = node;
+	return MDB_SUCCESS;
+}
+
+	/** Split the main DB into at least target subtrees, if it has them.
+	 *	Branch pages and leaves with sub-DBs are opened up breadth first
+	 *	and become upper pages.
+	 */
+static int ESECT
+mdb_pcopy_split(mdb_pcopy *pc, MDB_cursor *mc, unsigned int target)
+{
+	unsigned int psize = mc->mc_txn->mt_env->me_psize;
+	MDB_page *mp, *omp;
+	MDB_node *ni;
+	MDB_db db;
+	pgno_t pg;
+	unsigned int i, n, head, units = 1;
+	int rc, flags;
+
+	rc = mdb_pcopy_add(pc, mc->mc_txn->mt_dbs[MAIN_DBI].md_root,
+		MDB_PC_UNIT, 0, -1, 0);
+	for (head=0; !rc && head < pc->pc_nitems && units < target; head++) {
+		if (pc->pc_items[head].mi_kind != MDB_PC_UNIT)
+			continue;
+		flags = pc->pc_items[head].mi_flags;
+		if ((rc = mdb_page_get(mc, pc->pc_items[head].mi_pgno, &mp, NULL)))
+			break;
+		n = NUMKEYS(mp);
+		if (IS_LEAF(mp)) {
+			if (IS_LEAF2(mp) || (flags & F_DUPDATA))
+				continue;
+			for (i=0; i<n; i++) {
+				ni = NODEPTR(mp, i);
+				if (ni->mn_flags & F_SUBDATA) {
+					memcpy(&db, NODEDATA(ni), sizeof(db));
+					if (db.md_root != P_INVALID)
+						break;
+				}
+			}
+			if (i == n)		/* nothing to split off */
+				continue;
+		}
+
+		if ((pc->pc_items[head].mi_copy = malloc(psize)) == NULL) {
+			rc = ENOMEM;
+			break;
+		}
+		memcpy(pc->pc_items[head].mi_copy, mp, psize);
+		pc->pc_items[head].mi_kind = MDB_PC_UPPER;
+		units--;
+		for (i=0; !rc && i<n; i++) {
+			ni = NODEPTR(mp, i);
+			if (IS_BRANCH(mp)) {
+				rc = mdb_pcopy_add(pc, NODEPGNO(ni), MDB_PC_UNIT, flags,
+					head, i);
+				units++;
+			} else if (ni->mn_flags & F_BIGDATA) {
+				memcpy(&pg, NODEDATA(ni), sizeof(pg));
+				if (!(rc = mdb_page_get(mc, pg, &omp, NULL)) &&
+					!(rc = mdb_pcopy_add(pc, pg, MDB_PC_OVERFLOW, 0, head, i)))
+					pc->pc_items[pc->pc_nitems-1].mi_count = omp->mp_pages;
+			} else if (ni->mn_flags & F_SUBDATA) {
+				memcpy(&db, NODEDATA(ni), sizeof(db));
+				if (db.md_root != P_INVALID) {
+					rc = mdb_pcopy_add(pc, db.md_root, MDB_PC_UNIT,
+						ni->mn_flags & F_DUPDATA, head, i);
+					units++;
+				}
+			}
+		}
+	}
+	return rc;
+}
+
+	/** Copy environment with compaction, on several threads. */
+static int ESECT
+mdb_env_pcopy(MDB_env *env, HANDLE fd, lmdb_off_t base,
+	unsigned int threads)
+{
+	mdb_pcopy pc = {0};
+	mdb_pcopy_thr *pt = NULL;
+	mdb_pcopy_item *mi;
+	MDB_cursor mc = {0};
+	MDB_txn *txn = NULL;
+	MDB_page *mp;
+	MDB_meta *mm;
+	MDB_node *ni;
+	MDB_db db;
+	MDB_ID freecount;
+	pgno_t next;
+	unsigned int i;
+	int rc;
+
+#ifdef _WIN32
+	if (!(pc.pc_mutex = CreateMutex(NULL, FALSE, NULL)))
+		return ErrCode();
+#else
+	if ((rc = pthread_mutex_init(&pc.pc_mutex, NULL)) != 0)
+		return rc;
+#endif
+	pc.pc_fd = fd;
+	pc.pc_base = base;
+
+	rc = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+	if (rc)
+		goto done;
+	pc.pc_txn = txn;
+	mc.mc_txn = txn;
+	mc.mc_flags = txn->mt_flags & (C_ORIG_RDONLY|C_WRITEMAP);
+	if (txn->mt_dbs[MAIN_DBI].md_root == P_INVALID) {
+		/* Nothing to split, see the empty DB case there */
+		mdb_txn_abort(txn);
+		txn = NULL;
+		rc = mdb_env_copyfd1(env, fd);
+		goto done;
+	}
+	if ((rc = mdb_env_freecount(txn, &freecount)))
+		goto done;
+
+	if ((pt = calloc(threads, sizeof(*pt))) == NULL) {
+		rc = ENOMEM;
+		goto done;
+	}
+	for (i=0; i<threads; i++) {
+		pt[i].pt_pc = &pc;
+		pt[i].pt_wbuf = mdb_pcopy_alloc(env, MDB_WBUF);
+		pt[i].pt_pages = malloc((size_t)env->me_psize * MDB_PCOPY_DEPTH);
+		if (!pt[i].pt_wbuf || !pt[i].pt_pages) {
+			rc = ENOMEM;
+			goto done;
+		}
+	}
+
+	if ((rc = mdb_pcopy_split(&pc, &mc, threads * MDB_PCOPY_SPLIT)) ||
+		(rc = mdb_pcopy_run(&pc, pt, threads, 1)))
+		goto done;
+
+	/* Assign page ranges: subtrees, then the pages above them */
+	next = NUM_METAS;
+	for (i=0; i<pc.pc_nitems; i++) {
+		mi = &pc.pc_items[i];
+		if (mi->mi_kind == MDB_PC_UNIT) {
+			mi->mi_first = next;
+			next += mi->mi_count;
+		}
+	}
+	for (i=0; i<pc.pc_nitems; i++) {
+		mi = &pc.pc_items[i];
+		if (mi->mi_kind == MDB_PC_OVERFLOW) {
+			mi->mi_new = next;
+			next += mi->mi_count;
+		}
+	}
+	for (i=0; i<pc.pc_nitems; i++) {
+		mi = &pc.pc_items[i];
+		if (mi->mi_kind == MDB_PC_UPPER)
+			mi->mi_new = next++;
+	}
+	if (next != txn->mt_next_pgno - freecount) {
+		rc = MDB_INCOMPATIBLE;	/* page leak or corrupt DB */
+		goto done;
+	}
+
+	if ((rc = mdb_pcopy_run(&pc, pt, threads, 0)))
+		goto done;
+
+	/* Point the upper pages to the new locations and write them */
+	for (i=0; i<pc.pc_nitems; i++) {
+		mi = &pc.pc_items[i];
+		if (mi->mi_parent < 0)
+			continue;
+		mp = pc.pc_items[mi->mi_parent].mi_copy;
+		ni = NODEPTR(mp, mi->mi_node);
+		if (IS_BRANCH(mp)) {
+			SETPGNO(ni, mi->mi_new);
+		} else if (mi->mi_kind == MDB_PC_OVERFLOW) {
+			memcpy(NODEDATA(ni), &mi->mi_new, sizeof(pgno_t));
+		} else {
+			memcpy(&db, NODEDATA(ni), sizeof(db));
+			db.md_root = mi->mi_new;
+			memcpy(NODEDATA(ni), &db, sizeof(db));
+		}
+	}
+	for (i=0; !rc && i<pc.pc_nitems; i++) {
+		mi = &pc.pc_items[i];
+		if (mi->mi_kind == MDB_PC_OVERFLOW &&
+			!(rc = mdb_page_get(&mc, mi->mi_pgno, &mp, NULL)))
+			rc = mdb_pcopy_emit(pt, mp, mi->mi_new, mi->mi_count);
+	}
+	for (i=0; !rc && i<pc.pc_nitems; i++) {
+		mi = &pc.pc_items[i];
+		if (mi->mi_kind == MDB_PC_UPPER)
+			rc = mdb_pcopy_emit(pt, mi->mi_copy, mi->mi_new, 1);
+	}
+	if (rc || (rc = mdb_pcopy_flush(pt)))
+		goto done;
+
+	/* Meta pages last, metapage 1 with the new main DB */
+	mp = (MDB_page *)pt->pt_wbuf;
+	memset(mp, 0, NUM_METAS * env->me_psize);
+	mp->mp_pgno = 0;
+	mp->mp_flags = P_META;
+	mm = (MDB_meta *)METADATA(mp);
+	mdb_env_init_meta0(env, mm);
+	mm->mm_address = env->me_metas[0]->mm_address;
+
+	mp = (MDB_page *)(pt->pt_wbuf + env->me_psize);
+	mp->mp_pgno = 1;
+	mp->mp_flags = P_META;
+	*(MDB_meta *)METADATA(mp) = *mm;
+	mm = (MDB_meta *)METADATA(mp);
+	mm->mm_last_pg = next - 1;
+	mm->mm_dbs[MAIN_DBI] = txn->mt_dbs[MAIN_DBI];
+	mm->mm_dbs[MAIN_DBI].md_root = pc.pc_items[0].mi_new;
+	mm->mm_txnid = 1;
+
+	pt->pt_wpos = base;
+	pt->pt_wlen = NUM_METAS * env->me_psize;
+	rc = mdb_pcopy_flush(pt);
+
+	/* Leave the file position behind the copy, like a sequential copy */
+	if (!rc) {
+#ifdef _WIN32
+		LARGE_INTEGER end;
+		end.QuadPart = base + (lmdb_off_t)next * env->me_psize;
+		if (!SetFilePointerEx(fd, end, NULL, FILE_BEGIN))
+			rc = ErrCode();
+#else
+		if (lseek(fd, base + (lmdb_off_t)next * env->me_psize, SEEK_SET) < 0)
+			rc = ErrCode();
+#endif
+	}
+
+done:
+	if (pt) {
+		for (i=0; i<threads; i++) {
+			mdb_pcopy_free(pt[i].pt_wbuf);
+			free(pt[i].pt_pages);
+		}
+		free(pt);
+	}
+	for (i=0; i<pc.pc_nitems; i++)
+		free(pc.pc_items[i].mi_copy);
+	free(pc.pc_items);
+	mdb_txn_abort(txn);
+#ifdef _WIN32
+	CloseHandle(pc.pc_mutex);
+#else
+	pthread_mutex_destroy(&pc.pc_mutex);
+#endif
+	return rc;
+}
+/** @} */
+
+int ESECT
+mdb_env_copyfd3(MDB_env *env, HANDLE fd, unsigned int flags,
+	unsigned int threads)
+{
+	lmdb_off_t base;
+
+#ifdef MDB_VL32
+	threads = 1;	/* pages are mapped on demand per txn */
+#endif
+	if (!(flags & MDB_CP_COMPACT) || threads < 2)
+		return mdb_env_copyfd2(env, fd, flags);
+
+	/* Positional writes need a file, not a pipe */
+#ifdef _WIN32
+	{
+		LARGE_INTEGER zero, pos;
+		zero.QuadPart = 0;
+		if (GetFileType(fd) != FILE_TYPE_DISK ||
+			!SetFilePointerEx(fd, zero, &pos, FILE_CURRENT))
+			return mdb_env_copyfd1(env, fd);
+		base = pos.QuadPart;
+	}
+#else
+	if ((base = lseek(fd, 0, SEEK_CUR)) < 0)
+		return mdb_env_copyfd1(env, fd);
+#endif
+	return mdb_env_pcopy(env, fd, base, threads);
+}
+
+int ESECT
+mdb_env_copyfd2(MDB_env *env, HANDLE fd, unsigned int flags)
+{
+	if (flags & MDB_CP_COMPACT)
+		return mdb_env_copyfd1(env, fd);
+	else
+		return mdb_env_copyfd0(env, fd);
+}
+
+int ESECT
+mdb_env_copyfd(MDB_env *env, HANDLE fd)
+{
+	return mdb_env_copyfd2(env, fd, 0);
+}
+
+int ESECT
+mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags)
+{
+	return mdb_env_copy3(env, path, flags, 1);
+}
+
+int ESECT
+mdb_env_copy3(MDB_env *env, const char *path, unsigned int flags,
+	unsigned int threads)
+{
+	int rc;
+	MDB_name fname;
+	HANDLE newfd = INVALID_HANDLE_VALUE;
+
+	rc = mdb_fname_init(path, env->me_flags | MDB_NOLOCK, &fname);
+	if (rc == MDB_SUCCESS) {
+		rc = mdb_fopen(env, &fname, MDB_O_COPY, 0666, &newfd);
+		mdb_fname_destroy(fname);
+	}
+	if (rc == MDB_SUCCESS) {
+		rc = mdb_env_copyfd3(env, newfd, flags, threads);
+		if (close(newfd) < 0 && rc == MDB_SUCCESS)
+			rc = ErrCode();
+	}
+	return rc;
+}
+
+int ESECT
+mdb_env_copy(MDB_env *env, const char *path)
+{
+	return mdb_env_copy2(env, path, 0);
+}
+
+/** @defgroup shrink	Online shrink
+ *	#mdb_env_shrink() lowers the end of the used pages in small write
+ *	txns. Each txn first drops the free pages at the end from the
+ *	freelist. The target is where the used pages would end if all
+ *	reusable free pages were gone. The txn touches the live pages at or
+ *	above it, so copy-on-write moves them to the lowest free pages, and
+ *	updates the pointers to them. Their old pages become free once no
+ *	snapshot uses them, and a later txn drops them.
+ *
+ *	A txn resumes the walk of the trees where the previous one ran out
+ *	of budget, so a pass over the whole file takes about one read of
+ *	each page. Passes repeat until one moves no page.
+ *	@{
+ */
+
+	/** Trees a walk is nested in: the main DB, a named DB and the
+	 *	duplicates of one of its keys
+	 */
+#define MDB_SHRINK_NEST	3
+
+	/** Where a shrink txn stopped. The path is kept as page indices,
+	 *	the keys of a named DB may need a comparator the walk does not
+	 *	know. Other writers may change the trees in between, so the next
+	 *	txn may skip or repeat a few pages; a later pass finds them.
+	 */
+typedef struct MDB_shrink_pos {
+	int			sp_free;	/**< the main DB is done, walk the freeDB */
+	unsigned	sp_depth;	/**< trees on the path, 0 = from the start */
+	unsigned short	sp_snum[MDB_SHRINK_NEST];	/**< levels of each tree */
+	indx_t		sp_ki[MDB_SHRINK_NEST][CURSOR_STACK];
+} MDB_shrink_pos;
+
+	/** State of a shrink txn */
+typedef struct MDB_shrink {
+	pgno_t		ms_target;	/**< move the live pages at or above this */
+	pgno_t		ms_avail;	/**< free pages below #ms_target */
+	unsigned	ms_budget;	/**< pages the txn may still touch */
+	unsigned	ms_moved;	/**< pages moved from above #ms_target */
+	int			ms_full;	/**< out of budget or free pages, stop */
+	int			ms_saved;	/**< the innermost tree saved its position */
+	MDB_shrink_pos	*ms_pos;	/**< where to resume, updated on stop */
+} MDB_shrink;
+
+	/** A tree being walked */
+typedef struct MDB_shrink_tree {
+	MDB_cursor	st_cursor;
+	/** The tree whose leaf at its cursor holds #st_db, or NULL
+	 *	when the tree is in the txn's DB table.
+	 */
+	struct MDB_shrink_tree *st_up;
+	MDB_db		st_db;
+} MDB_shrink_tree;
+
+	/** Free pages the txn keeps below the target for its freelist */
+#define MDB_SHRINK_RESERVE	CURSOR_STACK
+
+/** Number of pages #mdb_shrink_touch() would copy. */
+static unsigned
+mdb_shrink_clean(MDB_shrink_tree *st)
+{
+	MDB_cursor *mc;
+	unsigned i, n = 0;
+
+	for (; st; st = st->st_up) {
+		mc = &st->st_cursor;
+		for (i = 0; i < mc->mc_snum; i++)
+			if (!(mc->mc_pg[i]->mp_flags & P_DIRTY))
+				n++;
+	}
+	return n;
+}
+
+/** Check if the txn may copy \b num more pages below the target. */
+static int
+mdb_shrink_room(MDB_shrink *ms, unsigned num)
+{
+	if (num > ms->ms_budget || num + MDB_SHRINK_RESERVE > ms->ms_avail) {
+		ms->ms_full = 1;
+		return 0;
+	}
+	return 1;
+}
+
+/** Make the cursor stack of a tree and of the trees above it writable.
+ *	The caller checked #mdb_shrink_room().
+ * @param[in] ms the shrink state
+ * @param[in] st the tree
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_shrink_touch(MDB_shrink *ms, MDB_shrink_tree *st)
+{
+	MDB_cursor *mc = &st->st_cursor, *up;
+	MDB_node *node;
+	pgno_t root = mc->mc_db->md_root;
+	unsigned i, n = 0;
+	int rc;
+
+	for (i = 0; i < mc->mc_snum; i++) {
+		if (!(mc->mc_pg[i]->mp_flags & P_DIRTY)) {
+			n++;
+			if (mc->mc_pg[i]->mp_pgno >= ms->ms_target)
+				ms->ms_moved++;
+		}
+	}
+	if (!n)
+		return MDB_SUCCESS;
+	if (st->st_up && (rc = mdb_shrink_touch(ms, st->st_up)) != 0)
+		return rc;
+	if ((rc = mdb_cursor_touch(mc)) != 0)
+		return rc;
+	ms->ms_budget -= n;
+	ms->ms_avail -= n;
+	if (st->st_up && mc->mc_db->md_root != root) {
+		up = &st->st_up->st_cursor;
+		node = NODEPTR(up->mc_pg[up->mc_top], up->mc_ki[up->mc_top]);
+		memcpy(NODEDATA(node), mc->mc_db, sizeof(MDB_db));
+	}
+	return MDB_SUCCESS;
+}
+
+/** Move an overflow page run below the target.
+ * @param[in] ms the shrink state
+ * @param[in] st the tree, its cursor is at the leaf node of the run
+ * @param[in] omp the first page of the run
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_shrink_ovpage(MDB_shrink *ms, MDB_shrink_tree *st, MDB_page *omp)
+{
+	MDB_cursor *mc = &st->st_cursor;
+	MDB_txn *txn = mc->mc_txn;
+	MDB_EXTL mop = txn->mt_env->me_pghead;
+	MDB_page *np;
+	MDB_node *node;
+	pgno_t pg = omp->mp_pgno, pgno;
+	unsigned i, ovpages = omp->mp_pages;
+	int rc;
+
+	/* #mdb_page_alloc() takes the lowest extent that fits */
+	for (i = mop[0].mx_id; i; i--)
+		if (mop[i].mx_len >= ovpages)
+			break;
+	if (!i || mop[i].mx_id + ovpages > ms->ms_target)
+		return MDB_SUCCESS;
+	if (!mdb_shrink_room(ms, ovpages + mdb_shrink_clean(st)))
+		return MDB_SUCCESS;
+	if ((rc = mdb_shrink_touch(ms, st)) != 0 ||
+		(rc = mdb_page_alloc(mc, ovpages, &np)) != 0)
+		return rc;
+	pgno = np->mp_pgno;
+	DPRINTF(("shrink ov page %"Yu" (%u) -> %"Yu, pg, ovpages, pgno));
+	memcpy(np, omp, (size_t)ovpages * txn->mt_env->me_psize);
+	np->mp_pgno = pgno;
+	np->mp_flags |= P_DIRTY;
+	node = NODEPTR(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+	memcpy(NODEDATA(node), &pgno, sizeof(pgno));
+	if ((rc = mdb_midl_append_range(&txn->mt_free_pgs, pg, ovpages)) != 0)
+		return rc;
+	ms->ms_budget -= ovpages;
+	ms->ms_avail -= ovpages;
+	ms->ms_moved += ovpages;
+	return MDB_SUCCESS;
+}
+
+/** Save the position of a tree a shrink txn stopped in.
+ *	The innermost tree saves first, the trees above it add their part.
+ * @param[in] ms the shrink state
+ * @param[in] mc the cursor of the tree, at the node to resume with
+ * @param[in] depth the nesting of the tree, 0 = main DB or freeDB
+ */
+static void
+mdb_shrink_save(MDB_shrink *ms, MDB_cursor *mc, unsigned depth)
+{
+	MDB_shrink_pos *sp = ms->ms_pos;
+
+	if (depth >= MDB_SHRINK_NEST)
+		return;
+	if (!ms->ms_saved) {
+		sp->sp_depth = depth + 1;
+		ms->ms_saved = 1;
+	}
+	sp->sp_snum[depth] = mc->mc_snum;
+	memcpy(sp->sp_ki[depth], mc->mc_ki, mc->mc_snum * sizeof(indx_t));
+}
+
+/** Move the cursor of a tree to the leaf a shrink txn stopped in.
+ *	Indices past the end of a page, after other writers deleted
+ *	nodes, are cut to the last node.
+ * @param[in] ms the shrink state
+ * @param[in] mc the cursor of the tree
+ * @param[in] depth the nesting of the tree
+ * @param[out] start the node of the leaf to resume with
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_shrink_seek(MDB_shrink *ms, MDB_cursor *mc, unsigned depth,
+	unsigned *start)
+{
+	MDB_shrink_pos *sp = ms->ms_pos;
+	MDB_page *mp;
+	unsigned i, lvl, snum = sp->sp_snum[depth];
+	int rc;
+
+	if ((rc = mdb_page_search(mc, NULL, MDB_PS_ROOTONLY)) != 0)
+		return rc;
+	for (lvl = 0, mp = mc->mc_pg[0]; IS_BRANCH(mp); lvl++) {
+		i = lvl < snum ? sp->sp_ki[depth][lvl] : 0;
+		if (i >= NUMKEYS(mp))
+			i = NUMKEYS(mp) - 1;
+		mc->mc_ki[mc->mc_top] = i;
+		if ((rc = mdb_page_get(mc, NODEPGNO(NODEPTR(mp, i)), &mp, NULL)) != 0 ||
+			(rc = mdb_cursor_push(mc, mp)) != 0)
+			return rc;
+	}
+	if (!IS_LEAF(mp)) {
+		mc->mc_txn->mt_flags |= MDB_TXN_ERROR;
+		return MDB_CORRUPTED;
+	}
+	mc->mc_flags |= C_INITIALIZED;
+	mc->mc_flags &= ~C_EOF;
+	*start = lvl < snum ? sp->sp_ki[depth][lvl] : 0;
+	return MDB_SUCCESS;
+}
+
+/** Move the pages of a tree at or above the target, with the overflow
+ *	pages and the trees its leaves refer to. Saves the position when
+ *	the txn runs out of budget or free pages.
+ * @param[in] ms the shrink state
+ * @param[in] st the tree, its cursor is initialized
+ * @param[in] depth the nesting of the tree, 0 = main DB or freeDB
+ * @param[in] resume start at the saved position of the tree
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_shrink_tree(MDB_shrink *ms, MDB_shrink_tree *st, unsigned depth,
+	int resume)
+{
+	MDB_cursor *mc = &st->st_cursor;
+	MDB_shrink_tree sub;
+	MDB_xcursor mx;
+	MDB_page *mp, *omp;
+	MDB_node *node;
+	pgno_t pg;
+	unsigned i, start = 0;
+	int rc;
+
+	resume = resume && depth < ms->ms_pos->sp_depth;
+	if (resume)
+		rc = mdb_shrink_seek(ms, mc, depth, &start);
+	else
+		rc = mdb_page_search(mc, NULL, MDB_PS_FIRST);
+	for (; !rc; rc = mdb_cursor_sibling(mc, 1), start = 0, resume = 0) {
+		for (i = 0; i < mc->mc_snum; i++)
+			if (mc->mc_pg[i]->mp_pgno >= ms->ms_target &&
+				!(mc->mc_pg[i]->mp_flags & P_DIRTY))
+				break;
+		if (i < mc->mc_snum) {
+			if (!mdb_shrink_room(ms, mdb_shrink_clean(st))) {
+				mc->mc_ki[mc->mc_top] = start;
+				mdb_shrink_save(ms, mc, depth);
+				return MDB_SUCCESS;
+			}
+			if ((rc = mdb_shrink_touch(ms, st)) != 0)
+				return rc;
+		}
+		if (IS_LEAF2(mc->mc_pg[mc->mc_top]))
+			continue;
+		for (i = start; i < NUMKEYS(mc->mc_pg[mc->mc_top]); i++) {
+			mp = mc->mc_pg[mc->mc_top];	/* may have been touched */
+			node = NODEPTR(mp, i);
+			mc->mc_ki[mc->mc_top] = i;
+			if (F_ISSET(node->mn_flags, F_BIGDATA)) {
+				memcpy(&pg, NODEDATA(node), sizeof(pg));
+				if (pg < ms->ms_target)
+					continue;
+				if ((rc = mdb_page_get(mc, pg, &omp, NULL)) != 0 ||
+					(rc = mdb_shrink_ovpage(ms, st, omp)) != 0)
+					return rc;
+			} else if (F_ISSET(node->mn_flags, F_SUBDATA)) {
+				/* A named DB, or the duplicates of a key */
+				mdb_cursor_init(&sub.st_cursor, mc->mc_txn, MAIN_DBI, &mx);
+				sub.st_cursor.mc_xcursor = NULL;
+				sub.st_cursor.mc_db = &sub.st_db;
+				sub.st_up = st;
+				memcpy(&sub.st_db, NODEDATA(node), sizeof(MDB_db));
+				if ((rc = mdb_shrink_tree(ms, &sub, depth + 1,
+					resume && i == start)) != 0)
+					return rc;
+			}
+			if (ms->ms_full) {
+				mdb_shrink_save(ms, mc, depth);
+				return MDB_SUCCESS;
+			}
+		}
+	}
+	return rc == MDB_NOTFOUND ? MDB_SUCCESS : rc;
+}
+
+/** Run one shrink step in a write txn.
+ * @param[in] txn the write txn
+ * @param[in] max_pages the number of pages the step may touch
+ * @param[in,out] pos where the walk of the trees resumes, or NULL
+ * to only drop the free pages at the end
+ * @param[out] target where the used pages would end
+ * @param[out] moved pages moved from above the target
+ * @param[out] dropped free pages dropped from the end
+ * @param[out] done the walk reached the end of the trees, or could not
+ * go on, and starts again from the beginning
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_shrink_step(MDB_txn *txn, unsigned max_pages, MDB_shrink_pos *pos,
+	pgno_t *target, unsigned *moved, pgno_t *dropped, int *done)
+{
+	MDB_env *env = txn->mt_env;
+	MDB_shrink ms;
+	MDB_shrink_tree st;
+	MDB_xcursor mx;
+	MDB_page *np;
+	MDB_EXTL mop;
+	pgno_t end;
+	unsigned i;
+	int rc;
+
+	*moved = 0;
+	*dropped = 0;
+	*done = 1;
+	mdb_cursor_init(&st.st_cursor, txn, MAIN_DBI, &mx);
+	st.st_cursor.mc_xcursor = NULL;
+	st.st_up = NULL;
+	if ((rc = mdb_page_alloc(&st.st_cursor, 0, &np)) != 0)
+		return rc;
+	*target = txn->mt_next_pgno;
+	mop = env->me_pghead;
+	if (!mop || !mop[0].mx_id) {
+		if (pos)
+			memset(pos, 0, sizeof(*pos));
+		return MDB_SUCCESS;
+	}
+
+	/* Extents are maximal, at most one ends at mt_next_pgno */
+	if (mop[1].mx_id + mop[1].mx_len == txn->mt_next_pgno) {
+		*dropped = mop[1].mx_len;
+		txn->mt_next_pgno = mop[1].mx_id;
+		mdb_mext_take(mop, 1, mop[1].mx_len);
+		DPRINTF(("shrink drops %"Yu" pages, last page %"Yu,
+			*dropped, txn->mt_next_pgno - 1));
+	}
+	ms.ms_target = txn->mt_next_pgno - mop[0].mx_len;
+	*target = ms.ms_target;
+	if (!pos)
+		return MDB_SUCCESS;
+
+	ms.ms_avail = 0;
+	for (i = mop[0].mx_id; i && mop[i].mx_id < ms.ms_target; i--) {
+		end = mop[i].mx_id + mop[i].mx_len;
+		ms.ms_avail += (end < ms.ms_target ? end : ms.ms_target) - mop[i].mx_id;
+	}
+	ms.ms_budget = max_pages;
+	if (ms.ms_budget > txn->mt_dirty_room / 2)
+		ms.ms_budget = txn->mt_dirty_room / 2;
+	max_pages = ms.ms_budget;
+	ms.ms_moved = 0;
+	ms.ms_full = 0;
+	ms.ms_saved = 0;
+	ms.ms_pos = pos;
+
+	rc = MDB_SUCCESS;
+	if (!pos->sp_free) {
+		rc = mdb_shrink_tree(&ms, &st, 0, 1);
+		if (!rc && !ms.ms_full) {
+			pos->sp_free = 1;
+			pos->sp_depth = 0;
+		}
+	}
+	if (!rc && !ms.ms_full) {
+		mdb_cursor_init(&st.st_cursor, txn, FREE_DBI, NULL);
+		rc = mdb_shrink_tree(&ms, &st, 0, 1);
+	}
+	*moved = ms.ms_moved;
+	/* Stuck if not even the first pages fit, as with an overflow run
+	 * larger than the budget
+	 */
+	*done = !ms.ms_full || ms.ms_budget == max_pages;
+	if (*done) {
+		pos->sp_free = 0;
+		pos->sp_depth = 0;
+	}
+	return rc;
+}
+/** @} */
+
+int ESECT
+mdb_env_shrink(MDB_env *env, unsigned int max_pages, mdb_size_t *released)
+{
+	MDB_txn *txn;
+	MDB_shrink_pos pos;
+	pgno_t before = 0, target, last = 0, dropped;
+#ifndef _WIN32
+	mdb_size_t fsize = 0;
+#endif
+	unsigned moved;
+	int rc, done, active = 0, quiet = 0, flushed = 0;
+
+	if (!env || !max_pages || !env->me_map)
+		return EINVAL;
+	if (env->me_flags & MDB_RDONLY)
+		return EACCES;
+	if (released)
+		*released = 0;
+	memset(&pos, 0, sizeof(pos));
+
+	for (;;) {
+		if ((rc = mdb_txn_begin(env, NULL, 0, &txn)) != 0)
+			return rc;
+		if (!before)
+			before = txn->mt_next_pgno;
+		if ((rc = mdb_shrink_step(txn, max_pages, quiet ? NULL : &pos,
+			&target, &moved, &dropped, &done)) != 0)
+			goto fail;
+		if (moved)
+			active = 1;
+		if (!quiet) {
+			/* After a pass that moved nothing, only the pages freed
+			 * by the moves are left to drop
+			 */
+			if (done) {
+				quiet = !active;
+				active = 0;
+				last = target;
+			}
+		} else if (target < last) {
+			/* More pages became reusable, some may be moved */
+			quiet = 0;
+			flushed = 0;
+		} else if (dropped) {
+			flushed = 0;
+		} else {
+			/* The pages the last txn freed are reusable after one
+			 * more commit, unless a reader still uses them
+			 */
+			if (flushed || mdb_find_oldest(txn) < txn->mt_txnid - 1)
+				break;
+			flushed = 1;
+		}
+		txn->mt_flags |= MDB_TXN_DIRTY;
+		if ((rc = mdb_txn_commit(txn)) != 0)
+			return rc;
+	}
+
+	/* The pages at the end belong to no tree of a meta page. Holding
+	 * the writer lock, no other writer is extending the file.
+	 * Windows refuses to cut a file below a mapped view of it.
+	 */
+	if (released && before > txn->mt_next_pgno)
+		*released = before - txn->mt_next_pgno;
+#ifndef _WIN32
+	if (!(env->me_flags & MDB_WRITEMAP) &&
+		!(rc = mdb_env_async_wait(env)) &&
+		!(rc = mdb_fsize(env->me_fd, &fsize)) &&
+		fsize > (mdb_size_t)txn->mt_next_pgno * env->me_psize) {
+		if (ftruncate(env->me_fd,
+			(off_t)txn->mt_next_pgno * env->me_psize) != 0)
+			rc = ErrCode();
+	}
+#endif
+
+fail:
+	mdb_txn_abort(txn);
+	return rc;
+}
+
+/** @defgroup bulk Bulk build
+ *	Bottom-up construction of a database from sorted input.
+ *	Pages are packed in key order and written behind the last used page,
+ *	directly to the file (or the map with #MDB_WRITEMAP) instead of the
+ *	dirty list, without a tree descent per key.
+ *	@{
+ */
+
+	/** A level of the tree being built, 0 = leaves */
+typedef struct MDB_build_level {
+	char		*ml_buf;	/**< two pages and a key */
+	MDB_page	*ml_cur;	/**< page being filled */
+	/** last closed branch page, not written yet: if #ml_cur ends up
+	 *	with a single node, it gets one from here (or is merged into it)
+	 */
+	MDB_page	*ml_prev;
+	int			 ml_pending;	/**< #ml_prev is not written yet */
+	MDB_val		 ml_first;	/**< lowest key below #ml_cur */
+} MDB_build_level;
+
+	/** State of a bulk build, see #mdb_build_begin() */
+struct MDB_build {
+	/** for #mdb_node_add(), mc_pg[0] is set to the page of a level */
+	MDB_cursor	 mb_cursor;
+	MDB_db		 mb_db;		/**< the tree built so far */
+	unsigned int mb_fill;	/**< max. bytes of nodes per page */
+	int			 mb_top;	/**< highest level with a page, -1 if none */
+	int			 mb_error;	/**< sticky error, the build is unusable */
+	pgno_t		 mb_pgno;	/**< first page of the current run */
+	pgno_t		 mb_npages;	/**< number of pages in the current run */
+	/** (first page, number of pages) of earlier runs, when the txn
+	 *	allocated pages between those of the build, or NULL
+	 */
+	MDB_IDL		 mb_runs;
+	char		*mb_wbuf;	/**< write buffer, NULL with #MDB_WRITEMAP */
+	size_t		 mb_wlen;	/**< bytes in #mb_wbuf */
+	lmdb_off_t	 mb_wpos;	/**< file offset of #mb_wbuf */
+	MDB_build_level mb_lvl[CURSOR_STACK];
+};
+
+	/** Write size bytes at file offset pos, combining adjacent writes. */
+static int
+mdb_build_emit(MDB_build *mb, const void *ptr, size_t size, lmdb_off_t pos)
+{
+	MDB_env *env = mb->mb_cursor.mc_txn->mt_env;
+	lmdb_off_t end = mb->mb_wpos + mb->mb_wlen;
+	int rc;
+
+	if (!mb->mb_wbuf) {
+		memcpy(env->me_map + pos, ptr, size);
+		/* not in the dirty list, #mdb_env_sync_txn() must see them */
+		if (env->me_sync_pgs && mdb_midl_append_range(&env->me_sync_pgs,
+			pos / env->me_psize,
+			(unsigned)((pos % env->me_psize + size + env->me_psize - 1) /
+			env->me_psize))) {
+			mdb_midl_free(env->me_sync_pgs);
+			env->me_sync_pgs = NULL;
+		}
+		return MDB_SUCCESS;
+	}
+	/* small gaps are the unused tails of overflow pages */
+	if (!mb->mb_wlen || pos < end || (size_t)(pos - end) >= env->me_psize ||
+		mb->mb_wlen + (size_t)(pos - end) + size > MDB_WBUF) {
+		if (mb->mb_wlen &&
+			(rc = mdb_fd_pwrite(env->me_fd, mb->mb_wbuf, mb->mb_wlen,
+			mb->mb_wpos)))
+			return rc;
+		mb->mb_wpos = end = pos;
+		mb->mb_wlen = 0;
+		if (size > MDB_WBUF)
+			return mdb_fd_pwrite(env->me_fd, ptr, size, pos);
+	}
+	memset(mb->mb_wbuf + mb->mb_wlen, 0, pos - end);
+	memcpy(mb->mb_wbuf + (pos - mb->mb_wpos), ptr, size);
+	mb->mb_wlen = pos - mb->mb_wpos + size;
+	return MDB_SUCCESS;
+}
+
+	/** Allocate num pages behind the last used page. */
+static int
+mdb_build_alloc(MDB_build *mb, int num, pgno_t *pgno)
+{
+	MDB_txn *txn = mb->mb_cursor.mc_txn;
+
+	if (txn->mt_next_pgno + num >= txn->mt_env->me_maxpg)
+		return MDB_MAP_FULL;
+	if (mb->mb_npages && txn->mt_next_pgno != mb->mb_pgno + mb->mb_npages) {
+		/* other pages were allocated meanwhile, start a new run */
+		if (!mb->mb_runs && !(mb->mb_runs = mdb_midl_alloc(MDB_IDL_UM_MAX)))
+			return ENOMEM;
+		if (mdb_midl_append(&mb->mb_runs, mb->mb_pgno) ||
+			mdb_midl_append(&mb->mb_runs, mb->mb_npages))
+			return ENOMEM;
+		mb->mb_npages = 0;
+	}
+	if (!mb->mb_npages)
+		mb->mb_pgno = txn->mt_next_pgno;
+	*pgno = txn->mt_next_pgno;
+	txn->mt_next_pgno += num;
+	mb->mb_npages += num;
+	return MDB_SUCCESS;
+}
+
+static void
+mdb_build_page_init(MDB_env *env, MDB_page *mp, uint16_t flags)
+{
+	mp->mp_pgno = 0;
+	mp->mp_pad = 0;
+	mp->mp_flags = flags;
+	mp->mp_lower = PAGEHDRSZ-PAGEBASE;
+	mp->mp_upper = env->me_psize - PAGEBASE;
+}
+
+	/** Assign a page number to the page of level lvl and write it.
+	 *	Branch pages are only written with the next page of their level.
+	 */
+static int
+mdb_build_close(MDB_build *mb, int lvl, pgno_t *pgno)
+{
+	MDB_env *env = mb->mb_cursor.mc_txn->mt_env;
+	MDB_build_level *ml = &mb->mb_lvl[lvl];
+	MDB_page *mp = ml->ml_cur;
+	int rc;
+
+	if ((rc = mdb_build_alloc(mb, 1, pgno)))
+		return rc;
+	mp->mp_pgno = *pgno;
+	memset((char *)mp + PAGEBASE + mp->mp_lower, 0, SIZELEFT(mp));
+	if (IS_LEAF(mp)) {
+		mb->mb_db.md_leaf_pages++;
+		return mdb_build_emit(mb, mp, env->me_psize,
+			(lmdb_off_t)mp->mp_pgno * env->me_psize);
+	}
+	mb->mb_db.md_branch_pages++;
+	if (ml->ml_pending && (rc = mdb_build_emit(mb, ml->ml_prev,
+		env->me_psize, (lmdb_off_t)ml->ml_prev->mp_pgno * env->me_psize)))
+		return rc;
+	ml->ml_cur = ml->ml_prev;
+	ml->ml_prev = mp;
+	ml->ml_pending = 1;
+	mdb_build_page_init(env, ml->ml_cur, P_BRANCH);
+	return MDB_SUCCESS;
+}
+
+	/** Add a node to the page of level lvl, closing it if it is full.
+	 *	For branch levels, data is NULL and pgno is the child page.
+	 */
+static int
+mdb_build_add(MDB_build *mb, int lvl, MDB_val *key, MDB_val *data,
+	pgno_t pgno)
+{
+	MDB_env *env = mb->mb_cursor.mc_txn->mt_env;
+	MDB_build_level *ml;
+	MDB_page *mp, *ovp;
+	MDB_val big;
+	pgno_t pg;
+	size_t nsz;
+	unsigned int flags = 0, minkeys = lvl ? 2 : 1;
+	int rc, ovpages;
+
+	if (lvl >= CURSOR_STACK)
+		return MDB_CURSOR_FULL;
+	ml = &mb->mb_lvl[lvl];
+	if (lvl > mb->mb_top) {
+		if ((ml->ml_buf = malloc(2 * env->me_psize + ENV_MAXKEY(env))) == NULL)
+			return ENOMEM;
+		ml->ml_cur = (MDB_page *)ml->ml_buf;
+		ml->ml_prev = (MDB_page *)(ml->ml_buf + env->me_psize);
+		ml->ml_first.mv_data = ml->ml_buf + 2 * env->me_psize;
+		mdb_build_page_init(env, ml->ml_cur, lvl ? P_BRANCH : P_LEAF);
+		mb->mb_top = lvl;
+	}
+	mp = ml->ml_cur;
+
+	/* same sizes as in mdb_node_add(), the first key of a branch is empty */
+	if (lvl)
+		nsz = NUMKEYS(mp) ? EVEN(INDXSIZE(key)) : EVEN(NODESIZE);
+	else if (LEAFSIZE(key, data) > env->me_nodemax)
+		nsz = EVEN(NODESIZE + key->mv_size + sizeof(pgno_t));
+	else
+		nsz = EVEN(LEAFSIZE(key, data));
+	nsz += sizeof(indx_t);
+	if (NUMKEYS(mp) && (nsz > SIZELEFT(mp) || (NUMKEYS(mp) >= minkeys &&
+		env->me_psize - PAGEHDRSZ - SIZELEFT(mp) + nsz > mb->mb_fill))) {
+		if ((rc = mdb_build_close(mb, lvl, &pg)))
+			return rc;
+		/* its lowest key separates it from its left sibling */
+		if ((rc = mdb_build_add(mb, lvl + 1, &ml->ml_first, NULL, pg)))
+			return rc;
+		mp = ml->ml_cur;
+		if (!lvl)
+			mdb_build_page_init(env, mp, P_LEAF);
+	}
+
+	if (!NUMKEYS(mp)) {
+		ml->ml_first.mv_size = key->mv_size;
+		memcpy(ml->ml_first.mv_data, key->mv_data, key->mv_size);
+	}
+
+	if (!lvl && LEAFSIZE(key, data) > env->me_nodemax) {
+		ovpages = OVPAGES(data->mv_size, env->me_psize);
+		if ((rc = mdb_build_alloc(mb, ovpages, &pg)))
+			return rc;
+		ovp = ml->ml_prev;	/* unused for leaves */
+		memset(ovp, 0, PAGEHDRSZ);
+		ovp->mp_pgno = pg;
+		ovp->mp_flags = P_OVERFLOW;
+		ovp->mp_pages = ovpages;
+		if ((rc = mdb_build_emit(mb, ovp, PAGEHDRSZ,
+				(lmdb_off_t)pg * env->me_psize)) ||
+			(rc = mdb_build_emit(mb, data->mv_data, data->mv_size,
+				(lmdb_off_t)pg * env->me_psize + PAGEHDRSZ)))
+			return rc;
+		mb->mb_db.md_overflow_pages += ovpages;
+		big.mv_size = data->mv_size;
+		big.mv_data = &pg;
+		data = &big;
+		flags = F_BIGDATA;
+	}
+
+	mb->mb_cursor.mc_pg[0] = mp;
+	return mdb_node_add(&mb->mb_cursor, NUMKEYS(mp),
+		lvl && !NUMKEYS(mp) ? NULL : key, data, pgno, flags);
+}
+
+	/** Give the single node of the last branch page of a level a
+	 *	sibling: take the last node of the previous page, or merge into it.
+	 */
+static int
+mdb_build_fixup(MDB_build *mb, int lvl)
+{
+	MDB_env *env = mb->mb_cursor.mc_txn->mt_env;
+	MDB_build_level *ml = &mb->mb_lvl[lvl];
+	MDB_page *prev = ml->ml_prev, *mp = ml->ml_cur;
+	MDB_node *node;
+	MDB_val key;
+	pgno_t child = NODEPGNO(NODEPTR(mp, 0)), moved;
+	unsigned int n = NUMKEYS(prev);
+	int rc;
 
-	w3 = txn->mt_next_pgno * env->me_psize;
-	{
-		mdb_size_t fsize = 0;
-		if ((rc = mdb_fsize(env->me_fd, &fsize)))
-			goto leave;
-		if (w3 > fsize)
-			w3 = fsize;
+	if (n <= MDB_MINKEYS) {
+		mb->mb_cursor.mc_pg[0] = prev;
+		if ((rc = mdb_node_add(&mb->mb_cursor, n, &ml->ml_first, NULL, child, 0)))
+			return rc;
+		mdb_build_page_init(env, mp, P_BRANCH);
+		return MDB_SUCCESS;
 	}
-	wsize = w3 - wsize;
-	while (wsize > 0) {
-		if (wsize > MAX_WRITE)
-			w2 = MAX_WRITE;
-		else
-			w2 = wsize;
-		DO_WRITE(rc, fd, ptr, w2, len);
-		if (!rc) {
-			rc = ErrCode();
-			break;
-		} else if (len > 0) {
-			rc = MDB_SUCCESS;
-			ptr += len;
-			wsize -= len;
-			continue;
-		} else {
-			rc = EIO;
-			break;
+
+	node = NODEPTR(prev, n - 1);
+	key.mv_size = NODEKSZ(node);
+	key.mv_data = NODEKEY(node);
+	moved = NODEPGNO(node);
+	mdb_build_page_init(env, mp, P_BRANCH);
+	mb->mb_cursor.mc_pg[0] = mp;
+	if ((rc = mdb_node_add(&mb->mb_cursor, 0, NULL, NULL, moved, 0)) ||
+		(rc = mdb_node_add(&mb->mb_cursor, 1, &ml->ml_first, NULL, child, 0)))
+		return rc;
+	ml->ml_first.mv_size = key.mv_size;
+	memcpy(ml->ml_first.mv_data, key.mv_data, key.mv_size);
+	/* nodes were added in order, the last one is lowest in the page */
+	prev->mp_lower -= sizeof(indx_t);
+	prev->mp_upper += EVEN(NODESIZE + key.mv_size);
+	return MDB_SUCCESS;
+}
+
+	/** Close the pages of all levels, bottom up. */
+static int
+mdb_build_finish(MDB_build *mb)
+{
+	MDB_env *env = mb->mb_cursor.mc_txn->mt_env;
+	MDB_build_level *ml;
+	pgno_t pg;
+	int lvl, rc;
+
+	for (lvl = 0; lvl <= mb->mb_top; lvl++) {
+		ml = &mb->mb_lvl[lvl];
+		if (lvl && NUMKEYS(ml->ml_cur) == 1) {
+			if (!ml->ml_pending) {
+				/* the top level has a single child: that's the root */
+				mb->mb_db.md_root = NODEPGNO(NODEPTR(ml->ml_cur, 0));
+				mb->mb_db.md_depth = lvl;
+				return MDB_SUCCESS;
+			}
+			if ((rc = mdb_build_fixup(mb, lvl)))
+				return rc;
+		}
+		if (NUMKEYS(ml->ml_cur)) {
+			if ((rc = mdb_build_close(mb, lvl, &pg)))
+				return rc;
+			if (lvl == mb->mb_top) {
+				mb->mb_db.md_root = pg;
+				mb->mb_db.md_depth = lvl + 1;
+			} else if ((rc = mdb_build_add(mb, lvl + 1, &ml->ml_first, NULL, pg))) {
+				return rc;
+			}
+		}
+		if (ml->ml_pending) {
+			if ((rc = mdb_build_emit(mb, ml->ml_prev, env->me_psize,
+				(lmdb_off_t)ml->ml_prev->mp_pgno * env->me_psize)))
+				return rc;
+			ml->ml_pending = 0;
 		}
 	}
-
-leave:
-	mdb_txn_abort(txn);
-	return rc;
+	return MDB_SUCCESS;
 }
 
-int ESECT
-mdb_env_copyfd2(MDB_env *env, HANDLE fd, unsigned int flags)
+int
+mdb_build_begin(MDB_txn *txn, MDB_dbi dbi, unsigned int fill, MDB_build **ret)
 {
-	if (flags & MDB_CP_COMPACT)
-		return mdb_env_copyfd1(env, fd);
-	else
-		return mdb_env_copyfd0(env, fd);
+	MDB_env *env;
+	MDB_build *mb;
+
+	if (!ret || fill > 100 || !TXN_DBI_EXIST(txn, dbi, DB_USRVALID))
+		return EINVAL;
+
+	if (txn->mt_flags & (MDB_TXN_RDONLY|MDB_TXN_BLOCKED))
+		return (txn->mt_flags & MDB_TXN_RDONLY) ? EACCES : MDB_BAD_TXN;
+
+	if (txn->mt_dbs[dbi].md_flags & MDB_DUPSORT)
+		return MDB_INCOMPATIBLE;
+
+	env = txn->mt_env;
+	if ((mb = calloc(1, sizeof(MDB_build))) == NULL)
+		return ENOMEM;
+	mdb_cursor_init(&mb->mb_cursor, txn, dbi, NULL);
+	if (mb->mb_cursor.mc_db->md_root != P_INVALID) {
+		free(mb);
+		return MDB_INCOMPATIBLE;
+	}
+	if (!(env->me_flags & MDB_WRITEMAP) &&
+		(mb->mb_wbuf = malloc(MDB_WBUF)) == NULL) {
+		free(mb);
+		return ENOMEM;
+	}
+	mb->mb_cursor.mc_snum = 1;
+	mb->mb_fill = (env->me_psize - PAGEHDRSZ) * (fill ? fill : 100) / 100;
+	mb->mb_top = -1;
+	mb->mb_db = *mb->mb_cursor.mc_db;
+	mb->mb_pgno = txn->mt_next_pgno;
+	*ret = mb;
+	return MDB_SUCCESS;
 }
 
-int ESECT
-mdb_env_copyfd(MDB_env *env, HANDLE fd)
+int
+mdb_build_put(MDB_build *mb, MDB_val *key, MDB_val *data)
 {
-	return mdb_env_copyfd2(env, fd, 0);
+	MDB_page *mp;
+	MDB_node *node;
+	MDB_val last;
+	int rc;
+
+	if (!mb || !key || !data)
+		return EINVAL;
+	if (mb->mb_error)
+		return mb->mb_error;
+	if (mb->mb_cursor.mc_txn->mt_flags & MDB_TXN_BLOCKED)
+		return MDB_BAD_TXN;
+
+	if (key->mv_size-1 >= ENV_MAXKEY(mb->mb_cursor.mc_txn->mt_env))
+		return MDB_BAD_VALSIZE;
+#if SIZE_MAX > MAXDATASIZE
+	if (data->mv_size > MAXDATASIZE)
+		return MDB_BAD_VALSIZE;
+#endif
+
+	/* like MDB_APPEND: keys have to be ascending */
+	if (mb->mb_top >= 0) {
+		mp = mb->mb_lvl[0].ml_cur;
+		node = NODEPTR(mp, NUMKEYS(mp) - 1);
+		last.mv_size = NODEKSZ(node);
+		last.mv_data = NODEKEY(node);
+		if (mb->mb_cursor.mc_dbx->md_cmp(key, &last) <= 0)
+			return MDB_KEYEXIST;
+	}
+
+	if ((rc = mdb_build_add(mb, 0, key, data, 0))) {
+		mb->mb_error = rc;
+		return rc;
+	}
+	mb->mb_db.md_entries++;
+	return MDB_SUCCESS;
 }
 
-int ESECT
-mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags)
+int
+mdb_build_end(MDB_build *mb)
 {
+	MDB_txn *txn;
+	MDB_db *db;
 	int rc;
-	MDB_name fname;
-	HANDLE newfd = INVALID_HANDLE_VALUE;
 
-	rc = mdb_fname_init(path, env->me_flags | MDB_NOLOCK, &fname);
-	if (rc == MDB_SUCCESS) {
-		rc = mdb_fopen(env, &fname, MDB_O_COPY, 0666, &newfd);
-		mdb_fname_destroy(fname);
-	}
-	if (rc == MDB_SUCCESS) {
-		rc = mdb_env_copyfd2(env, newfd, flags);
-		if (close(newfd) < 0 && rc == MDB_SUCCESS)
-			rc = ErrCode();
+	if (!mb)
+		return EINVAL;
+
+	txn = mb->mb_cursor.mc_txn;
+	db = mb->mb_cursor.mc_db;
+	rc = mb->mb_error;
+	if (!rc && (txn->mt_flags & MDB_TXN_BLOCKED))
+		rc = MDB_BAD_TXN;
+	if (!rc && db->md_root != P_INVALID)	/* written to meanwhile */
+		rc = MDB_INCOMPATIBLE;
+	if (!rc)
+		rc = mdb_build_finish(mb);
+	if (!rc && mb->mb_wlen)
+		rc = mdb_fd_pwrite(txn->mt_env->me_fd, mb->mb_wbuf, mb->mb_wlen,
+			mb->mb_wpos);
+	if (!rc && mb->mb_db.md_entries) {
+		db->md_depth = mb->mb_db.md_depth;
+		db->md_branch_pages = mb->mb_db.md_branch_pages;
+		db->md_leaf_pages = mb->mb_db.md_leaf_pages;
+		db->md_overflow_pages = mb->mb_db.md_overflow_pages;
+		db->md_entries = mb->mb_db.md_entries;
+		db->md_root = mb->mb_db.md_root;
+		*mb->mb_cursor.mc_dbflag |= DB_DIRTY;
+		txn->mt_flags |= MDB_TXN_DIRTY;
+#ifdef MDB_VL32
+		if (txn->mt_next_pgno - 1 > txn->mt_last_pgno)
+			txn->mt_last_pgno = txn->mt_next_pgno - 1;
+#endif
+		mb->mb_npages = 0;	/* in use now */
+		mdb_midl_free(mb->mb_runs);
+		mb->mb_runs = NULL;
 	}
+	mdb_build_abort(mb);
 	return rc;
 }
 
-int ESECT
-mdb_env_copy(MDB_env *env, const char *path)
+void
+mdb_build_abort(MDB_build *mb)
 {
-	return mdb_env_copy2(env, path, 0);
+	MDB_txn *txn;
+	MDB_IDL runs;
+	unsigned i;
+	int lvl, rc = 0;
+
+	if (!mb)
+		return;
+	txn = mb->mb_cursor.mc_txn;
+	/* Give the pages back: the last run by lowering the end of the
+	 * used pages if nothing follows it, all others to the freelist
+	 */
+	if (mb->mb_npages) {
+		if (txn->mt_next_pgno == mb->mb_pgno + mb->mb_npages)
+			txn->mt_next_pgno = mb->mb_pgno;
+		else
+			rc = mdb_midl_append_range(&txn->mt_free_pgs, mb->mb_pgno,
+				mb->mb_npages);
+	}
+	if ((runs = mb->mb_runs) != NULL) {
+		for (i = 1; !rc && i < runs[0]; i += 2)
+			rc = mdb_midl_append_range(&txn->mt_free_pgs, runs[i], runs[i+1]);
+		mdb_midl_free(runs);
+	}
+	if (rc)		/* the pages would leak */
+		txn->mt_flags |= MDB_TXN_ERROR;
+	for (lvl = 0; lvl <= mb->mb_top; lvl++)
+		free(mb->mb_lvl[lvl].ml_buf);
+	free(mb->mb_wbuf);
+	free(mb);
 }
+/** @} */
 
 int ESECT
 mdb_env_set_flags(MDB_env *env, unsigned int flag, int onoff)
@@ -10525,6 +13956,16 @@ mdb_env_info(MDB_env *env, MDB_envinfo *arg)
 	return MDB_SUCCESS;
 }
 
+int ESECT
+mdb_env_spill_stat(MDB_env *env, MDB_spillstat *stat)
+{
+	if (env == NULL || stat == NULL)
+		return EINVAL;
+
+	*stat = env->me_spillstat;
+	return MDB_SUCCESS;
+}
+
 /** Set the default comparison functions for a database.
  * Called immediately after a database is opened to set the defaults.
  * The user can then override them with #mdb_set_compare() or
@@ -10646,6 +14087,7 @@ int mdb_dbi_open(MDB_txn *txn, const char *name, unsigned int flags, MDB_dbi *db
 		txn->mt_dbxs[slot].md_name.mv_data = namedup;
 		txn->mt_dbxs[slot].md_name.mv_size = len;
 		txn->mt_dbxs[slot].md_rel = NULL;
+		txn->mt_dbxs[slot].md_access = MDB_ACCESS_DEFAULT;
 		txn->mt_dbflags[slot] = dbflag;
 		/* txn-> and env-> are the same in read txns, use
 		 * tmp variable to avoid undefined assignment
@@ -10900,6 +14342,15 @@ int mdb_set_relctx(MDB_txn *txn, MDB_dbi dbi, void *ctx)
 	return MDB_SUCCESS;
 }
 
+int mdb_set_access(MDB_txn *txn, MDB_dbi dbi, unsigned int access)
+{
+	if (!TXN_DBI_EXIST(txn, dbi, DB_USRVALID) || access > MDB_ACCESS_SEQUENTIAL)
+		return EINVAL;
+
+	txn->mt_dbxs[dbi].md_access = access;
+	return MDB_SUCCESS;
+}
+
 int ESECT
 mdb_env_get_maxkeysize(MDB_env *env)
 {
@@ -10944,6 +14395,32 @@ mdb_reader_list(MDB_env *env, MDB_msg_func *func, void *ctx)
 	return rc;
 }
 
+int ESECT
+mdb_reader_each(MDB_env *env, MDB_reader_func *func, void *ctx)
+{
+	unsigned int i, rdrs;
+	MDB_reader *mr;
+	MDB_reader_info info;
+	int rc;
+
+	if (!env || !func)
+		return EINVAL;
+	if (!env->me_txns)
+		return MDB_SUCCESS;
+	rdrs = env->me_txns->mti_numreaders;
+	mr = env->me_txns->mti_readers;
+	for (i=0; i<rdrs; i++) {
+		if (mr[i].mr_pid) {
+			info.rd_txnid = mr[i].mr_txnid;
+			info.rd_pid = (int)mr[i].mr_pid;
+			info.rd_tid = (size_t)mr[i].mr_tid;
+			if ((rc = func(&info, ctx)) != 0)
+				return rc;
+		}
+	}
+	return MDB_SUCCESS;
+}
+
 /** Insert pid into list if not already present.
  * return -1 if already present.
  */
@@ -11047,6 +14524,292 @@ mdb_reader_check0(MDB_env *env, int rlocked, int *dead)
 	return rc;
 }
 
+#ifdef MDB_USE_REAPER
+/** @defgroup reaper	Background reader checks
+ *	A thread of the env started by #mdb_env_set_reaper() clears stale
+ *	reader slots with #mdb_reader_check0() at each interval. It then
+ *	reports readers too far behind the last committed txn, and releases
+ *	the snapshots of those its callback asks to evict: an evicted
+ *	reader's #mr_txnid is reset, so writers no longer keep the pages
+ *	freed after it. The reader's next get fails (#TXN_EVICTED()).
+ *	@{
+ */
+	/** What the last check saw in a reader slot */
+typedef struct MDB_reaper_slot {
+	MDB_PID_T	rs_pid;
+	MDB_THR_T	rs_tid;
+	txnid_t		rs_txnid;	/**< (txnid_t)-1 if the slot held no snapshot */
+	uint64_t	rs_since;	/**< when #rs_txnid was first seen, in ms */
+} MDB_reaper_slot;
+
+typedef struct MDB_reaper {
+	pthread_t		rp_thr;
+	pthread_mutex_t	rp_mutex;	/**< protects the fields below */
+	pthread_cond_t	rp_cond;	/**< signals setting changes and #rp_busy */
+	int				rp_stop;	/**< the thread is to exit */
+	int				rp_busy;	/**< a check is in progress */
+	unsigned		rp_interval;
+	mdb_size_t		rp_max_lag;
+	unsigned		rp_max_age;
+	MDB_reaper_func	*rp_func;
+	void			*rp_ctx;
+	/** Indexed like the reader table, only used by the thread */
+	MDB_reaper_slot	*rp_slots;
+} MDB_reaper;
+
+/** Milliseconds of a monotonic clock */
+static uint64_t
+mdb_reaper_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/** Check the reader table once.
+ * @param[in] env the environment handle
+ * @param[in] func the callback, or NULL to only clear stale slots
+ * @param[in] ctx its context
+ * @param[in] max_lag report readers lagging more txns, 0 for no limit
+ * @param[in] max_age report readers on a snapshot for this many ms,
+ *	0 for no limit
+ */
+static void
+mdb_env_reaper_check(MDB_env *env, MDB_reaper_func *func, void *ctx,
+	mdb_size_t max_lag, unsigned max_age)
+{
+	MDB_reaper_slot *rs = env->me_reaper->rp_slots;
+	MDB_reader *mr = env->me_txns->mti_readers;
+	MDB_reaper_info info;
+	MDB_txn *txn = NULL;
+	MDB_cursor *mc = NULL;
+	MDB_val key, data;
+	MDB_ID n;
+	txnid_t last, txnid;
+	uint64_t now, age;
+	unsigned int i, rdrs;
+	int rc;
+
+	mdb_reader_check0(env, 0, NULL);
+	now = mdb_reaper_now();
+	last = env->me_txns->mti_txnid;
+	rdrs = env->me_txns->mti_numreaders;
+	for (i=0; i<rdrs; i++) {
+		info.ri_pid = (int)mr[i].mr_pid;
+		info.ri_tid = (size_t)mr[i].mr_tid;
+		txnid = mr[i].mr_txnid;
+		if (!info.ri_pid || txnid == (txnid_t)-1 ||
+			(txn && txn->mt_u.reader == &mr[i])) {
+			rs[i].rs_txnid = (txnid_t)-1;
+			continue;
+		}
+		if (rs[i].rs_txnid != txnid || rs[i].rs_pid != mr[i].mr_pid ||
+			rs[i].rs_tid != mr[i].mr_tid) {
+			rs[i].rs_pid = mr[i].mr_pid;
+			rs[i].rs_tid = mr[i].mr_tid;
+			rs[i].rs_txnid = txnid;
+			rs[i].rs_since = now;
+		}
+		/* A reader of the last snapshot keeps no freed pages */
+		if (!func || txnid >= last)
+			continue;
+		age = now - rs[i].rs_since;
+		info.ri_txnid = txnid;
+		info.ri_lag = last - txnid;
+		info.ri_age = age > UINT_MAX ? UINT_MAX : (unsigned int)age;
+		if (!(max_lag && info.ri_lag > max_lag) &&
+			!(max_age && info.ri_age >= max_age))
+			continue;
+
+		/* Pages freed at or after the snapshot, from a txn of our own */
+		if (!txn && !mdb_txn_begin(env, NULL, MDB_RDONLY, &txn) &&
+			mdb_cursor_open(txn, FREE_DBI, &mc)) {
+			mdb_txn_abort(txn);
+			txn = NULL;
+		}
+		info.ri_pinned = 0;
+		if (mc) {
+			key.mv_size = sizeof(txnid);
+			key.mv_data = &txnid;
+			for (rc = mdb_cursor_get(mc, &key, &data, MDB_SET_RANGE); !rc;
+				rc = mdb_cursor_get(mc, &key, &data, MDB_NEXT)) {
+				memcpy(&n, data.mv_data, sizeof(n));
+				info.ri_pinned += n;
+			}
+		}
+
+		/* The reader may have moved on meanwhile, then it stays */
+		if (func(&info, ctx) &&
+			__sync_bool_compare_and_swap(&mr[i].mr_txnid, txnid, (txnid_t)-1)) {
+			DPRINTF(("evicted reader pid %u txn %"Yu,
+				(unsigned) info.ri_pid, txnid));
+			rs[i].rs_txnid = (txnid_t)-1;
+		}
+	}
+	if (txn) {
+		mdb_cursor_close(mc);
+		mdb_txn_abort(txn);
+	}
+}
+
+/** The background thread: check the readers at each interval. */
+static void *
+mdb_env_reaper_thr(void *arg)
+{
+	MDB_env *env = arg;
+	MDB_reaper *rp = env->me_reaper;
+	MDB_reaper_func *func;
+	void *ctx;
+	mdb_size_t max_lag;
+	unsigned max_age;
+	struct timespec ts;
+
+	pthread_mutex_lock(&rp->rp_mutex);
+	while (!rp->rp_stop) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += rp->rp_interval / 1000;
+		ts.tv_nsec += (long)(rp->rp_interval % 1000) * 1000000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		/* New settings restart the interval */
+		if (pthread_cond_timedwait(&rp->rp_cond, &rp->rp_mutex, &ts)
+			!= ETIMEDOUT || rp->rp_stop)
+			continue;
+		func = rp->rp_func;
+		ctx = rp->rp_ctx;
+		max_lag = rp->rp_max_lag;
+		max_age = rp->rp_max_age;
+		rp->rp_busy = 1;
+		pthread_mutex_unlock(&rp->rp_mutex);
+
+		mdb_env_reaper_check(env, func, ctx, max_lag, max_age);
+
+		pthread_mutex_lock(&rp->rp_mutex);
+		rp->rp_busy = 0;
+		pthread_cond_broadcast(&rp->rp_cond);
+	}
+	pthread_mutex_unlock(&rp->rp_mutex);
+	return NULL;
+}
+
+/** Keep the reaper from starting a check until #mdb_env_reaper_release().
+ *	Waits for a check in progress, whose txn would pin the map.
+ * @param[in] env the environment handle
+ */
+static void
+mdb_env_reaper_hold(MDB_env *env)
+{
+	MDB_reaper *rp = env->me_reaper;
+
+	if (!rp)
+		return;
+	pthread_mutex_lock(&rp->rp_mutex);
+	while (rp->rp_busy)
+		pthread_cond_wait(&rp->rp_cond, &rp->rp_mutex);
+}
+
+/** Let the reaper go on after #mdb_env_reaper_hold().
+ * @param[in] env the environment handle
+ */
+static void
+mdb_env_reaper_release(MDB_env *env)
+{
+	if (env->me_reaper)
+		pthread_mutex_unlock(&env->me_reaper->rp_mutex);
+}
+
+/** Stop the reaper thread, if any.
+ * @param[in] env the environment handle
+ */
+static void
+mdb_env_reaper_stop(MDB_env *env)
+{
+	MDB_reaper *rp = env->me_reaper;
+
+	if (!rp)
+		return;
+	pthread_mutex_lock(&rp->rp_mutex);
+	rp->rp_stop = 1;
+	pthread_cond_broadcast(&rp->rp_cond);
+	pthread_mutex_unlock(&rp->rp_mutex);
+	pthread_join(rp->rp_thr, NULL);
+	pthread_cond_destroy(&rp->rp_cond);
+	pthread_mutex_destroy(&rp->rp_mutex);
+	free(rp->rp_slots);
+	free(rp);
+	env->me_reaper = NULL;
+}
+/** @} */
+#endif	/* MDB_USE_REAPER */
+
+int ESECT
+mdb_env_set_reaper(MDB_env *env, unsigned int interval, mdb_size_t max_lag,
+	unsigned int max_age, MDB_reaper_func *func, void *ctx)
+{
+#ifdef MDB_USE_REAPER
+	MDB_reaper *rp;
+	int rc;
+
+	if (!env)
+		return EINVAL;
+	if (!interval) {
+		mdb_env_reaper_stop(env);
+		return MDB_SUCCESS;
+	}
+	if (!env->me_txns)
+		return EINVAL;
+
+	if ((rp = env->me_reaper) != NULL) {
+		/* Once we return, the old func is not called any more */
+		pthread_mutex_lock(&rp->rp_mutex);
+		while (rp->rp_busy)
+			pthread_cond_wait(&rp->rp_cond, &rp->rp_mutex);
+	} else {
+		if ((rp = calloc(1, sizeof(MDB_reaper))) == NULL)
+			return ENOMEM;
+		rp->rp_slots = calloc(env->me_maxreaders, sizeof(MDB_reaper_slot));
+		if (!rp->rp_slots) {
+			free(rp);
+			return ENOMEM;
+		}
+		if ((rc = pthread_mutex_init(&rp->rp_mutex, NULL)) != 0)
+			goto fail;
+		if ((rc = pthread_cond_init(&rp->rp_cond, NULL)) != 0) {
+			pthread_mutex_destroy(&rp->rp_mutex);
+			goto fail;
+		}
+		pthread_mutex_lock(&rp->rp_mutex);
+		env->me_reaper = rp;
+		if ((rc = pthread_create(&rp->rp_thr, NULL, mdb_env_reaper_thr, env))) {
+			env->me_reaper = NULL;
+			pthread_mutex_unlock(&rp->rp_mutex);
+			pthread_cond_destroy(&rp->rp_cond);
+			pthread_mutex_destroy(&rp->rp_mutex);
+			goto fail;
+		}
+	}
+	rp->rp_interval = interval;
+	rp->rp_max_lag = max_lag;
+	rp->rp_max_age = max_age;
+	rp->rp_func = func;
+	rp->rp_ctx = ctx;
+	pthread_cond_broadcast(&rp->rp_cond);
+	pthread_mutex_unlock(&rp->rp_mutex);
+	return MDB_SUCCESS;
+
+fail:
+	free(rp->rp_slots);
+	free(rp);
+	return rc;
+#else
+	(void) max_lag; (void) max_age; (void) func; (void) ctx;
+	return interval ? ENOSYS : MDB_SUCCESS;
+#endif
+}
+
 #ifdef MDB_ROBUST_SUPPORTED
 /** Handle #LOCK_MUTEX0() failure.
  * Try to repair the lock file if the mutex owner died.
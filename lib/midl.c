@@ -313,6 +313,205 @@ unsigned mdb_mid2l_search( MDB_ID2L ids, MDB_ID id )
 	return cursor;
 }
 
+	/** Hash index of an ID2L, followed by its slots. Linear probing,
+	 *	slots of an older generation are empty. Bumping the generation
+	 *	clears the index without touching the slots.
+	 */
+typedef struct MDB_ID2X {
+	unsigned	mx_mask;	/**< number of slots - 1 */
+	unsigned	mx_gen;		/**< current generation, never 0 */
+	int			mx_sorted;	/**< the ID2L is sorted */
+} MDB_ID2X;
+
+typedef struct MDB_ID2S {
+	unsigned	ms_idx;		/**< index into the ID2L */
+	unsigned	ms_gen;		/**< generation this slot was set in */
+} MDB_ID2S;
+
+#define ID2X(ids)	((MDB_ID2X *)(ids)[-1].mptr)
+#define ID2S(x)		((MDB_ID2S *)((x)+1))
+
+static unsigned mdb_mid2x_hash( MDB_ID id, unsigned mask )
+{
+	/* Fibonacci hashing, page numbers are often sequential */
+	return (unsigned)(((unsigned long long)id * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+	/** Allocate an index with at least 2*num slots */
+static MDB_ID2X *mdb_mid2x_alloc( unsigned num )
+{
+	MDB_ID2X *x;
+	unsigned slots = 64;
+	while (slots < num * 2)
+		slots <<= 1;
+	x = calloc(1, sizeof(MDB_ID2X) + slots * sizeof(MDB_ID2S));
+	if (x) {
+		x->mx_mask = slots - 1;
+		x->mx_gen = 1;
+		x->mx_sorted = 1;
+	}
+	return x;
+}
+
+MDB_ID2L mdb_mid2l_alloc(unsigned num)
+{
+	MDB_ID2L ids = malloc((num+2) * sizeof(MDB_ID2));
+	if (ids) {
+		ids->mid = num;	/* allocated length at ids[-1] */
+		ids->mptr = mdb_mid2x_alloc(num);
+		if (!ids->mptr) {
+			free(ids);
+			return NULL;
+		}
+		ids++;
+		ids->mid = 0;
+		ids->mptr = NULL;
+	}
+	return ids;
+}
+
+void mdb_mid2l_free(MDB_ID2L ids)
+{
+	if (ids) {
+		free(ids[-1].mptr);
+		free(ids-1);
+	}
+}
+
+int mdb_mid2l_need(MDB_ID2L *idp, unsigned num)
+{
+	MDB_ID2L ids = *idp;
+	MDB_ID2X *x = NULL;
+	MDB_ID len = ids[0].mid + num;
+	if (len > ids[-1].mid) {
+		len = (len + len/2 + (256 + 2)) & -256;
+		/* Keep the index at most half full */
+		if ((len - 2) * 2 > ID2X(ids)->mx_mask + 1 &&
+			!(x = mdb_mid2x_alloc(len - 2)))
+			return ENOMEM;
+		if (!(ids = realloc(ids-1, len * sizeof(MDB_ID2)))) {
+			free(x);
+			return ENOMEM;
+		}
+		ids->mid = len - 2;
+		*idp = ++ids;
+		if (x) {
+			free(ids[-1].mptr);
+			ids[-1].mptr = x;
+			mdb_mid2l_reindex(ids);
+		}
+	}
+	return 0;
+}
+
+unsigned mdb_mid2l_find( MDB_ID2L ids, MDB_ID id )
+{
+	MDB_ID2X *x = ID2X(ids);
+	MDB_ID2S *s = ID2S(x);
+	unsigned h = mdb_mid2x_hash(id, x->mx_mask);
+
+	for (; s[h].ms_gen == x->mx_gen; h = (h+1) & x->mx_mask) {
+		if (ids[s[h].ms_idx].mid == id)
+			return s[h].ms_idx;
+	}
+	return 0;
+}
+
+int mdb_mid2l_add( MDB_ID2L ids, MDB_ID2 *id )
+{
+	MDB_ID2X *x = ID2X(ids);
+	MDB_ID2S *s = ID2S(x);
+	unsigned h = mdb_mid2x_hash(id->mid, x->mx_mask), n;
+
+	for (; s[h].ms_gen == x->mx_gen; h = (h+1) & x->mx_mask) {
+		if (ids[s[h].ms_idx].mid == id->mid)
+			return -1;
+	}
+	if (ids[0].mid >= ids[-1].mid)
+		return -2;
+	n = ++ids[0].mid;
+	ids[n] = *id;
+	if (n > 1 && ids[n-1].mid > id->mid)
+		x->mx_sorted = 0;
+	s[h].ms_idx = n;
+	s[h].ms_gen = x->mx_gen;
+	return 0;
+}
+
+	/** Find the slot holding index i */
+static unsigned mdb_mid2x_slot( MDB_ID2L ids, unsigned i )
+{
+	MDB_ID2X *x = ID2X(ids);
+	MDB_ID2S *s = ID2S(x);
+	unsigned h = mdb_mid2x_hash(ids[i].mid, x->mx_mask);
+
+	while (s[h].ms_idx != i || s[h].ms_gen != x->mx_gen)
+		h = (h+1) & x->mx_mask;
+	return h;
+}
+
+void mdb_mid2l_delete( MDB_ID2L ids, unsigned i )
+{
+	MDB_ID2X *x = ID2X(ids);
+	MDB_ID2S *s = ID2S(x);
+	unsigned j = mdb_mid2x_slot(ids, i), k, h, n = ids[0].mid;
+
+	/* Backward shift: move later slots of the probe run into the hole
+	 * unless that would put them before their home slot.
+	 */
+	for (k = (j+1) & x->mx_mask; s[k].ms_gen == x->mx_gen;
+		k = (k+1) & x->mx_mask) {
+		h = mdb_mid2x_hash(ids[s[k].ms_idx].mid, x->mx_mask);
+		if (((k - h) & x->mx_mask) >= ((k - j) & x->mx_mask)) {
+			s[j] = s[k];
+			j = k;
+		}
+	}
+	s[j].ms_gen = 0;
+
+	if (i != n) {
+		s[mdb_mid2x_slot(ids, n)].ms_idx = i;
+		ids[i] = ids[n];
+		x->mx_sorted = 0;
+	}
+	ids[0].mid--;
+}
+
+static int mdb_mid2l_cmp( const void *a, const void *b )
+{
+	return CMP(((const MDB_ID2 *)a)->mid, ((const MDB_ID2 *)b)->mid);
+}
+
+void mdb_mid2l_sort( MDB_ID2L ids )
+{
+	if (!ID2X(ids)->mx_sorted) {
+		qsort(ids+1, ids[0].mid, sizeof(MDB_ID2), mdb_mid2l_cmp);
+		mdb_mid2l_reindex(ids);
+	}
+}
+
+void mdb_mid2l_reindex( MDB_ID2L ids )
+{
+	MDB_ID2X *x = ID2X(ids);
+	MDB_ID2S *s = ID2S(x);
+	unsigned i, h, n = ids[0].mid;
+
+	if (!++x->mx_gen) {
+		memset(s, 0, (x->mx_mask + 1) * sizeof(MDB_ID2S));
+		x->mx_gen = 1;
+	}
+	x->mx_sorted = 1;
+	for (i = 1; i <= n; i++) {
+		if (i > 1 && ids[i-1].mid > ids[i].mid)
+			x->mx_sorted = 0;
+		h = mdb_mid2x_hash(ids[i].mid, x->mx_mask);
+		while (s[h].ms_gen == x->mx_gen)
+			h = (h+1) & x->mx_mask;
+		s[h].ms_idx = i;
+		s[h].ms_gen = x->mx_gen;
+	}
+}
+
 int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id )
 {
 	unsigned x, i;
@@ -329,7 +528,7 @@ int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id )
 		return -1;
 	}
 
-	if ( ids[0].mid >= MDB_IDL_UM_MAX ) {
+	if ( ids[0].mid >= ids[-1].mid ) {
 		/* too big */
 		return -2;
 
@@ -347,7 +546,7 @@ int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id )
 int mdb_mid2l_append( MDB_ID2L ids, MDB_ID2 *id )
 {
 	/* Too big? */
-	if (ids[0].mid >= MDB_IDL_UM_MAX) {
+	if (ids[0].mid >= ids[-1].mid) {
 		return -2;
 	}
 	ids[0].mid++;
@@ -355,6 +554,139 @@ int mdb_mid2l_append( MDB_ID2L ids, MDB_ID2 *id )
 	return 0;
 }
 
+MDB_EXTL mdb_mext_alloc(int num)
+{
+	MDB_EXTL xl = malloc((num+2) * sizeof(MDB_EXT));
+	if (xl) {
+		xl->mx_id = num;	/* allocated length at xl[-1] */
+		xl->mx_len = 0;
+		xl++;
+		xl->mx_id = xl->mx_len = 0;
+	}
+	return xl;
+}
+
+void mdb_mext_free(MDB_EXTL xl)
+{
+	if (xl)
+		free(xl-1);
+}
+
+int mdb_mext_need(MDB_EXTL *xp, unsigned num)
+{
+	MDB_EXTL xl = *xp;
+	MDB_ID n = xl[0].mx_id + num;
+	if (n > xl[-1].mx_id) {
+		n = (n + n/4 + (256 + 2)) & -256;
+		if (!(xl = realloc(xl-1, n * sizeof(MDB_EXT))))
+			return ENOMEM;
+		xl->mx_id = n - 2;
+		*xp = ++xl;
+	}
+	return 0;
+}
+
+unsigned mdb_mext_search(MDB_EXTL xl, MDB_ID id)
+{
+	/* binary search of the first extent below id, in descending order */
+	unsigned base = 0, cursor, n = (unsigned)xl[0].mx_id;
+
+	while (0 < n) {
+		unsigned pivot = n >> 1;
+		cursor = base + pivot + 1;
+		if (xl[cursor].mx_id >= id) {
+			base = cursor;
+			n -= pivot + 1;
+		} else {
+			n = pivot;
+		}
+	}
+	return base + 1;
+}
+
+int mdb_mext_merge(MDB_EXTL *xp, MDB_IDL idl)
+{
+	MDB_EXTL xl;
+	MDB_EXT cur, ext;
+	MDB_ID i, j, k, runs = 0;
+
+	for (j = idl[0]; j; j--)
+		if (j == 1 || idl[j-1] != idl[j] + 1)
+			runs++;
+	if (mdb_mext_need(xp, (unsigned)runs))
+		return ENOMEM;
+	xl = *xp;
+
+	/* Merge from the lowest IDs, writing from the end of the room.
+	 * The current extent is written once the next one is not adjacent,
+	 * so k stays above the unread extents.
+	 */
+	i = xl[0].mx_id;
+	j = idl[0];
+	k = i + runs;
+	cur.mx_len = 0;
+	while (i || j) {
+		if (j && (!i || idl[j] < xl[i].mx_id)) {
+			ext.mx_id = idl[j];
+			ext.mx_len = 1;
+			while (--j && idl[j] == ext.mx_id + ext.mx_len)
+				ext.mx_len++;
+		} else {
+			ext = xl[i--];
+		}
+		if (cur.mx_len && cur.mx_id + cur.mx_len == ext.mx_id) {
+			cur.mx_len += ext.mx_len;
+		} else {
+			if (cur.mx_len)
+				xl[k--] = cur;
+			cur = ext;
+		}
+	}
+	if (cur.mx_len)
+		xl[k--] = cur;
+
+	i = xl[0].mx_id + runs - k;
+	if (k)
+		memmove(xl + 1, xl + k + 1, i * sizeof(MDB_EXT));
+	xl[0].mx_id = i;
+	xl[0].mx_len += idl[0];
+	return 0;
+}
+
+void mdb_mext_xinsert(MDB_EXTL xl, MDB_ID id, MDB_ID n)
+{
+	unsigned x = mdb_mext_search(xl, id), len = (unsigned)xl[0].mx_id;
+
+	xl[0].mx_len += n;
+	if (x <= len && xl[x].mx_id + xl[x].mx_len == id) {
+		/* extend the extent below, and join the one above */
+		xl[x].mx_len += n;
+		if (x > 1 && xl[x-1].mx_id == id + n) {
+			xl[x].mx_len += xl[x-1].mx_len;
+			memmove(xl + x - 1, xl + x, (len - x + 1) * sizeof(MDB_EXT));
+			xl[0].mx_id--;
+		}
+	} else if (x > 1 && xl[x-1].mx_id == id + n) {
+		xl[x-1].mx_id = id;
+		xl[x-1].mx_len += n;
+	} else {
+		memmove(xl + x + 1, xl + x, (len - x + 1) * sizeof(MDB_EXT));
+		xl[x].mx_id = id;
+		xl[x].mx_len = n;
+		xl[0].mx_id++;
+	}
+}
+
+void mdb_mext_take(MDB_EXTL xl, unsigned x, MDB_ID n)
+{
+	xl[0].mx_len -= n;
+	xl[x].mx_id += n;
+	if (!(xl[x].mx_len -= n)) {
+		MDB_ID len = xl[0].mx_id--;
+		memmove(xl + x, xl + x + 1, (len - x) * sizeof(MDB_EXT));
+	}
+}
+
 #ifdef MDB_VL32
 unsigned mdb_mid3l_search( MDB_ID3L ids, MDB_ID id )
 {
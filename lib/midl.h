@@ -160,6 +160,29 @@ typedef struct MDB_ID2 {
 	 */
 typedef MDB_ID2 *MDB_ID2L;
 
+	/** Allocate an ID2L.
+	 * Like IDLs, the allocated length is kept at ids[-1]. The ID2L
+	 * also gets a hash index of its IDs, at ids[-1].mptr, used by
+	 * #mdb_mid2l_find() and maintained by #mdb_mid2l_add() and
+	 * #mdb_mid2l_delete(). Other changes of the list must be followed
+	 * by #mdb_mid2l_reindex().
+	 * @param[in] num	Number of ID2s to make room for.
+	 * @return	ID2L on success, NULL on failure.
+	 */
+MDB_ID2L mdb_mid2l_alloc(unsigned num);
+
+	/** Free an ID2L allocated by #mdb_mid2l_alloc().
+	 * @param[in] ids	The ID2L to free.
+	 */
+void mdb_mid2l_free(MDB_ID2L ids);
+
+	/** Make room for num additional ID2s in an ID2L.
+	 * @param[in,out] idp	Address of the ID2L.
+	 * @param[in] num	Number of ID2s to make room for.
+	 * @return	0 on success, ENOMEM on failure.
+	 */
+int mdb_mid2l_need(MDB_ID2L *idp, unsigned num);
+
 	/** Search for an ID in an ID2L.
 	 * @param[in] ids	The ID2L to search.
 	 * @param[in] id	The ID to search for.
@@ -171,7 +194,8 @@ unsigned mdb_mid2l_search( MDB_ID2L ids, MDB_ID id );
 	/** Insert an ID2 into a ID2L.
 	 * @param[in,out] ids	The ID2L to insert into.
 	 * @param[in] id	The ID2 to insert.
-	 * @return	0 on success, -1 if the ID was already present in the ID2L.
+	 * @return	0 on success, -1 if the ID was already present in the ID2L,
+	 * -2 if the ID2L is full.
 	 */
 int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id );
 
@@ -182,6 +206,106 @@ int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id );
 	 */
 int mdb_mid2l_append( MDB_ID2L ids, MDB_ID2 *id );
 
+	/** Find an ID in an ID2L from #mdb_mid2l_alloc(), by hash.
+	 * The ID2L does not need to be sorted.
+	 * @param[in] ids	The ID2L to search.
+	 * @param[in] id	The ID to search for.
+	 * @return	The index of the ID2 with this ID, 0 if not found.
+	 */
+unsigned mdb_mid2l_find( MDB_ID2L ids, MDB_ID id );
+
+	/** Append an ID2 to an ID2L from #mdb_mid2l_alloc() and index it.
+	 * The ID2L stays sorted only if the ID is larger than the others.
+	 * @param[in,out] ids	The ID2L to append to.
+	 * @param[in] id	The ID2 to append.
+	 * @return	0 on success, -1 if the ID was already present in the ID2L,
+	 * -2 if the ID2L is full.
+	 */
+int mdb_mid2l_add( MDB_ID2L ids, MDB_ID2 *id );
+
+	/** Delete an ID2 from an ID2L from #mdb_mid2l_alloc().
+	 * The last ID2 takes its place, so the ID2L may become unsorted.
+	 * @param[in,out] ids	The ID2L.
+	 * @param[in] x	The index of the ID2 to delete.
+	 */
+void mdb_mid2l_delete( MDB_ID2L ids, unsigned x );
+
+	/** Sort an ID2L from #mdb_mid2l_alloc() if it isn't sorted.
+	 * @param[in,out] ids	The ID2L to sort.
+	 */
+void mdb_mid2l_sort( MDB_ID2L ids );
+
+	/** Rebuild the hash index of an ID2L from #mdb_mid2l_alloc(),
+	 * after the list was changed directly. Costs O(length).
+	 * @param[in,out] ids	The ID2L.
+	 */
+void mdb_mid2l_reindex( MDB_ID2L ids );
+
+	/** An extent is a run of consecutive IDs.
+	 */
+typedef struct MDB_EXT {
+	MDB_ID mx_id;	/**< The lowest ID */
+	MDB_ID mx_len;	/**< The number of IDs */
+} MDB_EXT;
+
+	/** An EXTL is an extent list, a sorted array of disjoint extents
+	 * which are not adjacent to each other, i.e. maximal runs. The
+	 * first element's \b mx_id member is a count of how many extents
+	 * are in the array, its \b mx_len member the total number of IDs.
+	 * Like IDLs the array is sorted in descending order by \b mx_id.
+	 */
+typedef MDB_EXT *MDB_EXTL;
+
+#define MDB_EXTL_SIZEOF(xl)		(((xl)[0].mx_id+1) * sizeof(MDB_EXT))
+
+	/** Allocate an EXTL.
+	 * @param[in] num	Number of extents to make room for.
+	 * @return	EXTL on success, NULL on failure.
+	 */
+MDB_EXTL mdb_mext_alloc(int num);
+
+	/** Free an EXTL.
+	 * @param[in] xl	The EXTL to free.
+	 */
+void mdb_mext_free(MDB_EXTL xl);
+
+	/** Make room for num additional extents in an EXTL.
+	 * @param[in,out] xp	Address of the EXTL.
+	 * @param[in] num	Number of extents to make room for.
+	 * @return	0 on success, ENOMEM on failure.
+	 */
+int mdb_mext_need(MDB_EXTL *xp, unsigned num);
+
+	/** Search for an ID in an EXTL.
+	 * @param[in] xl	The EXTL to search.
+	 * @param[in] id	The ID to search for.
+	 * @return	The index of the first extent starting below \b id.
+	 */
+unsigned mdb_mext_search(MDB_EXTL xl, MDB_ID id);
+
+	/** Merge an IDL into an EXTL, coalescing adjacent runs.
+	 * The IDs must not be in the EXTL yet.
+	 * @param[in,out] xp	Address of the EXTL to merge into.
+	 * @param[in] idl	The IDL to merge.
+	 * @return	0 on success, ENOMEM on failure.
+	 */
+int mdb_mext_merge(MDB_EXTL *xp, MDB_IDL idl);
+
+	/** Insert an ID range into an EXTL. The EXTL must have room for
+	 * one more extent and the IDs must not be in it yet.
+	 * @param[in,out] xl	The EXTL to insert into.
+	 * @param[in] id	The lowest ID to insert.
+	 * @param[in] n		Number of IDs to insert.
+	 */
+void mdb_mext_xinsert(MDB_EXTL xl, MDB_ID id, MDB_ID n);
+
+	/** Remove the lowest n IDs of the extent at index x.
+	 * @param[in,out] xl	The EXTL.
+	 * @param[in] x		Index of an extent with at least \b n IDs.
+	 * @param[in] n		Number of IDs to remove.
+	 */
+void mdb_mext_take(MDB_EXTL xl, unsigned x, MDB_ID n);
+
 #ifdef MDB_VL32
 typedef struct MDB_ID3 {
 	MDB_ID mid;		/**< The ID */
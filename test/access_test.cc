@@ -0,0 +1,215 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+std::string value(unsigned const i) {
+  return std::string(i % 50U == 0U ? 6'000U : 300U,
+                     static_cast<char>('a' + i % 26U));
+}
+
+// number of mappings of the file with the given VmFlags entry
+[[maybe_unused]] unsigned count_mappings(std::string const& file,
+                                         char const* vm_flag) {
+  auto smaps = std::ifstream{"/proc/self/smaps"};
+  auto n = 0U;
+  auto in_file = false;
+  for (auto line = std::string{}; std::getline(smaps, line);) {
+    if (line.find(" /") != std::string::npos ||
+        line.find(" [") != std::string::npos) {
+      in_file = line.find("/" + file) != std::string::npos &&
+                line.find(file + "-lock") == std::string::npos;
+    } else if (in_file && line.rfind("VmFlags:", 0U) == 0U &&
+               (line + " ").find(std::string{" "} + vm_flag + " ") !=
+                   std::string::npos) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+}  // namespace
+
+TEST_CASE("access pattern hints") {
+  std::remove("./ACCESS.mdb");
+  std::remove("./ACCESS.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_maxdbs(4U);
+  env.set_mapsize(256ULL << 20U);
+  env.open("./ACCESS.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  {
+    auto t = lmdb::txn{env};
+    auto lookup = t.dbi_open("lookup", lmdb::dbi_flags::CREATE);
+    auto scan = t.dbi_open("scan", lmdb::dbi_flags::CREATE);
+    for (auto i = 0U; i != 10'000U; ++i) {
+      t.put(lookup, i, value(i));
+    }
+    for (auto i = 0U; i != 10'000U; ++i) {
+      t.put(scan, i, value(i + 1U));
+    }
+    CHECK_THROWS_AS(t.set_access(lookup, static_cast<lmdb::access_pattern>(4)),
+                    std::system_error);
+    t.commit();
+  }
+
+  auto const read_all = [&]() {
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto lookup = t.dbi_open("lookup");
+    auto scan = t.dbi_open("scan");
+    for (auto i = 0U; i != 10'000U; ++i) {
+      REQUIRE(t.get(lookup, (i * 7'919U) % 10'000U) ==
+              value((i * 7'919U) % 10'000U));
+    }
+    auto c = lmdb::cursor{t, scan};
+    auto n = 0U;
+    for (auto el = c.get(lmdb::cursor_op::FIRST); el;
+         el = c.get(lmdb::cursor_op::NEXT)) {
+      auto key = 0U;
+      REQUIRE(el->first.size() == sizeof(key));
+      std::memcpy(&key, el->first.data(), sizeof(key));
+      REQUIRE(el->second == value(key + 1U));
+      ++n;
+    }
+    CHECK(n == 10'000U);
+  };
+
+  {
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    t.set_access(t.dbi_open("lookup"), lmdb::access_pattern::RANDOM);
+    t.set_access(t.dbi_open("scan"), lmdb::access_pattern::SEQUENTIAL);
+    t.commit();
+  }
+  read_all();
+#if defined(__linux__)
+  // "rr": MADV_RANDOM, "sr": MADV_SEQUENTIAL
+  CHECK(count_mappings("ACCESS.mdb", "rr") != 0U);
+  CHECK(count_mappings("ACCESS.mdb", "sr") != 0U);
+#endif
+
+  SUBCASE("cursor overrides the database") {
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto scan = t.dbi_open("scan");
+    auto c = lmdb::cursor{t, scan};
+    c.set_access(lmdb::access_pattern::NORMAL);
+    auto n = 0U;
+    for (auto el = c.get(lmdb::cursor_op::LAST); el;
+         el = c.get(lmdb::cursor_op::PREV)) {
+      ++n;
+    }
+    CHECK(n == 10'000U);
+  }
+
+  SUBCASE("map resize drops applied hints") {
+    env.set_mapsize(512ULL << 20U);
+    read_all();
+    {
+      auto t = lmdb::txn{env};
+      auto lookup = t.dbi_open("lookup");
+      for (auto i = 10'000U; i != 12'000U; ++i) {
+        t.put(lookup, i, value(i));
+      }
+      t.commit();
+    }
+    read_all();
+  }
+}
+
+TEST_CASE("access pattern hints on shared chunks") {
+  std::remove("./ACCESS_SHARED.mdb");
+  std::remove("./ACCESS_SHARED.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_maxdbs(4U);
+  env.set_mapsize(256ULL << 20U);
+  env.open("./ACCESS_SHARED.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  {  // interleaved, so the pages of both share the chunks
+    auto t = lmdb::txn{env};
+    auto lookup = t.dbi_open("lookup", lmdb::dbi_flags::CREATE);
+    auto scan = t.dbi_open("scan", lmdb::dbi_flags::CREATE);
+    for (auto i = 0U; i != 10'000U; ++i) {
+      t.put(lookup, i, value(i));
+      t.put(scan, i, value(i + 1U));
+    }
+    t.commit();
+  }
+
+  for (auto round = 0U; round != 3U; ++round) {
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto lookup = t.dbi_open("lookup");
+    auto scan = t.dbi_open("scan");
+    t.set_access(lookup, lmdb::access_pattern::RANDOM);
+    t.set_access(scan, lmdb::access_pattern::SEQUENTIAL);
+    auto c = lmdb::cursor{t, scan};
+    auto el = c.get(lmdb::cursor_op::FIRST);
+    for (auto i = 0U; i != 10'000U; ++i) {
+      REQUIRE(t.get(lookup, i) == value(i));
+      REQUIRE(el);
+      auto key = 0U;
+      std::memcpy(&key, el->first.data(), sizeof(key));
+      REQUIRE(el->second == value(key + 1U));
+      el = c.get(lmdb::cursor_op::NEXT);
+    }
+  }
+#if defined(__linux__)
+  // mixed chunks end up with the normal policy, not the last hint
+  CHECK(count_mappings("ACCESS_SHARED.mdb", "rr") == 0U);
+  CHECK(count_mappings("ACCESS_SHARED.mdb", "sr") == 0U);
+#endif
+}
+
+TEST_CASE("access pattern hints from reader threads") {
+  std::remove("./ACCESS_THREADS.mdb");
+  std::remove("./ACCESS_THREADS.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.open("./ACCESS_THREADS.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 10'000U; ++i) {
+      t.put(db, i, value(i));
+    }
+    t.commit();
+  }
+
+  auto counts = std::vector<unsigned>(8U);
+  auto threads = std::vector<std::thread>{};
+  for (auto i = 0U; i != counts.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+      auto db = t.dbi_open();
+      auto c = lmdb::cursor{t, db};
+      c.set_access(i % 2U == 0U ? lmdb::access_pattern::RANDOM
+                                : lmdb::access_pattern::SEQUENTIAL);
+      for (auto el = c.get(lmdb::cursor_op::FIRST); el;
+           el = c.get(lmdb::cursor_op::NEXT)) {
+        ++counts[i];
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  for (auto const n : counts) {
+    CHECK(n == 10'000U);
+  }
+#if defined(__linux__)
+  // every chunk was read with both hints
+  CHECK(count_mappings("ACCESS_THREADS.mdb", "rr") == 0U);
+  CHECK(count_mappings("ACCESS_THREADS.mdb", "sr") == 0U);
+#endif
+}
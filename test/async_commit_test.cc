@@ -0,0 +1,208 @@
+#include "doctest/doctest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+std::string value(unsigned const i) {
+  return std::string(i % 40U == 0U ? 5'000U : 200U,
+                     static_cast<char>('a' + i % 26U));
+}
+
+void check(lmdb::env& env, unsigned const n) {
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = t.dbi_open();
+  CHECK(db.stat().ms_entries == n);
+  for (auto i = 0U; i != n; ++i) {
+    REQUIRE(t.get(db, i) == value(i));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("async commit") {
+  std::remove("./ASYNC_COMMIT.mdb");
+  std::remove("./ASYNC_COMMIT.mdb-lock");
+
+  {
+    auto env = lmdb::env{};
+    env.set_mapsize(256ULL << 20U);
+    env.open("./ASYNC_COMMIT.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+    auto durable = std::vector<std::future<void>>{};
+    for (auto round = 0U; round != 50U; ++round) {
+      auto t = lmdb::txn{env};
+      auto db = t.dbi_open();
+      // builds on the previous commit even if it is not durable yet
+      CHECK(db.stat().ms_entries == round * 200U);
+      for (auto i = round * 200U; i != (round + 1U) * 200U; ++i) {
+        t.put(db, i, value(i));
+      }
+      if (round % 10U == 0U) {
+        t.del(db, round * 200U);  // frees pages while a commit is queued
+        t.put(db, round * 200U, value(round * 200U));
+      }
+      if (round == 25U) {
+        t.commit();  // a synchronous commit in between
+      } else {
+        durable.emplace_back(t.commit_async());
+      }
+    }
+    for (auto& f : durable) {
+      f.get();
+    }
+    check(env, 10'000U);
+
+    {  // nested txns commit into their parent synchronously
+      auto parent = lmdb::txn{env};
+      {
+        auto child = lmdb::txn{env, parent, lmdb::txn_flags::NONE};
+        auto db = child.dbi_open();
+        child.put(db, 10'000U, value(10'000U));
+        auto f = child.commit_async();
+        CHECK(f.wait_for(std::chrono::seconds{0}) ==
+              std::future_status::ready);
+        f.get();
+      }
+      auto db = parent.dbi_open();
+      CHECK(parent.get(db, 10'000U) == value(10'000U));
+    }  // aborted with the parent
+    {  // so do empty and read-only ones
+      auto empty = lmdb::txn{env};
+      auto f = empty.commit_async();
+      CHECK(f.wait_for(std::chrono::seconds{0}) == std::future_status::ready);
+      f.get();
+      auto ro = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+      ro.commit_async().get();
+    }
+
+    {
+      auto t = lmdb::txn{env};
+      auto db = t.dbi_open();
+      t.put(db, 10'000U, value(10'000U));
+      auto f = t.commit_async();
+      env.commit_wait();
+      CHECK(f.wait_for(std::chrono::seconds{0}) == std::future_status::ready);
+      check(env, 10'001U);
+    }
+    {  // the env waits for a queued commit before it closes
+      auto t = lmdb::txn{env};
+      auto db = t.dbi_open();
+      t.put(db, 10'001U, value(10'001U));
+      t.commit_async();
+    }
+  }
+
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.open("./ASYNC_COMMIT.mdb", lmdb::env_open_flags::NOSUBDIR);
+  check(env, 10'002U);
+}
+
+TEST_CASE("copy while an async commit is queued") {
+  std::remove("./ASYNC_COPY.mdb");
+  std::remove("./ASYNC_COPY.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.open("./ASYNC_COPY.mdb", lmdb::env_open_flags::NOSUBDIR);
+  for (auto round = 0U; round != 20U; ++round) {
+    {
+      auto t = lmdb::txn{env};
+      auto db = t.dbi_open();
+      for (auto i = round * 200U; i != (round + 1U) * 200U; ++i) {
+        t.put(db, i, value(i));
+      }
+      t.commit_async();
+    }
+    std::remove("./ASYNC_COPY_COPY.mdb");
+    env.copy("./ASYNC_COPY_COPY.mdb");
+
+    // both meta pages of the copy refer to copied pages only
+    auto copy = lmdb::env{};
+    copy.set_mapsize(256ULL << 20U);
+    copy.open("./ASYNC_COPY_COPY.mdb", lmdb::env_open_flags::NOSUBDIR |
+                                           lmdb::env_open_flags::RDONLY |
+                                           lmdb::env_open_flags::NOLOCK);
+    CHECK((copy.info().me_last_pgno + 1U) * copy.stat().ms_psize <=
+          std::filesystem::file_size("./ASYNC_COPY_COPY.mdb"));
+    check(copy, (round + 1U) * 200U);
+  }
+}
+
+TEST_CASE("async commit falls back with NOSYNC") {
+  std::remove("./ASYNC_NOSYNC.mdb");
+  std::remove("./ASYNC_NOSYNC.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(64ULL << 20U);
+  env.open("./ASYNC_NOSYNC.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOSYNC);
+  auto t = lmdb::txn{env};
+  auto db = t.dbi_open();
+  t.put(db, 0U, value(0U));
+  auto f = t.commit_async();
+  CHECK(f.wait_for(std::chrono::seconds{0}) == std::future_status::ready);
+  check(env, 1U);
+}
+
+TEST_CASE("async commit of a process that died") {
+#if !defined(_WIN32)
+  std::remove("./ASYNC_DIED.mdb");
+  std::remove("./ASYNC_DIED.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(64ULL << 20U);
+  env.open("./ASYNC_DIED.mdb", lmdb::env_open_flags::NOSUBDIR);
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    t.put(db, 0U, value(0U));
+    t.commit();
+  }
+
+  auto const pid = fork();
+  REQUIRE(pid != -1);
+  if (pid == 0) {  // exits while its commit may still be queued
+    auto child = lmdb::env{};
+    child.set_mapsize(64ULL << 20U);
+    child.open("./ASYNC_DIED.mdb", lmdb::env_open_flags::NOSUBDIR);
+    auto t = lmdb::txn{child};
+    auto db = t.dbi_open();
+    for (auto i = 1U; i != 1'000U; ++i) {
+      t.put(db, i, value(i));
+    }
+    t.commit_async();
+    _exit(0);
+  }
+  auto status = 0;
+  REQUIRE(waitpid(pid, &status, 0) == pid);
+  REQUIRE(WIFEXITED(status));
+
+  {  // does not wait for the dead process
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    auto const n = db.stat().ms_entries;
+    CHECK((n == 1U || n == 1'000U));
+    t.put(db, 1'000U, value(1'000U));
+    t.commit();
+  }
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = t.dbi_open();
+  CHECK(t.get(db, 0U) == value(0U));
+  CHECK(t.get(db, 1'000U) == value(1'000U));
+#endif
+}
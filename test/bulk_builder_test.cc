@@ -0,0 +1,221 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <string>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+std::string key(unsigned const i) {
+  auto s = std::to_string(i);
+  return "key" + std::string(10U - s.size(), '0') + s;
+}
+
+std::string value(unsigned const i) {
+  return std::string(i % 1'000U == 7U ? 10'000U : i % 50U, 'a' + i % 26U);
+}
+
+// checks order, count and contents of a database built from [0, n)
+bool check(lmdb::txn& txn, lmdb::txn::dbi& db, unsigned const n) {
+  if (db.stat().ms_entries != n) {
+    return false;
+  }
+  auto c = lmdb::cursor{txn, db};
+  auto i = 0U;
+  for (auto el = c.get(lmdb::cursor_op::FIRST); el;
+       el = c.get(lmdb::cursor_op::NEXT), ++i) {
+    if (i == n || el->first != key(i) || el->second != value(i)) {
+      return false;
+    }
+  }
+  for (auto j = 0U; j < n; j += 97U) {
+    if (txn.get(db, key(j)) != value(j)) {
+      return false;
+    }
+  }
+  return i == n && !txn.get(db, key(n)).has_value();
+}
+
+}  // namespace
+
+TEST_CASE("bulk_builder") {
+  std::remove("./BULK_BUILDER.mdb");
+  std::remove("./BULK_BUILDER.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(1ULL << 30U);
+  env.set_maxdbs(4U);
+  env.open("./BULK_BUILDER.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  SUBCASE("large tree") {
+    constexpr auto const n = 200'000U;
+    {
+      auto txn = lmdb::txn{env};
+      auto db = txn.dbi_open("bulk", lmdb::dbi_flags::CREATE);
+      auto b = lmdb::bulk_builder{txn, db};
+      for (auto i = 0U; i != n; ++i) {
+        b.put(key(i), value(i));
+      }
+      b.finish();
+      CHECK(check(txn, db, n));
+      txn.commit();
+    }
+
+    {
+      auto txn = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+      auto db = txn.dbi_open("bulk");
+      auto const stat = db.stat();
+      CHECK(stat.ms_depth == 3U);
+      CHECK(stat.ms_overflow_pages == 3U * (n / 1'000U));
+      CHECK(check(txn, db, n));
+    }
+
+    // the tree stays writable
+    {
+      auto txn = lmdb::txn{env};
+      auto db = txn.dbi_open("bulk");
+      for (auto i = 0U; i < n; i += 3U) {
+        txn.del(db, key(i));
+      }
+      txn.put(db, key(n), value(n));
+      txn.commit();
+    }
+    {
+      auto txn = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+      auto db = txn.dbi_open("bulk");
+      CHECK(db.stat().ms_entries == n - (n + 2U) / 3U + 1U);
+      CHECK(txn.get(db, key(n)) == value(n));
+      CHECK(!txn.get(db, key(3U)).has_value());
+      CHECK(txn.get(db, key(4U)) == value(4U));
+    }
+  }
+
+  SUBCASE("sizes and fill factors") {
+    auto failed = 0U;
+    for (auto const fill : {100U, 50U, 5U}) {
+      for (auto n = 0U; n < 3'000U; n += (n < 300U ? 1U : 37U)) {
+        auto txn = lmdb::txn{env};
+        auto db = txn.dbi_open("sizes", lmdb::dbi_flags::CREATE);
+        txn.dbi_clear(db);
+        auto b = lmdb::bulk_builder{txn, db, fill};
+        for (auto i = 0U; i != n; ++i) {
+          b.put(key(i), value(i));
+        }
+        b.finish();
+        failed += !check(txn, db, n);
+        txn.commit();
+      }
+    }
+    CHECK(failed == 0U);
+  }
+
+  SUBCASE("fill factor") {
+    auto const leaf_pages = [&](unsigned const fill) {
+      auto txn = lmdb::txn{env};
+      auto db = txn.dbi_open("fill", lmdb::dbi_flags::CREATE);
+      txn.dbi_clear(db);
+      auto b = lmdb::bulk_builder{txn, db, fill};
+      for (auto i = 0U; i != 10'000U; ++i) {
+        b.put(key(i), "x");
+      }
+      b.finish();
+      return db.stat().ms_leaf_pages;
+    };
+    auto const full = leaf_pages(100U);
+    auto const half = leaf_pages(50U);
+    CHECK(half >= 2U * full - 1U);
+    CHECK(half <= 2U * full + 1U);
+  }
+
+  SUBCASE("errors") {
+    auto txn = lmdb::txn{env};
+    auto db = txn.dbi_open("errors", lmdb::dbi_flags::CREATE);
+    txn.dbi_clear(db);
+
+    {
+      auto b = lmdb::bulk_builder{txn, db};
+      b.put(key(2U), "a");
+      CHECK_THROWS_AS(b.put(key(2U), "b"), std::system_error);
+      CHECK_THROWS_AS(b.put(key(1U), "b"), std::system_error);
+      b.put(key(3U), "c");
+      b.finish();
+    }
+    CHECK(txn.get(db, key(2U)) == "a");
+    CHECK(txn.get(db, key(3U)) == "c");
+
+    CHECK_THROWS_AS((lmdb::bulk_builder{txn, db}), std::system_error);
+
+    auto dups = txn.dbi_open("dups", lmdb::dbi_flags::CREATE |
+                                         lmdb::dbi_flags::DUPSORT);
+    CHECK_THROWS_AS((lmdb::bulk_builder{txn, dups}), std::system_error);
+  }
+
+  SUBCASE("abort gives pages back") {
+    auto const last_pgno = env.info().me_last_pgno;
+    {
+      auto txn = lmdb::txn{env};
+      auto db = txn.dbi_open("abort", lmdb::dbi_flags::CREATE);
+      {
+        auto b = lmdb::bulk_builder{txn, db};
+        for (auto i = 0U; i != 10'000U; ++i) {
+          b.put(key(i), value(i));
+        }
+      }
+      CHECK(db.stat().ms_entries == 0U);
+      txn.put(db, "x", "y");
+      txn.commit();
+    }
+    CHECK(env.info().me_last_pgno < last_pgno + 10U);
+  }
+
+  SUBCASE("abort after other writes frees pages") {
+    {
+      auto txn = lmdb::txn{env};
+      auto db = txn.dbi_open("abort", lmdb::dbi_flags::CREATE);
+      auto other = txn.dbi_open("other", lmdb::dbi_flags::CREATE);
+      {
+        auto b = lmdb::bulk_builder{txn, db};
+        for (auto i = 0U; i != 10'000U; ++i) {
+          b.put(key(i), value(i));
+          if (i % 2'000U == 0U) {  // pages between those of the build
+            txn.put(other, key(i), value(i + 7U));
+          }
+        }
+      }
+      txn.put(other, key(1U), value(1U));
+      txn.commit();
+    }
+    std::remove("./BULK_BUILDER_COPY.mdb");
+    CHECK_NOTHROW(env.copy("./BULK_BUILDER_COPY.mdb", {true, 1U}));
+
+    auto txn = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    CHECK(txn.dbi_open("abort").stat().ms_entries == 0U);
+    CHECK(txn.dbi_open("other").stat().ms_entries == 6U);
+  }
+}
+
+TEST_CASE("bulk_builder WRITEMAP") {
+  std::remove("./BULK_BUILDER_WRITEMAP.mdb");
+  std::remove("./BULK_BUILDER_WRITEMAP.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.open("./BULK_BUILDER_WRITEMAP.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::WRITEMAP);
+
+  {
+    auto txn = lmdb::txn{env};
+    auto db = txn.dbi_open();
+    auto b = lmdb::bulk_builder{txn, db, 80U};
+    for (auto i = 0U; i != 50'000U; ++i) {
+      b.put(key(i), value(i));
+    }
+    b.finish();
+    txn.commit();
+  }
+
+  auto txn = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = txn.dbi_open();
+  CHECK(check(txn, db, 50'000U));
+}
@@ -0,0 +1,141 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+using contents = std::vector<std::tuple<std::string, std::string, std::string>>;
+
+// (database name, key, value) of all entries
+contents dump(lmdb::env& env, std::vector<char const*> const& names) {
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto out = contents{};
+  for (auto const name : names) {
+    auto db = t.dbi_open(name);
+    auto c = lmdb::cursor{t, db};
+    for (auto el = c.get(lmdb::cursor_op::FIRST); el;
+         el = c.get(lmdb::cursor_op::NEXT)) {
+      out.emplace_back(name == nullptr ? "" : name, el->first, el->second);
+    }
+  }
+  return out;
+}
+
+lmdb::env open_copy(char const* path) {
+  auto env = lmdb::env{};
+  env.set_maxdbs(8U);
+  env.set_mapsize(256ULL << 20U);
+  env.open(path, lmdb::env_open_flags::NOSUBDIR);
+  return env;
+}
+
+// parallel copy == serial compacting copy, and the copy is writable
+void check_copy(lmdb::env& env, std::vector<char const*> const& names,
+                unsigned const threads) {
+  for (auto const path : {"./COPY_SERIAL.mdb", "./COPY_PARALLEL.mdb"}) {
+    std::remove(path);
+    std::remove((std::string{path} + "-lock").c_str());
+  }
+  env.copy("./COPY_SERIAL.mdb", {true, 1U});
+  env.copy("./COPY_PARALLEL.mdb", {true, threads});
+
+  auto serial = open_copy("./COPY_SERIAL.mdb");
+  auto parallel = open_copy("./COPY_PARALLEL.mdb");
+  auto const expected = dump(env, names);
+  CHECK(dump(parallel, names) == expected);
+  CHECK(parallel.info().me_last_pgno == serial.info().me_last_pgno);
+  CHECK(parallel.stat().ms_entries == env.stat().ms_entries);
+
+  for (auto const del : {false, true}) {
+    auto t = lmdb::txn{parallel};
+    auto db = t.dbi_open(names.front());
+    for (auto i = 0U; i != 1'000U; ++i) {
+      auto const key = "zz" + std::to_string(i);
+      if (del) {
+        t.del(db, key);
+      } else {
+        t.put(db, key, std::string(100U, 'n'));
+      }
+    }
+    t.commit();
+  }
+  CHECK(dump(parallel, names) == expected);
+}
+
+lmdb::env open_source(char const* path) {
+  std::remove(path);
+  std::remove((std::string{path} + "-lock").c_str());
+  return open_copy(path);
+}
+
+}  // namespace
+
+TEST_CASE("parallel compacting copy main database") {
+  auto env = open_source("./COPY_MAIN.mdb");
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 200'000U; ++i) {
+      t.put(db, "key" + std::to_string(i),
+            i % 1'000U == 0U ? std::string(10'000U, 'b') : std::to_string(i));
+    }
+    for (auto i = 0U; i < 200'000U; i += 3U) {  // leave free pages
+      t.del(db, "key" + std::to_string(i));
+    }
+    t.commit();
+  }
+  check_copy(env, {nullptr}, 4U);
+}
+
+TEST_CASE("parallel compacting copy named databases") {
+  auto env = open_source("./COPY_NAMED.mdb");
+  {
+    auto t = lmdb::txn{env};
+    auto a = t.dbi_open("a", lmdb::dbi_flags::CREATE);
+    for (auto i = 0U; i != 50'000U; ++i) {
+      t.put(a, i, std::to_string(i));
+    }
+
+    auto dups = t.dbi_open("dups", lmdb::dbi_flags::CREATE |
+                                       lmdb::dbi_flags::DUPSORT);
+    for (auto i = 0U; i != 200U; ++i) {
+      auto const key = "k" + std::to_string(i);
+      auto const n = i % 2U == 0U ? 500U : 2U;  // sub-DBs and sub-pages
+      for (auto j = 0U; j != n; ++j) {
+        t.put(dups, key, "dup" + std::to_string(j));
+      }
+    }
+
+    auto big = t.dbi_open("big", lmdb::dbi_flags::CREATE);
+    for (auto i = 0U; i != 100U; ++i) {
+      t.put(big, i, std::string(20'000U + i, static_cast<char>('a' + i % 26)));
+    }
+
+    t.dbi_open("empty", lmdb::dbi_flags::CREATE);
+    t.commit();
+  }
+
+  SUBCASE("few threads") { check_copy(env, {"a", "dups", "big", "empty"}, 2U); }
+  SUBCASE("many threads") {
+    check_copy(env, {"a", "dups", "big", "empty"}, 16U);
+  }
+}
+
+TEST_CASE("parallel compacting copy small and empty") {
+  auto env = open_source("./COPY_SMALL.mdb");
+  check_copy(env, {nullptr}, 4U);
+
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    t.put(db, "a", "b");
+    t.put(db, "big", std::string(10'000U, 'x'));
+    t.commit();
+  }
+  check_copy(env, {nullptr}, 4U);
+}
@@ -0,0 +1,144 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <system_error>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+// two values per leaf page
+std::string value(unsigned const i) {
+  return std::string(1'500U, static_cast<char>('a' + i % 26U));
+}
+
+void put(lmdb::txn& t, unsigned const from, unsigned const to) {
+  auto db = t.dbi_open();
+  for (auto i = from; i != to; ++i) {
+    t.put(db, i, value(i));
+  }
+}
+
+void check(lmdb::env& env, unsigned const n) {
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = t.dbi_open();
+  CHECK(db.stat().ms_entries == n);
+  for (auto i = 0U; i != n; ++i) {
+    REQUIRE(t.get(db, i) == value(i));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("max dirty pages") {
+  std::remove("./DIRTY_LIMIT.mdb");
+  std::remove("./DIRTY_LIMIT.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(512ULL << 20U);
+  env.set_max_dirty_pages(2'048U);  // also the initial dirty list size
+  env.open("./DIRTY_LIMIT.mdb", lmdb::env_open_flags::NOSUBDIR);
+  CHECK(env.get_max_dirty_pages() == 2'048U);
+  CHECK_THROWS_AS(env.set_max_dirty_pages(10U), std::system_error);
+
+  SUBCASE("small limit spills") {
+    {
+      auto t = lmdb::txn{env};
+      put(t, 0U, 20'000U);
+      CHECK_THROWS_AS(env.set_max_dirty_pages(4'096U), std::system_error);
+      t.commit();
+    }
+    auto const stat = env.spill_stat();
+    CHECK(stat.ms_spills != 0U);
+    CHECK(stat.ms_spilled_pages != 0U);
+    CHECK(stat.ms_dirty_peak <= 2'048U);
+    check(env, 20'000U);
+  }
+
+  SUBCASE("raised limit grows the dirty list") {
+    env.set_max_dirty_pages(65'536U);
+    {
+      auto t = lmdb::txn{env};
+      put(t, 0U, 20'000U);
+      t.commit();
+    }
+    auto const stat = env.spill_stat();
+    CHECK(stat.ms_spills == 0U);
+    CHECK(stat.ms_dirty_peak > 8'000U);
+    check(env, 20'000U);
+  }
+
+  SUBCASE("nested transactions") {
+    env.set_max_dirty_pages(65'536U);
+    {
+      auto parent = lmdb::txn{env};
+      put(parent, 0U, 5'000U);
+      {
+        auto child = lmdb::txn{env, parent, lmdb::txn_flags::NONE};
+        put(child, 5'000U, 25'000U);  // beyond the child's initial list
+        child.commit();
+      }
+      {
+        auto aborted = lmdb::txn{env, parent, lmdb::txn_flags::NONE};
+        put(aborted, 25'000U, 30'000U);
+      }
+      parent.commit();
+    }
+    CHECK(env.spill_stat().ms_spills == 0U);
+    check(env, 25'000U);
+  }
+}
+
+TEST_CASE("dirty pages in random order") {
+  std::remove("./DIRTY_RANDOM.mdb");
+  std::remove("./DIRTY_RANDOM.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(512ULL << 20U);
+  env.open("./DIRTY_RANDOM.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto rng = std::mt19937{7U};
+  auto expected = std::map<unsigned, std::string>{};
+  auto const random_puts = [&](lmdb::txn& t, unsigned const n) {
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != n; ++i) {
+      auto const key = static_cast<unsigned>(rng() % 50'000U);
+      // overflow values replaced in the same txn free dirty pages
+      auto val = std::string(rng() % 8U == 0U ? 6'000U : 200U,
+                             static_cast<char>('a' + rng() % 26U));
+      t.put(db, key, val);
+      expected[key] = std::move(val);
+    }
+  };
+
+  for (auto round = 0U; round != 3U; ++round) {
+    if (round == 2U) {
+      env.set_max_dirty_pages(4'096U);  // spills sorted parts of the list
+    }
+    auto t = lmdb::txn{env};
+    random_puts(t, 20'000U);
+    {
+      auto child = lmdb::txn{env, t, lmdb::txn_flags::NONE};
+      auto const before = expected;
+      random_puts(child, 5'000U);
+      if (round == 1U) {
+        expected = before;  // aborted
+      } else {
+        child.commit();
+      }
+    }
+    random_puts(t, 2'000U);
+    t.commit();
+  }
+  CHECK(env.spill_stat().ms_spills != 0U);
+
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = t.dbi_open();
+  CHECK(db.stat().ms_entries == expected.size());
+  for (auto const& [key, val] : expected) {
+    REQUIRE(t.get(db, key) == val);
+  }
+}
@@ -0,0 +1,140 @@
+#include "doctest/doctest.h"
+
+#include <cstdint>
+#include <numeric>
+#include <string_view>
+
+#include "lmdb/lmdb.hpp"
+
+TEST_CASE("dup_pages") {
+  auto env = lmdb::env{};
+  env.open("./DUP_PAGES.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto db = txn.dbi_open(lmdb::dbi_flags::DUPSORT | lmdb::dbi_flags::DUPFIXED |
+                         lmdb::dbi_flags::INTEGERDUP);
+  txn.dbi_clear(db);
+
+  auto const put = [&](std::string_view key, std::uint64_t const x) {
+    txn.put(db, key, std::string_view{reinterpret_cast<char const*>(&x),
+                                      sizeof(x)});
+  };
+
+  for (auto i = std::uint64_t{0U}; i != 10'000U; ++i) {
+    put("many", i);
+  }
+  put("one", 42U);
+  for (auto i = std::uint64_t{0U}; i != 5U; ++i) {
+    put("few", i * 10U);
+  }
+
+  auto c = lmdb::cursor{txn, db};
+
+  SUBCASE("multiple pages") {
+    auto chunks = 0U;
+    auto n = std::uint64_t{0U};
+    auto sum = std::uint64_t{0U};
+    for (auto const chunk : c.dup_pages<std::uint64_t>("many")) {
+      ++chunks;
+      for (auto const x : chunk) {
+        CHECK(x == n);
+        ++n;
+      }
+      sum = std::accumulate(chunk.begin(), chunk.end(), sum);
+    }
+    CHECK(chunks > 1U);
+    CHECK(n == 10'000U);
+    CHECK(sum == 9'999U * 10'000U / 2U);
+  }
+
+  SUBCASE("single item") {
+    auto n = 0U;
+    for (auto const chunk : c.dup_pages<std::uint64_t>("one")) {
+      REQUIRE(chunk.size() == 1U);
+      CHECK(chunk[0] == 42U);
+      ++n;
+    }
+    CHECK(n == 1U);
+  }
+
+  SUBCASE("inline sub-page") {
+    auto values = std::vector<std::uint64_t>{};
+    for (auto const chunk : c.dup_pages<std::uint64_t>("few")) {
+      values.insert(end(values), chunk.begin(), chunk.end());
+    }
+    CHECK(values == std::vector<std::uint64_t>{0U, 10U, 20U, 30U, 40U});
+  }
+
+  SUBCASE("missing key") {
+    auto r = c.dup_pages<std::uint64_t>("none");
+    CHECK(r.begin() == r.end());
+  }
+
+  SUBCASE("wrong item size throws") {
+    CHECK_THROWS_AS(c.dup_pages<std::uint32_t>("many").begin(),
+                    std::system_error);
+  }
+}
+
+TEST_CASE("put_multiple") {
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.set_maxdbs(2);
+  env.open("./PUT_MULTIPLE.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto db = txn.dbi_open("fixed", lmdb::dbi_flags::DUPSORT |
+                                      lmdb::dbi_flags::DUPFIXED |
+                                      lmdb::dbi_flags::CREATE);
+  txn.dbi_clear(db);
+
+  auto values = std::vector<std::uint32_t>(1'000'000U);
+  std::iota(begin(values), end(values), 0U);
+  for (auto& v : values) {  // big-endian: memcmp order == numeric order
+    auto const x = v;
+    auto* const b = reinterpret_cast<unsigned char*>(&v);
+    b[0] = static_cast<unsigned char>(x >> 24U);
+    b[1] = static_cast<unsigned char>(x >> 16U);
+    b[2] = static_cast<unsigned char>(x >> 8U);
+    b[3] = static_cast<unsigned char>(x);
+  }
+
+  SUBCASE("txn") {
+    txn.put_multiple<std::uint32_t>(db, "k", values);
+    txn.put_multiple<std::uint32_t>(db, "l", lmdb::span{values.data(), 3U});
+
+    auto c = lmdb::cursor{txn, db};
+    c.get(lmdb::cursor_op::SET, std::string_view{"k"});
+    CHECK(c.count() == values.size());
+    c.get(lmdb::cursor_op::SET, std::string_view{"l"});
+    CHECK(c.count() == 3U);
+
+    auto n = 0U;
+    auto mismatches = 0U;
+    for (auto const chunk : c.dup_pages<std::uint32_t>("k")) {
+      for (auto const x : chunk) {
+        mismatches += x != values[n] ? 1U : 0U;
+        ++n;
+      }
+    }
+    CHECK(n == values.size());
+    CHECK(mismatches == 0U);
+  }
+
+  SUBCASE("cursor") {
+    auto c = lmdb::cursor{txn, db};
+    c.put_multiple<std::uint32_t>(std::string_view{"c"},
+                                  lmdb::span{values.data(), 1'000U});
+    c.put_multiple<std::uint32_t>(std::string_view{"c"},
+                                  lmdb::span{values.data() + 500U, 1'000U});
+    c.get(lmdb::cursor_op::SET, std::string_view{"c"});
+    CHECK(c.count() == 1'500U);
+  }
+
+  SUBCASE("not DUPFIXED") {
+    auto plain = txn.dbi_open(
+        "plain", lmdb::dbi_flags::DUPSORT | lmdb::dbi_flags::CREATE);
+    CHECK_THROWS_AS(txn.put_multiple<std::uint32_t>(plain, "x", values),
+                    std::system_error);
+  }
+}
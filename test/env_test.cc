@@ -1,5 +1,9 @@
 #include "doctest/doctest.h"
 
+#include <cstdio>
+#include <optional>
+#include <string>
+
 #include "lmdb/lmdb.hpp"
 
 TEST_CASE("env") {
@@ -16,4 +20,102 @@ TEST_CASE("env") {
                  0600),
         std::system_error);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("map growth") {
+  auto const fill = [](lmdb::txn& t) {
+    auto db = t.dbi_open();
+    auto const value = std::string(1024U, 'x');
+    for (auto i = 0U; i != 4'096U; ++i) {
+      t.put(db, i, value);
+    }
+    return t.get(db, 4'095U).has_value();
+  };
+
+  std::remove("./MAP_GROWTH.mdb");
+  std::remove("./MAP_GROWTH.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(1U << 20U);
+  env.open("./MAP_GROWTH.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  SUBCASE("disabled") {
+    CHECK_THROWS_AS(env.write(fill), std::system_error);
+  }
+
+  SUBCASE("grows and retries") {
+    env.set_map_growth(2.0, 64U << 20U);
+    CHECK(env.write(fill));
+
+    auto info = MDB_envinfo{};
+    mdb_env_info(env.env_, &info);
+    CHECK(info.me_mapsize > (4U << 20U));
+    CHECK(info.me_mapsize <= (64U << 20U));
+
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto db = t.dbi_open();
+    CHECK(db.stat().ms_entries == 4'096U);
+  }
+
+  SUBCASE("upper bound") {
+    env.set_map_growth(2.0, 2U << 20U);
+    CHECK_THROWS_AS(env.write(fill), std::system_error);
+  }
+}
+
+TEST_CASE("metrics") {
+  std::remove("./METRICS.mdb");
+  std::remove("./METRICS.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_maxdbs(2U);
+  env.open("./METRICS.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS);
+
+  env.write([](lmdb::txn& t) {
+    auto a = t.dbi_open("a", lmdb::dbi_flags::CREATE);
+    auto b = t.dbi_open("b", lmdb::dbi_flags::CREATE);
+    for (auto i = 0U; i != 1'000U; ++i) {
+      t.put(a, i, std::string(100U, 'a'));
+    }
+    t.put(b, 1U, std::string(10'000U, 'b'));
+  });
+
+  auto const empty = env.metrics();
+  CHECK(empty.free_pages_ == 0U);
+  CHECK(!empty.oldest_reader_lag_);
+
+  auto reader =
+      std::optional<lmdb::txn>{std::in_place, env, lmdb::txn_flags::RDONLY};
+  for (auto i = 0U; i != 2U; ++i) {
+    env.write([](lmdb::txn& t) { t.dbi_clear(t.dbi_open("a")); });
+  }
+
+  auto const m = env.metrics();
+  REQUIRE(m.dbis_.size() == 3U);
+  CHECK(m.dbis_[0].name_.empty());
+  CHECK(m.dbis_[0].stat_.ms_entries == 2U);
+  CHECK(m.dbis_[1].name_ == "a");
+  CHECK(m.dbis_[1].stat_.ms_entries == 0U);
+  CHECK(m.dbis_[2].name_ == "b");
+  CHECK(m.dbis_[2].stat_.ms_depth == 1U);
+  CHECK(m.dbis_[2].stat_.ms_overflow_pages > 1U);
+  CHECK(m.free_pages_ > 0U);
+  CHECK(m.map_utilization() > 0.0);
+  CHECK(m.map_utilization() < 1.0);
+  CHECK(m.oldest_reader_lag_ == 2U);
+
+  reader.reset();
+  CHECK(!env.metrics().oldest_reader_lag_);
+
+  // named databases are listed without taking database handles
+  env = lmdb::env{};
+  env.set_maxdbs(1U);
+  env.open("./METRICS.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS);
+  for (auto i = 0U; i != 3U; ++i) {
+    CHECK(env.metrics().dbis_.size() == 3U);
+  }
+  auto t = lmdb::txn{env};
+  CHECK_NOTHROW(t.dbi_open("a"));
+}
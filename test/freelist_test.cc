@@ -0,0 +1,284 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+std::string value(unsigned const i, std::size_t const size) {
+  return std::string(size, static_cast<char>('a' + i % 26U));
+}
+
+// a compacting copy fails on page leaks (or pages freed twice)
+void check_no_leak(lmdb::env& env) {
+  std::remove("./FREELIST_COPY.mdb");
+  CHECK_NOTHROW(env.copy("./FREELIST_COPY.mdb", {true, 1U}));
+}
+
+}  // namespace
+
+TEST_CASE("freelist extents") {
+  std::remove("./FREELIST.mdb");
+  std::remove("./FREELIST.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(512ULL << 20U);
+  env.open("./FREELIST.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  // small and multi-page values, interleaved
+  auto const size = [](unsigned const i) -> std::size_t {
+    return i % 4U == 0U ? 3U * 4096U + i % 1000U : 300U;
+  };
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 40'000U; ++i) {
+      t.put(db, i, value(i, size(i)));
+    }
+    t.commit();
+  }
+
+  // scattered frees (many short runs) and a large contiguous one
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i < 20'000U; i += 3U) {
+      t.del(db, i);
+    }
+    for (auto i = 30'000U; i != 40'000U; ++i) {
+      t.del(db, i);
+    }
+    t.commit();
+  }
+  {  // pages freed by the last txn become reusable after the next one
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    t.put(db, 50'000U, value(0U, 10U));
+    t.commit();
+  }
+  check_no_leak(env);
+  auto const last_pgno = env.info().me_last_pgno;
+
+  SUBCASE("reuse for overflow pages") {
+    {
+      auto t = lmdb::txn{env};
+      auto db = t.dbi_open();
+      for (auto i = 30'000U; i != 33'000U; ++i) {
+        t.put(db, i, value(i, 2U * 4096U + 100U));
+      }
+      t.commit();
+    }
+    CHECK(env.info().me_last_pgno == last_pgno);  // fits in the freed pages
+    check_no_leak(env);
+
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 33'000U; ++i) {
+      auto const deleted = i < 20'000U && i % 3U == 0U;
+      auto const expected =
+          deleted ? std::optional<std::string>{}
+                  : std::optional{value(i, i >= 30'000U ? 2U * 4096U + 100U
+                                                        : size(i))};
+      REQUIRE(t.get(db, i) == expected);
+    }
+  }
+
+  SUBCASE("nested transactions") {
+    auto parent = lmdb::txn{env};
+    auto db = parent.dbi_open();
+    for (auto i = 30'000U; i != 31'000U; ++i) {
+      parent.put(db, i, value(i, 2U * 4096U));
+    }
+    {
+      auto child = lmdb::txn{env, parent, lmdb::txn_flags::NONE};
+      for (auto i = 31'000U; i != 32'000U; ++i) {
+        child.put(db, i, value(i, 2U * 4096U));
+      }
+      for (auto i = 30'000U; i != 30'500U; ++i) {
+        child.del(db, i);  // frees overflow pages taken from the freelist
+      }
+      child.commit();
+    }
+    {
+      auto aborted = lmdb::txn{env, parent, lmdb::txn_flags::NONE};
+      for (auto i = 32'000U; i != 33'000U; ++i) {
+        aborted.put(db, i, value(i, 2U * 4096U));
+      }
+    }
+    parent.commit();
+    check_no_leak(env);
+
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    CHECK(!t.get(db, 30'499U));
+    CHECK(t.get(db, 30'500U) == value(30'500U, 2U * 4096U));
+    CHECK(t.get(db, 31'999U) == value(31'999U, 2U * 4096U));
+    CHECK(!t.get(db, 32'000U));
+  }
+}
+
+TEST_CASE("freelist between reader snapshots") {
+  std::remove("./FREELIST_GAP.mdb");
+  std::remove("./FREELIST_GAP.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.open("./FREELIST_GAP.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS);
+
+  auto const update = [&](unsigned const round) {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 200U; ++i) {  // hot keys, every 10th overflows
+      t.put(db, i, value(i + round, i % 10U == 0U ? 5'000U : 400U));
+    }
+    t.commit();
+  };
+  auto const check = [](lmdb::txn& t, unsigned const round) {
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 200U; ++i) {
+      REQUIRE(t.get(db, i) ==
+              value(i + round, i % 10U == 0U ? 5'000U : 400U));
+    }
+    for (auto i = 200U; i != 2'000U; ++i) {
+      REQUIRE(t.get(db, i) == value(i, 400U));
+    }
+  };
+
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 2'000U; ++i) {
+      t.put(db, i, value(i, 400U));
+    }
+    t.commit();
+  }
+  update(0U);
+  update(0U);
+
+  // without reclaiming between snapshots, the oldest reader keeps every
+  // page freed since and the file grows by the same amount each round
+  auto oldest = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto const start_pgno = env.info().me_last_pgno;
+  for (auto round = 1U; round != 11U; ++round) {
+    update(round);
+  }
+  auto const growth = env.info().me_last_pgno - start_pgno;
+  REQUIRE(growth != 0U);
+
+  auto middle = std::optional<lmdb::txn>{};
+  for (auto round = 11U; round != 101U; ++round) {
+    if (round == 50U) {
+      middle.emplace(env, lmdb::txn_flags::RDONLY);
+    }
+    update(round);
+  }
+  CHECK(env.info().me_last_pgno - start_pgno < 3U * growth);
+
+  check(oldest, 0U);
+  check(*middle, 49U);
+  oldest.commit();
+  middle->commit();
+  check_no_leak(env);
+
+  update(101U);
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  check(t, 101U);
+}
+
+TEST_CASE("freelist between reader snapshots, not tracked") {
+  std::remove("./FREELIST_NO_GAP.mdb");
+  std::remove("./FREELIST_NO_GAP.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.set_max_gap_pages(0U);
+  env.open("./FREELIST_NO_GAP.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS);
+
+  auto const update = [&](unsigned const round) {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 200U; ++i) {
+      t.put(db, i, value(i + round, 400U));
+    }
+    t.commit();
+  };
+  update(0U);
+  update(0U);
+
+  auto oldest = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto const start_pgno = env.info().me_last_pgno;
+  for (auto round = 1U; round != 11U; ++round) {
+    update(round);
+  }
+  auto const growth = env.info().me_last_pgno - start_pgno;
+  for (auto round = 11U; round != 41U; ++round) {
+    update(round);
+  }
+  CHECK(env.info().me_last_pgno - start_pgno >= 3U * growth);
+
+  oldest.commit();
+  CHECK_THROWS_AS(
+      [&]() {
+        auto t = lmdb::txn{env};
+        env.set_max_gap_pages(1'024U);
+      }(),
+      std::system_error);
+  env.set_max_gap_pages(1'024U);
+  update(41U);
+  check_no_leak(env);
+}
+
+TEST_CASE("freelist when a reader ends during a write") {
+  std::remove("./FREELIST_GAP_END.mdb");
+  std::remove("./FREELIST_GAP_END.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.open("./FREELIST_GAP_END.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS);
+
+  auto const update = [&](lmdb::txn& t, unsigned const round) {
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 200U; ++i) {
+      t.put(db, i, value(i + round, i % 10U == 0U ? 5'000U : 400U));
+    }
+  };
+  auto const commit_update = [&](unsigned const round) {
+    auto t = lmdb::txn{env};
+    update(t, round);
+    t.commit();
+  };
+
+  commit_update(0U);
+  commit_update(0U);
+  auto reader = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  for (auto round = 1U; round != 6U; ++round) {
+    commit_update(round);
+  }
+
+  {
+    auto t = lmdb::txn{env};
+    update(t, 6U);  // takes records newer than the reader
+    reader.commit();
+    auto db = t.dbi_open();  // now takes the older records, too
+    for (auto i = 1'000U; i != 3'000U; ++i) {
+      t.put(db, i, value(i, 400U));
+    }
+    t.commit();
+  }
+  check_no_leak(env);
+
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = t.dbi_open();
+  for (auto i = 0U; i != 200U; ++i) {
+    REQUIRE(t.get(db, i) == value(i + 6U, i % 10U == 0U ? 5'000U : 400U));
+  }
+  for (auto i = 1'000U; i != 3'000U; ++i) {
+    REQUIRE(t.get(db, i) == value(i, 400U));
+  }
+}
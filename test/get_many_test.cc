@@ -0,0 +1,75 @@
+#include "doctest/doctest.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lmdb/lmdb.hpp"
+
+TEST_CASE("get_many") {
+  auto env = lmdb::env{};
+  env.set_mapsize(256ULL << 20U);
+  env.open("./GET_MANY.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto db = txn.dbi_open();
+  txn.dbi_clear(db);
+
+  // enough keys for a tree with several branch levels
+  for (auto i = 0U; i != 100'000U; i += 2U) {
+    txn.put(db, "key" + std::to_string(i), "val" + std::to_string(i));
+  }
+
+  SUBCASE("random order, hits and misses") {
+    auto rng = std::mt19937{42U};
+    auto dist = std::uniform_int_distribution<unsigned>{0U, 110'000U};
+    auto keys = std::vector<std::string>{};
+    for (auto i = 0U; i != 5'000U; ++i) {
+      keys.emplace_back("key" + std::to_string(dist(rng)));
+    }
+    keys.emplace_back(keys.front());  // duplicate in batch
+
+    auto const results = txn.get_many(db, keys);
+    REQUIRE(results.size() == keys.size());
+    for (auto i = 0U; i != keys.size(); ++i) {
+      CHECK(results[i] == txn.get(db, keys[i]));
+    }
+  }
+
+  SUBCASE("caller provided output") {
+    std::string_view const keys[] = {"key10", "key11", "key99998", "a", "z"};
+    auto out = std::vector<std::optional<std::string_view>>(5U);
+    txn.get_many(db, keys, out);
+    CHECK(out[0] == "val10");
+    CHECK(!out[1]);
+    CHECK(out[2] == "val99998");
+    CHECK(!out[3]);
+    CHECK(!out[4]);
+  }
+
+  SUBCASE("empty batch") {
+    CHECK(txn.get_many(db, std::vector<int>{}).empty());
+  }
+}
+
+TEST_CASE("get_many INTEGERKEY") {
+  auto env = lmdb::env{};
+  env.open("./GET_MANY_INTEGERKEY.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto db = txn.dbi_open(lmdb::dbi_flags::INTEGERKEY);
+  txn.dbi_clear(db);
+
+  for (auto i = 0U; i != 10'000U; ++i) {
+    txn.put(db, i * 3U, std::to_string(i));
+  }
+
+  auto const keys = std::vector<unsigned>{29'997U, 3U, 4U, 300U, 0U, 30'000U};
+  auto const results = txn.get_many(db, keys);
+  CHECK(results[0] == "9999");
+  CHECK(results[1] == "1");
+  CHECK(!results[2]);
+  CHECK(results[3] == "100");
+  CHECK(results[4] == "0");
+  CHECK(!results[5]);
+}
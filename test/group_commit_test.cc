@@ -0,0 +1,118 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "lmdb/group_commit.h"
+
+TEST_CASE("group commit") {
+  auto env = lmdb::env{};
+  env.set_mapsize(64U << 20U);
+  env.open("./GROUP_COMMIT.mdb", lmdb::env_open_flags::NOSUBDIR);
+  env.write([](lmdb::txn& t) { t.dbi_clear(t.dbi_open()); });
+
+  SUBCASE("many writers") {
+    constexpr auto const kThreads = 8U;
+    constexpr auto const kWrites = 200U;
+
+    auto gc = lmdb::group_commit{env, std::chrono::milliseconds{2}};
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0U; i != kThreads; ++i) {
+      threads.emplace_back([&, i]() {
+        auto futures = std::vector<std::future<void>>{};
+        for (auto j = 0U; j != kWrites; ++j) {
+          futures.emplace_back(gc.submit([key = i * kWrites + j](lmdb::txn& t) {
+            auto db = t.dbi_open();
+            t.put(db, key, std::to_string(key));
+          }));
+        }
+        for (auto& f : futures) {
+          f.get();
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+
+    CHECK(gc.commits() < kThreads * kWrites);
+
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto db = t.dbi_open();
+    CHECK(db.stat().ms_entries == kThreads * kWrites);
+    CHECK(t.get(db, 1234U) == "1234");
+  }
+
+  SUBCASE("failing closure only fails itself") {
+    auto gc = lmdb::group_commit{env, std::chrono::milliseconds{50}};
+    auto a = gc.submit([](lmdb::txn& t) {
+      auto db = t.dbi_open();
+      t.put(db, 1U, "a");
+      return 1;
+    });
+    auto b = gc.submit([](lmdb::txn& t) -> int {
+      auto db = t.dbi_open();
+      t.put(db, 2U, "b");
+      throw std::runtime_error{"b"};
+    });
+    auto c = gc.submit([](lmdb::txn& t) {
+      auto db = t.dbi_open();
+      t.put(db, 3U, "c");
+    });
+
+    CHECK(a.get() == 1);
+    CHECK_THROWS_AS(b.get(), std::runtime_error);
+    CHECK_NOTHROW(c.get());
+    CHECK(gc.commits() == 1U);
+
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto db = t.dbi_open();
+    CHECK(t.get(db, 1U) == "a");
+    CHECK(!t.get(db, 2U));
+    CHECK(t.get(db, 3U) == "c");
+  }
+}
+
+TEST_CASE("group commit with a full map") {
+  std::remove("./GROUP_COMMIT_FULL.mdb");
+  std::remove("./GROUP_COMMIT_FULL.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(1U << 20U);
+  env.set_map_growth(2.0, 64U << 20U);
+  env.open("./GROUP_COMMIT_FULL.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto const fill = [](lmdb::txn& t) {
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != 1'000U; ++i) {
+      t.put(db, i, std::string(2'000U, 'x'));
+    }
+  };
+
+  {  // no resize from the writer thread by default
+    auto gc = lmdb::group_commit{env};
+    auto f = gc.submit(fill);
+    auto ec = std::error_code{};
+    try {
+      f.get();
+    } catch (std::system_error const& e) {
+      ec = e.code();
+    }
+    CHECK(ec.value() == MDB_MAP_FULL);
+  }
+  CHECK(env.info().me_mapsize == 1U << 20U);
+
+  {
+    auto gc = lmdb::group_commit{env, std::chrono::microseconds{500}, 1024U,
+                                 lmdb::txn_flags::NONE, true};
+    CHECK_NOTHROW(gc.submit(fill).get());
+  }
+  CHECK(env.info().me_mapsize > 1U << 20U);
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  CHECK(t.dbi_open().stat().ms_entries == 1'000U);
+}
@@ -1,6 +1,10 @@
 #include "doctest/doctest.h"
 
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <string_view>
 
 #include "lmdb/lmdb.hpp"
 
@@ -73,4 +77,79 @@ TEST_CASE("INTEGERDUP") {
     }
     CHECK(s == "helloworld");
   }
-}
\ No newline at end of file
+}
+
+// keys spread over the whole range (sign bit set and not set), with gaps
+// to search for: covers LEAF2 pages and branch / leaf pages of nodes
+template <typename T>
+void check_integer_search(char const* path) {
+  constexpr auto const n = 20'000U;
+  constexpr auto const step = std::numeric_limits<T>::max() / (2U * n + 2U);
+  auto const key = [&](unsigned const i) {
+    return static_cast<T>(2U * i * step);
+  };
+
+  auto env = lmdb::env{};
+  env.set_maxdbs(2U);
+  env.open(path, lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto keys = txn.dbi_open(
+      "keys", lmdb::dbi_flags::INTEGERKEY | lmdb::dbi_flags::CREATE);
+  auto dups = txn.dbi_open(
+      "dups", lmdb::dbi_flags::DUPSORT | lmdb::dbi_flags::DUPFIXED |
+                  lmdb::dbi_flags::INTEGERDUP | lmdb::dbi_flags::CREATE);
+  txn.dbi_clear(keys);
+  txn.dbi_clear(dups);
+
+  for (auto i = 0U; i != n; ++i) {
+    auto const k = key(i);
+    txn.put(keys, k, "x");
+    txn.put(dups, "k",
+            std::string_view{reinterpret_cast<char const*>(&k), sizeof(k)});
+  }
+
+  auto c = lmdb::cursor{txn, keys};
+  MDB_cursor* dc = nullptr;
+  REQUIRE(mdb_cursor_open(txn.txn_, dups.dbi_, &dc) == MDB_SUCCESS);
+
+  auto const get_dup = [&](T x, MDB_cursor_op const op) -> std::optional<T> {
+    auto k = lmdb::to_mdb_val(std::string_view{"k"});
+    auto v = lmdb::to_mdb_val(x);
+    if (mdb_cursor_get(dc, &k, &v, op) != MDB_SUCCESS) {
+      return std::nullopt;
+    }
+    return lmdb::as_int<T>(lmdb::from_mdb_val(v));
+  };
+
+  auto key_errors = 0U, dup_errors = 0U;
+  for (auto i = 0U; i != n; ++i) {
+    auto const next = i + 1U == n ? std::nullopt : std::optional{key(i + 1U)};
+
+    key_errors += !txn.get(keys, key(i)).has_value();
+    key_errors += txn.get(keys, static_cast<T>(key(i) + 1U)).has_value();
+    auto const range = c.get(lmdb::cursor_op::SET_RANGE,
+                             static_cast<T>(key(i) + 1U));
+    key_errors += (range ? std::optional{range->first} : std::nullopt) != next;
+
+    dup_errors += get_dup(key(i), MDB_GET_BOTH) != key(i);
+    dup_errors +=
+        get_dup(static_cast<T>(key(i) + 1U), MDB_GET_BOTH).has_value();
+    dup_errors +=
+        get_dup(static_cast<T>(key(i) + 1U), MDB_GET_BOTH_RANGE) != next;
+  }
+  CHECK(key_errors == 0U);
+  CHECK(dup_errors == 0U);
+  CHECK(get_dup(T{0U}, MDB_GET_BOTH_RANGE) == T{0U});
+
+  mdb_cursor_close(dc);
+}
+
+TEST_CASE("integer key search") {
+  SUBCASE("32 bit") {
+    check_integer_search<std::uint32_t>("./INTEGER_SEARCH32.mdb");
+  }
+  SUBCASE("64 bit") {
+    check_integer_search<std::uint64_t>("./INTEGER_SEARCH64.mdb");
+  }
+}
@@ -0,0 +1,92 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <string>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+constexpr auto const kEntries = 20'000U;
+
+std::string key(unsigned const i) {
+  auto k = std::to_string(i);
+  return std::string(8U - k.size(), '0') + k;
+}
+
+std::string value(unsigned const i) {
+  // every 40th value on overflow pages
+  return std::string(i % 40U == 0U ? 5'000U + i % 3'000U : 200U,
+                     static_cast<char>('a' + i % 26U));
+}
+
+void scan(lmdb::cursor& c, unsigned const from) {
+  auto i = from;
+  for (auto el = c.get(lmdb::cursor_op::SET_RANGE, key(from)); el;
+       el = c.get(lmdb::cursor_op::NEXT), ++i) {
+    REQUIRE(el->first == key(i));
+    REQUIRE(el->second == value(i));
+  }
+  CHECK(i == kEntries);
+
+  i = kEntries;
+  for (auto el = c.get(lmdb::cursor_op::LAST); el;
+       el = c.get(lmdb::cursor_op::PREV)) {
+    --i;
+    REQUIRE(el->first == key(i));
+    REQUIRE(el->second == value(i));
+  }
+  CHECK(i == 0U);
+}
+
+}  // namespace
+
+TEST_CASE("prefetch scan") {
+  std::remove("./PREFETCH.mdb");
+  std::remove("./PREFETCH.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_mapsize(512ULL << 20U);
+  env.open("./PREFETCH.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  {
+    auto t = lmdb::txn{env};
+    auto db = t.dbi_open();
+    for (auto i = 0U; i != kEntries; ++i) {
+      t.put(db, key(i), value(i));
+    }
+
+    // dirty pages of a write txn
+    auto c = lmdb::cursor{t, db};
+    c.set_prefetch(4U);
+    scan(c, 0U);
+    t.commit();
+  }
+
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = t.dbi_open();
+  auto c = lmdb::cursor{t, db};
+  for (auto const depth : {0U, 1U, 8U, 256U, 100'000U}) {
+    c.set_prefetch(depth);
+    scan(c, 0U);
+    scan(c, 12'345U);
+  }
+
+  // direction changes and jumps within the same parent page
+  c.set_prefetch(16U);
+  auto el = c.get(lmdb::cursor_op::SET_RANGE, key(5'000U));
+  for (auto round = 0U; round != 50U; ++round) {
+    for (auto i = 0U; i != 100U; ++i) {
+      el = c.get(round % 2U == 0U ? lmdb::cursor_op::NEXT
+                                  : lmdb::cursor_op::PREV);
+    }
+    REQUIRE(el);
+    REQUIRE(el->first == key(round % 2U == 0U ? 5'100U : 5'000U));
+  }
+
+  // the depth survives a renew
+  t.commit();
+  auto t2 = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  c.renew(t2);
+  scan(c, 7U);
+}
@@ -0,0 +1,125 @@
+#include "doctest/doctest.h"
+
+#include <string>
+
+#include "lmdb/lmdb.hpp"
+
+TEST_CASE("cursor range") {
+  auto env = lmdb::env{};
+  env.open("./RANGE.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto db = txn.dbi_open(lmdb::dbi_flags::DUPSORT);
+  txn.dbi_clear(db);
+
+  txn.put(db, "a0", "x");
+  txn.put(db, "key0", "val0");
+  txn.put(db, "key2", "val2");
+  txn.put(db, "key3", "val3a");
+  txn.put(db, "key3", "val3b");
+  txn.put(db, "key5", "val5");
+  txn.put(db, "key7", "val7");
+  txn.put(db, "z0", "y");
+
+  auto c = lmdb::cursor{txn, db};
+
+  SUBCASE("bounded") {
+    std::string keys, values;
+    for (auto const& [k, v] : c.range("key1", "key6")) {
+      keys += k;
+      values += v;
+    }
+    CHECK(keys == "key2key3key3key5");
+    CHECK(values == "val2val3aval3bval5");
+  }
+
+  SUBCASE("bound is exclusive") {
+    std::string keys;
+    for (auto const& [k, v] : c.range("key2", "key5")) {
+      keys += k;
+    }
+    CHECK(keys == "key2key3key3");
+  }
+
+  SUBCASE("empty") {
+    auto r = c.range("key4", "key5");
+    CHECK(r.begin() == r.end());
+  }
+
+  SUBCASE("open ended") {
+    std::string keys;
+    for (auto const& [k, v] : c.range("key6")) {
+      keys += k;
+    }
+    CHECK(keys == "key7z0");
+
+    auto n = 0U;
+    for (auto const& el : c.range()) {
+      (void)el;
+      ++n;
+    }
+    CHECK(n == 8U);
+  }
+
+  SUBCASE("prefix") {
+    std::string keys;
+    for (auto const& [k, v] : c.prefix("key")) {
+      keys += k;
+    }
+    CHECK(keys == "key0key2key3key3key5key7");
+
+    auto r = c.prefix("nope");
+    CHECK(r.begin() == r.end());
+  }
+
+  SUBCASE("dups") {
+    std::string values;
+    for (auto const& [k, v] : c.dups("key3")) {
+      CHECK(k == "key3");
+      values += v;
+    }
+    CHECK(values == "val3aval3b");
+
+    auto r = c.dups("key4");
+    CHECK(r.begin() == r.end());
+  }
+
+  SUBCASE("bidirectional") {
+    auto r = c.range("key2", "key6");
+    auto it = r.begin();
+    CHECK(it->first == "key2");
+    ++it;
+    CHECK(it->second == "val3a");
+    ++it;
+    CHECK(it->second == "val3b");
+    --it;
+    CHECK(it->second == "val3a");
+    --it;
+    CHECK(it->first == "key2");
+    CHECK(it != r.end());
+  }
+}
+
+TEST_CASE("cursor range INTEGERKEY") {
+  auto env = lmdb::env{};
+  env.open("./RANGE_INTEGERKEY.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto db = txn.dbi_open(lmdb::dbi_flags::INTEGERKEY);
+  txn.dbi_clear(db);
+
+  for (auto i = 0U; i != 300U; ++i) {
+    txn.put(db, i, std::to_string(i));
+  }
+
+  auto c = lmdb::cursor{txn, db};
+  auto sum = 0U;
+  auto n = 0U;
+  for (auto const& [k, v] : c.range(10U, 260U)) {
+    CHECK(std::to_string(lmdb::as_int<unsigned>(k)) == v);
+    sum += lmdb::as_int<unsigned>(k);
+    ++n;
+  }
+  CHECK(n == 250U);
+  CHECK(sum == (259U * 260U - 9U * 10U) / 2U);
+}
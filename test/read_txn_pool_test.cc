@@ -0,0 +1,71 @@
+#include "doctest/doctest.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lmdb/read_txn_pool.h"
+
+TEST_CASE("read txn pool") {
+  auto env = lmdb::env{};
+  env.open("./READ_TXN_POOL.mdb", lmdb::env_open_flags::NOSUBDIR);
+  env.write([](lmdb::txn& t) {
+    auto db = t.dbi_open();
+    t.dbi_clear(db);
+    t.put(db, "a", "1");
+    t.put(db, "b", "2");
+  });
+
+  auto pool = lmdb::read_txn_pool{env};
+
+  SUBCASE("reuse and fresh snapshot") {
+    lmdb::cursor* first_cursor = nullptr;
+    lmdb::txn* first_txn = nullptr;
+    {
+      auto l = pool.acquire();
+      auto db = l->dbi_open();
+      CHECK(l->get(db, "a") == "1");
+      auto& c = l.get_cursor(db);
+      CHECK(c.get(lmdb::cursor_op::LAST)->first == "b");
+      first_cursor = &c;
+      first_txn = &l.get();
+    }
+
+    env.write([](lmdb::txn& t) {
+      auto db = t.dbi_open();
+      t.put(db, "a", "3");
+      t.put(db, "c", "4");
+    });
+
+    auto l = pool.acquire();
+    auto db = l->dbi_open();
+    CHECK(&l.get() == first_txn);
+    CHECK(l->get(db, "a") == "3");
+    auto& c = l.get_cursor(db);
+    CHECK(&c == first_cursor);
+    CHECK(c.get(lmdb::cursor_op::LAST)->first == "c");
+  }
+
+  SUBCASE("threads") {
+    auto errors = std::atomic_uint{0U};
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0U; i != 4U; ++i) {
+      threads.emplace_back([&]() {
+        for (auto j = 0U; j != 1'000U; ++j) {
+          auto l = pool.acquire();
+          auto db = l->dbi_open();
+          auto& c = l.get_cursor(db);
+          if (l->get(db, "b") != "2" ||
+              c.get(lmdb::cursor_op::FIRST)->first != "a") {
+            ++errors;
+          }
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    CHECK(errors == 0U);
+  }
+}
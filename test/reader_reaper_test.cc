@@ -0,0 +1,216 @@
+#include "doctest/doctest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "lmdb/lmdb.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+std::string value(unsigned const i) {
+  return std::string(i % 10U == 0U ? 5'000U : 500U,
+                     static_cast<char>('a' + i % 26U));
+}
+
+void update(lmdb::env& env, unsigned const round) {
+  auto t = lmdb::txn{env};
+  auto db = t.dbi_open();
+  for (auto i = 0U; i != 100U; ++i) {
+    t.put(db, i, value(i + round));
+  }
+  t.commit();
+}
+
+// waits up to 5s for pred()
+template <typename Pred>
+bool eventually(Pred&& pred) {
+  auto const until = std::chrono::steady_clock::now() + 5s;
+  while (!pred()) {
+    if (std::chrono::steady_clock::now() > until) {
+      return false;
+    }
+    std::this_thread::sleep_for(5ms);
+  }
+  return true;
+}
+
+struct reports {
+  std::vector<lmdb::lagging_reader> get() {
+    auto const lock = std::lock_guard{mutex_};
+    return readers_;
+  }
+
+  lmdb::reaper_fn fn(bool const evict) {
+    return [this, evict](lmdb::lagging_reader const& r) {
+      auto const lock = std::lock_guard{mutex_};
+      readers_.push_back(r);
+      return evict;
+    };
+  }
+
+  std::mutex mutex_;
+  std::vector<lmdb::lagging_reader> readers_;
+};
+
+}  // namespace
+
+TEST_CASE("reader reaper") {
+  std::remove("./READER_REAPER.mdb");
+  std::remove("./READER_REAPER.mdb-lock");
+
+  auto r = reports{};  // outlives the reaper of env
+  auto env = lmdb::env{};
+  env.set_mapsize(64ULL << 20U);
+  env.open("./READER_REAPER.mdb",
+           lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS);
+  update(env, 0U);
+  CHECK(env.reader_check() == 0);
+
+  SUBCASE("lag limit evicts") {
+    auto old = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto old_db = old.dbi_open();
+    auto const old_txnid = env.info().me_last_txnid;
+    for (auto round = 1U; round != 21U; ++round) {
+      update(env, round);
+    }
+    auto fresh = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto fresh_db = fresh.dbi_open();
+
+    env.set_reaper({10ms, 5U, 0ms}, r.fn(true));
+    REQUIRE(eventually([&]() { return !r.get().empty(); }));
+    env.set_reaper({0ms});  // no more reports below
+
+    auto const seen = r.get();
+    REQUIRE(seen.size() == 1U);
+    CHECK(seen[0].txnid_ == old_txnid);
+    CHECK(seen[0].lag_ == 20U);
+    CHECK(seen[0].pinned_pages_ != 0U);
+#if !defined(_WIN32)
+    CHECK(seen[0].pid_ == static_cast<int>(getpid()));
+#endif
+
+    CHECK_THROWS_AS(old.get(old_db, 0U), std::system_error);
+    CHECK(fresh.get(fresh_db, 0U) == value(20U));
+    for (auto const& reader : env.readers()) {
+      CHECK(reader.txnid_ != old_txnid);
+    }
+  }
+
+  SUBCASE("age limit reports") {
+    auto old = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto old_db = old.dbi_open();
+    update(env, 1U);
+
+    auto const start = std::chrono::steady_clock::now();
+    env.set_reaper({10ms, 0U, 50ms}, r.fn(false));
+    REQUIRE(eventually([&]() { return r.get().size() >= 3U; }));
+    env.set_reaper({0ms});
+    CHECK(std::chrono::steady_clock::now() - start >= 50ms);
+
+    auto const seen = r.get();
+    CHECK(seen.front().lag_ == 1U);
+    CHECK(seen.front().age_ >= 50ms);
+    CHECK(seen.back().age_ > seen.front().age_);
+    CHECK(old.get(old_db, 0U) == value(0U));  // only flagged
+  }
+
+  SUBCASE("stale slots are cleared") {
+#if !defined(_WIN32)
+    auto const pid = fork();
+    REQUIRE(pid != -1);
+    if (pid == 0) {  // a reader that dies without closing the env
+      auto child = lmdb::env{};
+      child.set_mapsize(64ULL << 20U);
+      child.open("./READER_REAPER.mdb", lmdb::env_open_flags::NOSUBDIR);
+      auto t = lmdb::txn{child, lmdb::txn_flags::RDONLY};
+      _exit(t.dbi_open().stat().ms_entries == 100U ? 0 : 1);
+    }
+    auto status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+
+    auto const has_child = [&]() {
+      for (auto const& reader : env.readers()) {
+        if (reader.pid_ == static_cast<int>(pid)) {
+          return true;
+        }
+      }
+      return false;
+    };
+    CHECK(has_child());
+    env.set_reaper({10ms});
+    CHECK(eventually([&]() { return !has_child(); }));
+#endif
+  }
+
+  SUBCASE("move assignment stops the reaper") {
+#if !defined(_WIN32)
+    int ready[2], done[2];
+    REQUIRE(pipe(ready) == 0);
+    REQUIRE(pipe(done) == 0);
+    auto const pid = fork();
+    REQUIRE(pid != -1);
+    if (pid == 0) {  // a reader that lags behind until the parent is done
+      auto child = lmdb::env{};
+      child.set_mapsize(64ULL << 20U);
+      child.open("./READER_REAPER.mdb", lmdb::env_open_flags::NOSUBDIR);
+      auto t = lmdb::txn{child, lmdb::txn_flags::RDONLY};
+      close(done[1]);
+      auto c = char{};
+      auto const ok = write(ready[1], "x", 1U) == 1 &&
+                      read(done[0], &c, 1U) == 0;  // EOF
+      _exit(ok ? 0 : 1);
+    }
+    close(done[0]);
+    auto c = char{};
+    REQUIRE(read(ready[0], &c, 1U) == 1);
+    update(env, 1U);
+
+    env.set_reaper({5ms, 0U, 1ms}, r.fn(false));
+    CHECK(eventually([&]() { return r.get().size() >= 2U; }));
+    env = lmdb::env{};  // the old reaper_fn is destroyed
+    auto const seen = r.get().size();
+    std::this_thread::sleep_for(50ms);
+    CHECK(r.get().size() == seen);
+
+    close(done[1]);
+    auto status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+    close(ready[0]);
+    close(ready[1]);
+#endif
+  }
+
+  SUBCASE("settings") {
+    auto closed = lmdb::env{};
+    CHECK_THROWS_AS(closed.set_reaper({10ms}), std::system_error);
+
+    env.set_reaper({1h, 1U, 0ms}, r.fn(true));
+    env.set_reaper({10ms, 1'000U, 1h}, r.fn(true));
+    std::this_thread::sleep_for(20ms);
+    env.set_mapsize(128ULL << 20U);  // waits for a check in progress
+
+    auto old = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto old_db = old.dbi_open();
+    update(env, 1U);
+    update(env, 2U);
+    std::this_thread::sleep_for(50ms);
+    CHECK(r.get().empty());
+    CHECK(old.get(old_db, 0U) == value(0U));
+  }  // the env stops the reaper when it closes
+}
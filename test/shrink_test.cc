@@ -0,0 +1,169 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+std::string value(unsigned const i) {
+  return std::string(i % 40U == 0U ? 5'000U : 200U,
+                     static_cast<char>('a' + i % 26U));
+}
+
+std::string dup(unsigned const key, unsigned const i) {
+  auto s = std::to_string(key * 1'000U + i);
+  return std::string(8U - s.size(), '0') + s + std::string(100U, 'd');
+}
+
+void fill(lmdb::env& env) {
+  auto t = lmdb::txn{env};
+  auto main = t.dbi_open();
+  auto dups = t.dbi_open("dups", lmdb::dbi_flags::CREATE |
+                                     lmdb::dbi_flags::DUPSORT);
+  auto gone = t.dbi_open("gone", lmdb::dbi_flags::CREATE);
+  for (auto i = 0U; i != 20'000U; ++i) {
+    t.put(main, i, value(i));
+  }
+  for (auto key = 0U; key != 100U; ++key) {
+    for (auto i = 0U; i != 300U; ++i) {  // subtrees
+      t.put(dups, key, dup(key, i));
+    }
+  }
+  for (auto i = 0U; i != 10'000U; ++i) {
+    t.put(gone, i, value(i + 1U));
+  }
+  t.commit();
+}
+
+// keeps every 5th main entry and a few dups, drops the rest
+void thin(lmdb::env& env) {
+  auto t = lmdb::txn{env};
+  auto main = t.dbi_open();
+  auto dups = t.dbi_open("dups", lmdb::dbi_flags::DUPSORT);
+  for (auto i = 0U; i != 20'000U; ++i) {
+    if (i % 5U != 0U) {
+      t.del(main, i);
+    }
+  }
+  for (auto key = 0U; key != 100U; ++key) {
+    for (auto i = 0U; i != 300U; ++i) {
+      if (key % 2U == 1U || i % 3U != 0U) {
+        t.del_dupdata(dups, key, dup(key, i));
+      }
+    }
+  }
+  t.dbi_remove(t.dbi_open("gone"));
+  t.commit();
+}
+
+void check(lmdb::txn& t) {
+  auto main = t.dbi_open();
+  auto dups = t.dbi_open("dups", lmdb::dbi_flags::DUPSORT);
+  CHECK(main.stat().ms_entries == 4'000U + 1U);  // + "dups"
+  for (auto i = 0U; i != 20'000U; i += 5U) {
+    REQUIRE(t.get(main, i) == value(i));
+  }
+  CHECK(dups.stat().ms_entries == 50U * 100U);
+  auto c = lmdb::cursor{t, dups};
+  auto n = 0U;
+  for (auto el = c.get(lmdb::cursor_op::FIRST); el;
+       el = c.get(lmdb::cursor_op::NEXT), ++n) {
+    auto key = 0U;
+    REQUIRE(el->first.size() == sizeof(key));
+    std::memcpy(&key, el->first.data(), sizeof(key));
+    REQUIRE(key == n / 100U * 2U);
+    REQUIRE(el->second == dup(key, n % 100U * 3U));
+  }
+  CHECK(n == 50U * 100U);
+}
+
+void check(lmdb::env& env) {
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  check(t);
+}
+
+void check_no_leak(lmdb::env& env) {
+  std::remove("./SHRINK_COPY.mdb");
+  CHECK_NOTHROW(env.copy("./SHRINK_COPY.mdb", {true, 1U}));
+}
+
+}  // namespace
+
+TEST_CASE("online shrink") {
+  std::remove("./SHRINK.mdb");
+  std::remove("./SHRINK.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_maxdbs(4U);
+  env.set_mapsize(256ULL << 20U);
+  env.open("./SHRINK.mdb", lmdb::env_open_flags::NOSUBDIR);
+  fill(env);
+  thin(env);
+
+#ifndef _WIN32
+  auto const psize = env.stat().ms_psize;
+  auto const size = std::filesystem::file_size("./SHRINK.mdb");
+#endif
+  auto const last_pgno = env.info().me_last_pgno;
+
+  {  // a reader of an old snapshot stops the shrink early
+    auto old = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto const released = env.shrink(64U);
+    CHECK(released < last_pgno / 2U);
+    check(old);
+  }
+
+  auto const released = env.shrink(64U);
+  CHECK(released > last_pgno / 2U);
+  CHECK(env.info().me_last_pgno < last_pgno / 2U);
+#ifndef _WIN32  // a mapped file can't be cut on Windows
+  CHECK(std::filesystem::file_size("./SHRINK.mdb") ==
+        (env.info().me_last_pgno + 1U) * psize);
+  CHECK(std::filesystem::file_size("./SHRINK.mdb") < size / 2U);
+#endif
+  check(env);
+  check_no_leak(env);
+  CHECK(env.shrink() == 0U);
+
+  {  // the file grows again on demand
+    auto t = lmdb::txn{env};
+    auto main = t.dbi_open();
+    for (auto i = 20'000U; i != 22'000U; ++i) {
+      t.put(main, i, value(i));
+    }
+    t.commit();
+  }
+  {
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto main = t.dbi_open();
+    for (auto i = 20'000U; i != 22'000U; ++i) {
+      REQUIRE(t.get(main, i) == value(i));
+    }
+  }
+  check_no_leak(env);
+  CHECK_THROWS_AS(env.shrink(0U), std::system_error);
+}
+
+TEST_CASE("online shrink with writemap") {
+  std::remove("./SHRINK_WRITEMAP.mdb");
+  std::remove("./SHRINK_WRITEMAP.mdb-lock");
+
+  auto env = lmdb::env{};
+  env.set_maxdbs(4U);
+  env.set_mapsize(256ULL << 20U);
+  env.open("./SHRINK_WRITEMAP.mdb", lmdb::env_open_flags::NOSUBDIR |
+                                        lmdb::env_open_flags::WRITEMAP);
+  fill(env);
+  thin(env);
+
+  auto const last_pgno = env.info().me_last_pgno;
+  CHECK(env.shrink(128U) > last_pgno / 2U);  // the file keeps the map size
+  CHECK(env.info().me_last_pgno < last_pgno / 2U);
+  check(env);
+  check_no_leak(env);
+}
@@ -29,4 +29,33 @@ TEST_CASE("txn") {
     txn.put(db, "key2", "hello world");
     CHECK(txn.del(db, "key1") == false);
   }
-}
\ No newline at end of file
+}
+TEST_CASE("reserve") {
+  auto env = lmdb::env{};
+  env.open("./RESERVE", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+  auto db = txn.dbi_open();
+
+  SUBCASE("txn") {
+    auto const buf = txn.reserve(db, "key1", 5U);
+    REQUIRE(buf.size() == 5U);
+    std::memcpy(buf.data(), "hello", 5U);
+    CHECK(txn.get(db, "key1") == "hello");
+  }
+
+  SUBCASE("cursor") {
+    auto c = lmdb::cursor{txn, db};
+    auto const buf = c.reserve("key2", 3U);
+    REQUIRE(buf.size() == 3U);
+    for (auto& b : buf) {
+      b = std::byte{'x'};
+    }
+    CHECK(txn.get(db, "key2") == "xxx");
+  }
+
+  SUBCASE("DUPSORT not supported") {
+    auto dup = txn.dbi_open(lmdb::dbi_flags::DUPSORT);
+    CHECK_THROWS_AS(txn.reserve(dup, "key3", 3U), std::system_error);
+  }
+}
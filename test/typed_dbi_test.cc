@@ -0,0 +1,191 @@
+#include "doctest/doctest.h"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "lmdb/typed_dbi.h"
+
+TEST_CASE("typed_dbi") {
+  auto env = lmdb::env{};
+  env.set_maxdbs(12U);
+  env.open("./TYPED_DBI.mdb", lmdb::env_open_flags::NOSUBDIR);
+
+  auto txn = lmdb::txn{env};
+
+  SUBCASE("integer keys") {
+    auto db = lmdb::typed_dbi<std::uint64_t, double>{txn, "u64",
+                                                     lmdb::dbi_flags::CREATE};
+    txn.dbi_clear(db.handle(txn));
+    CHECK((db.handle(txn).stat().ms_entries == 0U));
+
+    for (auto i = std::uint64_t{0U}; i != 1'000U; ++i) {
+      db.put(txn, i * 1'000'000'007U, static_cast<double>(i) / 2.0);
+    }
+    CHECK(db.get(txn, 7'000'000'049U) == 3.5);
+    CHECK(!db.get(txn, 1U));
+    CHECK(db.del(txn, 7'000'000'049U));
+    CHECK(!db.del(txn, 7'000'000'049U));
+    CHECK(!db.get(txn, 7'000'000'049U));
+
+    auto flags = 0U;
+    mdb_dbi_flags(txn.txn_, db.dbi_, &flags);
+    CHECK((flags & MDB_INTEGERKEY) != 0U);
+
+    auto h = db.handle(txn);
+    auto c = lmdb::cursor{txn, h};
+    auto const e = db.lower_bound(c, 6'000'000'043U);
+    REQUIRE(e.has_value());
+    CHECK(e->first == 8'000'000'056U);
+    CHECK(e->second == 4.0);
+  }
+
+  SUBCASE("big-endian tuple keys") {
+    using key_t = std::tuple<std::uint32_t, std::uint16_t>;
+    auto db = lmdb::typed_dbi<key_t, std::string_view>{
+        txn, "tuple", lmdb::dbi_flags::CREATE};
+    txn.dbi_clear(db.handle(txn));
+
+    db.put(txn, key_t{2U, 1U}, "c");
+    db.put(txn, key_t{1U, 300U}, "b");
+    db.put(txn, key_t{1U, 2U}, "a");
+    db.put(txn, key_t{256U, 0U}, "d");
+    CHECK(db.get(txn, key_t{1U, 300U}) == "b");
+
+    auto h = db.handle(txn);
+    auto c = lmdb::cursor{txn, h};
+    auto s = std::string{};
+    for (auto e = db.get(c, lmdb::cursor_op::FIRST); e;
+         e = db.get(c, lmdb::cursor_op::NEXT)) {
+      s += e->second;
+    }
+    CHECK(s == "abcd");
+
+    auto const e = db.lower_bound(c, key_t{1U, 3U});
+    REQUIRE(e.has_value());
+    CHECK(e->first == key_t{1U, 300U});
+  }
+
+  SUBCASE("signed and short integer keys") {
+    auto db = lmdb::typed_dbi<std::int32_t, std::int16_t>{
+        txn, "i32", lmdb::dbi_flags::CREATE};
+    txn.dbi_clear(db.handle(txn));
+
+    for (auto const i : {256, 1, -1, 0, -256, 70'000, -70'000}) {
+      db.put(txn, i, static_cast<std::int16_t>(-i / 10));
+    }
+    CHECK(db.get(txn, -70'000) == 7'000);
+
+    auto h = db.handle(txn);
+    auto c = lmdb::cursor{txn, h};
+    auto keys = std::vector<std::int32_t>{};
+    for (auto e = db.get(c, lmdb::cursor_op::FIRST); e;
+         e = db.get(c, lmdb::cursor_op::NEXT)) {
+      keys.push_back(e->first);
+    }
+    CHECK(keys ==
+          std::vector<std::int32_t>{-70'000, -256, -1, 0, 1, 256, 70'000});
+
+    auto u16 = lmdb::typed_dbi<std::uint16_t, std::string_view>{
+        txn, "u16", lmdb::dbi_flags::CREATE};
+    txn.dbi_clear(u16.handle(txn));
+    u16.put(txn, 256U, "b");
+    u16.put(txn, 1U, "a");
+    auto h16 = u16.handle(txn);
+    auto c16 = lmdb::cursor{txn, h16};
+    auto const e = u16.lower_bound(c16, 2U);
+    REQUIRE(e.has_value());
+    CHECK(e->first == 256U);
+  }
+
+  SUBCASE("floating point and enum keys") {
+    auto db = lmdb::typed_dbi<double, std::int32_t>{txn, "f64",
+                                                    lmdb::dbi_flags::CREATE};
+    txn.dbi_clear(db.handle(txn));
+
+    auto const inf = std::numeric_limits<double>::infinity();
+    for (auto const x : {2.5, -0.5, 1e300, -inf, 0.0, -1e9, 0.25, inf, -2.5}) {
+      db.put(txn, x, static_cast<std::int32_t>(x > 0.0 ? 1 : -1));
+    }
+    CHECK(db.get(txn, -2.5) == -1);
+
+    auto h = db.handle(txn);
+    auto c = lmdb::cursor{txn, h};
+    auto keys = std::vector<double>{};
+    for (auto e = db.get(c, lmdb::cursor_op::FIRST); e;
+         e = db.get(c, lmdb::cursor_op::NEXT)) {
+      keys.push_back(e->first);
+    }
+    CHECK(keys ==
+          std::vector<double>{-inf, -1e9, -2.5, -0.5, 0.0, 0.25, 2.5, 1e300,
+                              inf});
+    auto const e = db.lower_bound(c, -1.0);
+    REQUIRE(e.has_value());
+    CHECK(e->first == -0.5);
+
+    enum class level : std::int16_t { low = -5, mid = 0, high = 7 };
+    auto levels = lmdb::typed_dbi<level, std::string_view>{
+        txn, "level", lmdb::dbi_flags::CREATE};
+    txn.dbi_clear(levels.handle(txn));
+    levels.put(txn, level::high, "c");
+    levels.put(txn, level::low, "a");
+    levels.put(txn, level::mid, "b");
+    auto hl = levels.handle(txn);
+    auto cl = lmdb::cursor{txn, hl};
+    auto s = std::string{};
+    for (auto el = levels.get(cl, lmdb::cursor_op::FIRST); el;
+         el = levels.get(cl, lmdb::cursor_op::NEXT)) {
+      s += el->second;
+    }
+    CHECK(s == "abc");
+
+    enum class id : unsigned {};
+    auto ids = lmdb::typed_dbi<id, std::string_view>{txn, "id",
+                                                     lmdb::dbi_flags::CREATE};
+    auto flags = 0U;
+    mdb_dbi_flags(txn.txn_, ids.dbi_, &flags);
+    CHECK((flags & MDB_INTEGERKEY) != 0U);
+    ids.put(txn, id{300U}, "b");
+    ids.put(txn, id{2U}, "a");
+    auto hi = ids.handle(txn);
+    auto ci = lmdb::cursor{txn, hi};
+    auto const first = ids.get(ci, lmdb::cursor_op::FIRST);
+    REQUIRE(first.has_value());
+    CHECK(first->first == id{2U});
+  }
+
+  SUBCASE("custom compare") {
+    auto db = lmdb::typed_dbi<std::int32_t, std::int32_t, std::greater<>>{
+        txn, "desc", lmdb::dbi_flags::CREATE};
+    txn.dbi_clear(db.handle(txn));
+
+    for (auto const i : {-5, 3, 0, -100, 42}) {
+      db.put(txn, i, i * 2);
+    }
+    CHECK(db.get(txn, -100) == -200);
+
+    auto h = db.handle(txn);
+    auto c = lmdb::cursor{txn, h};
+    auto keys = std::vector<std::int32_t>{};
+    for (auto e = db.get(c, lmdb::cursor_op::FIRST); e;
+         e = db.get(c, lmdb::cursor_op::NEXT)) {
+      keys.push_back(e->first);
+    }
+    CHECK(keys == std::vector<std::int32_t>{42, 3, 0, -5, -100});
+
+    auto const e = db.lower_bound(c, 1);
+    REQUIRE(e.has_value());
+    CHECK(e->first == 0);
+  }
+
+  SUBCASE("value size mismatch") {
+    auto raw = txn.dbi_open("raw", lmdb::dbi_flags::CREATE);
+    txn.put(raw, "k", "too long for a double");
+    auto db = lmdb::typed_dbi<std::string_view, double>{txn, "raw"};
+    CHECK_THROWS_AS(db.get(txn, "k"), std::system_error);
+  }
+}
@@ -0,0 +1,86 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <string>
+#include <system_error>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+std::string value(unsigned const i) {
+  // mostly single pages, every 50th on overflow pages
+  return std::string(i % 50U == 0U ? 9'000U : 1'500U,
+                     static_cast<char>('a' + i % 26U));
+}
+
+void check(char const* path, unsigned const n, unsigned const round) {
+  auto env = lmdb::env{};
+  env.set_mapsize(512ULL << 20U);
+  env.open(path, lmdb::env_open_flags::NOSUBDIR);
+  auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+  auto db = t.dbi_open();
+  CHECK(env.stat().ms_entries == n);
+  for (auto i = 0U; i != n; ++i) {
+    REQUIRE(t.get(db, i) == value(i + round));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("io_uring commit") {
+  for (auto const flags :
+       {lmdb::env_open_flags::NONE, lmdb::env_open_flags::NOMETASYNC,
+        lmdb::env_open_flags::NOSYNC}) {
+    std::remove("./URING.mdb");
+    std::remove("./URING.mdb-lock");
+
+    {
+      auto env = lmdb::env{};
+      env.set_mapsize(512ULL << 20U);
+      // without io_uring (other OS, old kernel, seccomp) writev is used
+      auto const active = env.set_uring(64U);
+      env.open("./URING.mdb", lmdb::env_open_flags::NOSUBDIR | flags);
+
+      for (auto round = 0U; round != 3U; ++round) {
+        auto t = lmdb::txn{env};
+        auto db = t.dbi_open();
+        for (auto i = 0U; i != 20'000U; ++i) {
+          t.put(db, i, value(i + round));
+        }
+        if (round == 1U) {
+          CHECK_THROWS_AS(env.set_uring(0U), std::system_error);
+        }
+        t.commit();
+      }
+
+      {  // small commits
+        auto t = lmdb::txn{env};
+        auto db = t.dbi_open();
+        t.put(db, 20'000U, value(20'002U));
+        t.commit();
+      }
+      CHECK(!env.set_uring(0U));
+      {
+        auto t = lmdb::txn{env};
+        auto db = t.dbi_open();
+        t.put(db, 20'001U, value(20'003U));
+        t.commit();
+      }
+      CHECK(env.set_uring(16U) == active);
+      {
+        auto t = lmdb::txn{env};
+        auto db = t.dbi_open();
+        for (auto i = 0U; i != 30'000U; ++i) {
+          t.put(db, 100'000U + i, value(i));
+        }
+        for (auto i = 0U; i != 30'000U; ++i) {
+          t.del(db, 100'000U + i);
+        }
+        t.commit();
+      }
+    }
+
+    check("./URING.mdb", 20'002U, 2U);
+  }
+}
@@ -0,0 +1,81 @@
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <string>
+
+#include "lmdb/lmdb.hpp"
+
+namespace {
+
+std::string value(unsigned const i) {
+  // scattered single pages and overflow runs
+  return std::string(i % 30U == 0U ? 12'000U : 1'000U,
+                     static_cast<char>('a' + i % 26U));
+}
+
+}  // namespace
+
+TEST_CASE("writemap commit syncs written runs") {
+  for (auto const flags :
+       {lmdb::env_open_flags::NONE, lmdb::env_open_flags::NOMETASYNC,
+        lmdb::env_open_flags::MAPASYNC, lmdb::env_open_flags::NOSYNC}) {
+    std::remove("./WRITEMAP_SYNC.mdb");
+    std::remove("./WRITEMAP_SYNC.mdb-lock");
+
+    {
+      auto env = lmdb::env{};
+      env.set_mapsize(256ULL << 20U);
+      env.set_max_dirty_pages(1'024U);  // spilled pages are synced, too
+      env.open("./WRITEMAP_SYNC.mdb", lmdb::env_open_flags::NOSUBDIR |
+                                          lmdb::env_open_flags::WRITEMAP |
+                                          flags);
+
+      for (auto round = 0U; round != 3U; ++round) {
+        auto t = lmdb::txn{env};
+        auto db = t.dbi_open();
+        for (auto i = 0U; i != 10'000U; ++i) {
+          t.put(db, i, value(i + round));
+        }
+        t.commit();
+      }
+      {  // small scattered updates
+        auto t = lmdb::txn{env};
+        auto db = t.dbi_open();
+        for (auto i = 0U; i < 10'000U; i += 997U) {
+          t.put(db, i, value(i + 3U));
+        }
+        t.del(db, 1U);
+        t.commit();
+      }
+      {  // unsynced txn before a synced one
+        auto t = lmdb::txn{env, lmdb::txn_flags::NOSYNC};
+        auto db = t.dbi_open();
+        t.put(db, 20'000U, value(0U));
+        t.commit();
+      }
+      {
+        auto t = lmdb::txn{env};
+        auto db = t.dbi_open();
+        t.put(db, 20'001U, value(1U));
+        t.commit();
+      }
+      env.sync();
+    }
+
+    auto env = lmdb::env{};
+    env.set_mapsize(256ULL << 20U);
+    env.open("./WRITEMAP_SYNC.mdb", lmdb::env_open_flags::NOSUBDIR);
+    auto t = lmdb::txn{env, lmdb::txn_flags::RDONLY};
+    auto db = t.dbi_open();
+    CHECK(env.stat().ms_entries == 10'001U);
+    for (auto i = 0U; i != 10'000U; ++i) {
+      if (i == 1U) {
+        REQUIRE(!t.get(db, i));
+      } else {
+        REQUIRE(t.get(db, i) == value(i + (i % 997U == 0U ? 3U : 2U)));
+      }
+    }
+    CHECK(t.get(db, 20'000U) == value(0U));
+    CHECK(t.get(db, 20'001U) == value(1U));
+  }
+}